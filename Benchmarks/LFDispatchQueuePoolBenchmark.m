@@ -0,0 +1,113 @@
+//
+//  LFDispatchQueuePoolBenchmark.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+//  Tail latency of LFDispatchQueuePool under a skewed workload: most tasks are short, a
+//  few are long (like a render of a big image among small labels). It compares picking
+//  the serial queues round-robin (the old behavior), the least loaded queue (`async:`),
+//  and the work-stealing executor. The latency of a task is from its submission to its end.
+//
+//  Build for the simulator and run it in a booted one:
+//      xcrun -sdk iphonesimulator clang -arch arm64 -mios-simulator-version-min=12.0 -fobjc-arc -O2 \
+//          -I LFYYKit/Text/Util -framework Foundation -framework UIKit -framework QuartzCore \
+//          Benchmarks/LFDispatchQueuePoolBenchmark.m LFYYKit/Text/Util/LFDispatchQueuePool.m \
+//          LFYYKit/Text/Util/LFWorkStealingExecutor.m -o pool_bench
+//      xcrun simctl spawn booted "$PWD/pool_bench" [task count] [queue count]
+//
+
+#import <Foundation/Foundation.h>
+#import <mach/mach_time.h>
+#import "LFDispatchQueuePool.h"
+
+#define TASK_INTERVAL 0.001     // A task is submitted every millisecond.
+#define SHORT_TASK_TIME 0.0005  // Most tasks take 0.5ms...
+#define LONG_TASK_TIME 0.020    // ...and 1 in LONG_TASK_PERIOD takes 20ms.
+#define LONG_TASK_PERIOD 20
+
+typedef NS_ENUM(NSUInteger, LFBenchmarkMode) {
+    LFBenchmarkModeRoundRobin = 0,
+    LFBenchmarkModeLeastLoaded,
+    LFBenchmarkModeWorkStealing,
+};
+
+static double LFBenchmarkNow(void) {
+    static mach_timebase_info_data_t info;
+    if (info.denom == 0) mach_timebase_info(&info);
+    return (double)mach_absolute_time() * info.numer / info.denom / 1e9;
+}
+
+static void LFBenchmarkSpin(double duration) {
+    double end = LFBenchmarkNow() + duration;
+    while (LFBenchmarkNow() < end) {}
+}
+
+static int LFBenchmarkCompareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/// Runs the workload, and prints the latency percentiles in milliseconds.
+static void LFBenchmarkRun(LFBenchmarkMode mode, NSUInteger taskCount, NSUInteger queueCount) {
+    NSMutableArray *queues = [NSMutableArray new];
+    LFDispatchQueuePool *pool = nil;
+    if (mode == LFBenchmarkModeRoundRobin) {
+        for (NSUInteger i = 0; i < queueCount; i++) {
+            [queues addObject:dispatch_queue_create("com.laifeng.kit.benchmark.serial", DISPATCH_QUEUE_SERIAL)];
+        }
+    } else {
+        pool = [[LFDispatchQueuePool alloc] initWithName:@"com.laifeng.kit.benchmark.pool"
+                                              queueCount:queueCount
+                                                     qos:NSQualityOfServiceUserInitiated
+                                            workStealing:mode == LFBenchmarkModeWorkStealing];
+    }
+
+    double *latencies = calloc(taskCount, sizeof(double));
+    dispatch_group_t group = dispatch_group_create();
+    double begin = LFBenchmarkNow();
+    for (NSUInteger i = 0; i < taskCount; i++) {
+        // paced arrivals, the pool is ~40% busy on average with 4 queues
+        double submit = begin + i * TASK_INTERVAL;
+        while (LFBenchmarkNow() < submit) {}
+        double duration = (i % LONG_TASK_PERIOD == LONG_TASK_PERIOD - 1) ? LONG_TASK_TIME : SHORT_TASK_TIME;
+        dispatch_block_t task = ^{
+            LFBenchmarkSpin(duration);
+            latencies[i] = LFBenchmarkNow() - submit;
+        };
+        if (pool) {
+            [pool async:task group:group];
+        } else {
+            dispatch_group_async(group, queues[i % queueCount], task);
+        }
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    qsort(latencies, taskCount, sizeof(double), LFBenchmarkCompareDouble);
+    double sum = 0;
+    for (NSUInteger i = 0; i < taskCount; i++) sum += latencies[i];
+    const char *names[] = {"round-robin", "least loaded", "work stealing"};
+    printf("%-14s %8.2f %8.2f %8.2f %8.2f %8.2f\n", names[mode],
+           sum / taskCount * 1000,
+           latencies[taskCount / 2] * 1000,
+           latencies[taskCount * 95 / 100] * 1000,
+           latencies[taskCount * 99 / 100] * 1000,
+           latencies[taskCount - 1] * 1000);
+    free(latencies);
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        NSUInteger taskCount = 2000, queueCount = 4;
+        if (argc > 1) taskCount = MAX(strtoul(argv[1], NULL, 10), 1);
+        if (argc > 2) queueCount = MIN(MAX(strtoul(argv[2], NULL, 10), 1), 32);
+        printf("%lu tasks, %lu queues, 1 in %d tasks takes %.0fms, the others %.1fms, latency in ms\n",
+               (unsigned long)taskCount, (unsigned long)queueCount, LONG_TASK_PERIOD, LONG_TASK_TIME * 1000, SHORT_TASK_TIME * 1000);
+        printf("%-14s %8s %8s %8s %8s %8s\n", "", "mean", "p50", "p95", "p99", "max");
+        for (NSUInteger mode = 0; mode < 3; mode++) {
+            LFBenchmarkRun((LFBenchmarkMode)mode, taskCount, queueCount);
+        }
+    }
+    return 0;
+}
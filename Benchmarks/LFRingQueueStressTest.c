@@ -0,0 +1,132 @@
+//
+//  LFRingQueueStressTest.c
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+//  Stress test and throughput benchmark of LFRingQueue with multiple producers and
+//  consumers. It checks that every item is dequeued exactly once, and that each
+//  consumer sees the items of each producer in the order they were enqueued.
+//
+//  Build and run (Linux or macOS):
+//      cc -O2 -pthread -I LFYYKit Benchmarks/LFRingQueueStressTest.c LFYYKit/LFRingQueue.c -o ringqueue_stress
+//      ./ringqueue_stress [producers] [consumers] [items per producer] [capacity]
+//
+
+#include "LFRingQueue.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_THREADS 64
+#define BATCH_SIZE 16
+
+static LFRingQueue *queue;
+static int producerCount = 4;
+static int consumerCount = 4;
+static uint64_t itemsPerProducer = 1000000;
+static uint64_t totalItems;
+
+static uint64_t dequeuedCount; // atomic
+static uint64_t dequeuedChecksum; // atomic
+static uint64_t orderErrors; // atomic
+
+// The item is (producer + 1) << 40 | sequence, never NULL.
+static inline void *LFItemMake(uint64_t producer, uint64_t sequence) {
+    return (void *)(uintptr_t)(((producer + 1) << 40) | sequence);
+}
+
+static void *LFProducerMain(void *context) {
+    uint64_t producer = (uint64_t)(uintptr_t)context;
+    for (uint64_t i = 0; i < itemsPerProducer; i++) {
+        void *item = LFItemMake(producer, i);
+        while (!LFRingQueueTryEnqueue(queue, item)) sched_yield();
+    }
+    return NULL;
+}
+
+static void *LFConsumerMain(void *context) {
+    uint64_t consumer = (uint64_t)(uintptr_t)context;
+    int64_t last[MAX_THREADS]; // the last sequence seen per producer
+    for (int i = 0; i < MAX_THREADS; i++) last[i] = -1;
+    uint64_t checksum = 0, count = 0, errors = 0;
+    void *items[BATCH_SIZE];
+    
+    while (__atomic_load_n(&dequeuedCount, __ATOMIC_RELAXED) < totalItems) {
+        // odd consumers use the batch dequeue, even ones the single dequeue
+        size_t n;
+        if (consumer & 1) {
+            n = LFRingQueueTryDequeueBatch(queue, items, BATCH_SIZE);
+        } else {
+            n = LFRingQueueTryDequeue(queue, &items[0]) ? 1 : 0;
+        }
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint64_t value = (uint64_t)(uintptr_t)items[i];
+            uint64_t producer = (value >> 40) - 1;
+            int64_t sequence = (int64_t)(value & ((1ULL << 40) - 1));
+            if (producer >= (uint64_t)producerCount || sequence <= last[producer]) errors++;
+            else last[producer] = sequence;
+            checksum += value;
+        }
+        count += n;
+        __atomic_fetch_add(&dequeuedCount, n, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&dequeuedChecksum, checksum, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&orderErrors, errors, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static double LFNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+    size_t capacity = 1024;
+    if (argc > 1) producerCount = atoi(argv[1]);
+    if (argc > 2) consumerCount = atoi(argv[2]);
+    if (argc > 3) itemsPerProducer = strtoull(argv[3], NULL, 10);
+    if (argc > 4) capacity = strtoull(argv[4], NULL, 10);
+    if (producerCount < 1 || producerCount > MAX_THREADS || consumerCount < 1 || consumerCount > MAX_THREADS) {
+        fprintf(stderr, "1...%d producers and consumers\n", MAX_THREADS);
+        return 2;
+    }
+    totalItems = itemsPerProducer * producerCount;
+    queue = LFRingQueueCreate(capacity);
+    if (!queue) return 2;
+    
+    pthread_t producers[MAX_THREADS], consumers[MAX_THREADS];
+    double begin = LFNow();
+    for (int i = 0; i < consumerCount; i++) pthread_create(&consumers[i], NULL, LFConsumerMain, (void *)(uintptr_t)i);
+    for (int i = 0; i < producerCount; i++) pthread_create(&producers[i], NULL, LFProducerMain, (void *)(uintptr_t)i);
+    for (int i = 0; i < producerCount; i++) pthread_join(producers[i], NULL);
+    for (int i = 0; i < consumerCount; i++) pthread_join(consumers[i], NULL);
+    double duration = LFNow() - begin;
+    
+    uint64_t expectedChecksum = 0;
+    for (uint64_t p = 0; p < (uint64_t)producerCount; p++) {
+        for (uint64_t i = 0; i < itemsPerProducer; i++) expectedChecksum += (uint64_t)(uintptr_t)LFItemMake(p, i);
+    }
+    void *leftover;
+    int empty = !LFRingQueueTryDequeue(queue, &leftover);
+    int ok = dequeuedCount == totalItems && dequeuedChecksum == expectedChecksum && orderErrors == 0 && empty;
+    
+    printf("producers:%d consumers:%d capacity:%zu items:%llu\n", producerCount, consumerCount,
+           LFRingQueueGetCapacity(queue), (unsigned long long)totalItems);
+    printf("dequeued:%llu checksum:%s order errors:%llu empty:%s\n", (unsigned long long)dequeuedCount,
+           dequeuedChecksum == expectedChecksum ? "ok" : "MISMATCH", (unsigned long long)orderErrors, empty ? "yes" : "NO");
+    printf("time:%.3fs throughput:%.2f M items/s\n", duration, totalItems / duration / 1e6);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    LFRingQueueRelease(queue);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+//
+//  LFThreadSafeDictionaryBenchmark.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+//  Contention benchmark of LFThreadSafeDictionary: the single lock mode against the
+//  sharded reader/writer mode (and the persistent mode), with 1, 2, 4 and 8 threads
+//  running a read-mostly and a write-heavy mix of keyed accesses.
+//
+//  Build for the simulator and run it in a booted one (see README.md for LFCategory):
+//      xcrun -sdk iphonesimulator clang -arch arm64 -mios-simulator-version-min=12.0 -fobjc-arc -O2 \
+//          -I LFYYKit -F "$LFCATEGORY_DIR" -Wl,-rpath,"$LFCATEGORY_DIR" -framework LFCategory -framework Foundation \
+//          Benchmarks/LFThreadSafeDictionaryBenchmark.m LFYYKit/LFThreadSafeDictionary.m \
+//          LFYYKit/LFPersistentDictionary.m LFYYKit/LFLockStatistics.m -o dictionary_bench
+//      xcrun simctl spawn booted "$PWD/dictionary_bench" [operations per thread]
+//
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+#import <mach/mach_time.h>
+#import "LFThreadSafeDictionary.h"
+
+#define KEY_COUNT 1024
+#define MAX_THREADS 8
+
+typedef NS_ENUM(NSUInteger, LFBenchmarkMode) {
+    LFBenchmarkModeSingleLock = 0,
+    LFBenchmarkModeSharded,
+    LFBenchmarkModePersistent,
+};
+
+static NSArray *keys;
+static NSUInteger operationsPerThread = 200000;
+
+typedef struct {
+    void *dictionary; ///< LFThreadSafeDictionary, unretained
+    NSUInteger writePercent;
+    uint32_t seed;
+    volatile int *start;
+} LFBenchmarkThreadContext;
+
+static double LFBenchmarkSeconds(uint64_t ticks) {
+    static mach_timebase_info_data_t info;
+    if (info.denom == 0) mach_timebase_info(&info);
+    return (double)ticks * info.numer / info.denom / 1e9;
+}
+
+static void *LFBenchmarkThreadMain(void *arg) {
+    LFBenchmarkThreadContext *context = arg;
+    LFThreadSafeDictionary *dictionary = (__bridge LFThreadSafeDictionary *)context->dictionary;
+    uint32_t seed = context->seed;
+    while (!__atomic_load_n(context->start, __ATOMIC_ACQUIRE)) {}
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < operationsPerThread; i++) {
+            seed = seed * 1103515245 + 12345; // LCG, cheap enough not to be measured
+            id key = keys[(seed >> 8) % KEY_COUNT];
+            if ((seed >> 24) % 100 < context->writePercent) {
+                dictionary[key] = key;
+            } else {
+                (void)dictionary[key];
+            }
+        }
+    }
+    return NULL;
+}
+
+static LFThreadSafeDictionary *LFBenchmarkCreateDictionary(LFBenchmarkMode mode) {
+    NSMutableDictionary *entries = [NSMutableDictionary new];
+    for (id key in keys) entries[key] = key;
+    switch (mode) {
+        case LFBenchmarkModeSingleLock: {
+            LFThreadSafeDictionary *dictionary = [LFThreadSafeDictionary new];
+            [dictionary addEntriesFromDictionary:entries];
+            return dictionary;
+        }
+        case LFBenchmarkModeSharded: {
+            LFThreadSafeDictionary *dictionary = [[LFThreadSafeDictionary alloc] initWithShardCount:0];
+            [dictionary addEntriesFromDictionary:entries];
+            return dictionary;
+        }
+        case LFBenchmarkModePersistent:
+            return [[LFThreadSafeDictionary alloc] initPersistentWithDictionary:entries];
+    }
+    return nil;
+}
+
+/// Returns the million operations per second of all the threads.
+static double LFBenchmarkRun(LFBenchmarkMode mode, NSUInteger threadCount, NSUInteger writePercent) {
+    LFThreadSafeDictionary *dictionary = LFBenchmarkCreateDictionary(mode);
+    volatile int start = 0;
+    pthread_t threads[MAX_THREADS];
+    LFBenchmarkThreadContext contexts[MAX_THREADS];
+    for (NSUInteger i = 0; i < threadCount; i++) {
+        contexts[i] = (LFBenchmarkThreadContext){(__bridge void *)dictionary, writePercent, (uint32_t)(i * 7919 + 1), &start};
+        pthread_create(&threads[i], NULL, LFBenchmarkThreadMain, &contexts[i]);
+    }
+    uint64_t begin = mach_absolute_time();
+    __atomic_store_n(&start, 1, __ATOMIC_RELEASE);
+    for (NSUInteger i = 0; i < threadCount; i++) pthread_join(threads[i], NULL);
+    double seconds = LFBenchmarkSeconds(mach_absolute_time() - begin);
+    if (dictionary.count != KEY_COUNT) printf("error: count %lu\n", (unsigned long)dictionary.count);
+    return threadCount * operationsPerThread / seconds / 1e6;
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        if (argc > 1) operationsPerThread = strtoul(argv[1], NULL, 10);
+        NSMutableArray *array = [NSMutableArray new];
+        for (NSUInteger i = 0; i < KEY_COUNT; i++) [array addObject:[NSString stringWithFormat:@"key-%lu", (unsigned long)i]];
+        keys = array;
+
+        const char *modeNames[] = {"single lock", "sharded", "persistent"};
+        NSUInteger writePercents[] = {10, 50};
+        NSUInteger threadCounts[] = {1, 2, 4, 8};
+        printf("LFThreadSafeDictionary, %lu keys, %lu operations per thread, M operations/s\n",
+               (unsigned long)KEY_COUNT, (unsigned long)operationsPerThread);
+        for (NSUInteger w = 0; w < 2; w++) {
+            printf("\n%lu%% writes     %10s %10s %10s %10s\n", (unsigned long)writePercents[w], "1", "2", "4", "8");
+            for (NSUInteger m = 0; m < 3; m++) {
+                printf("%-16s", modeNames[m]);
+                for (NSUInteger t = 0; t < 4; t++) {
+                    LFBenchmarkRun((LFBenchmarkMode)m, threadCounts[t], writePercents[w]); // warm up
+                    printf(" %10.2f", LFBenchmarkRun((LFBenchmarkMode)m, threadCounts[t], writePercents[w]));
+                }
+                printf("\n");
+            }
+        }
+    }
+    return 0;
+}
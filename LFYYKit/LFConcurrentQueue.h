@@ -0,0 +1,68 @@
+//
+//  LFConcurrentQueue.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ A bounded thread safe FIFO queue for multiple producers and multiple consumers.
+ 
+ @discussion Use it instead of LFThreadSafeArray as a work queue (addObject: from the
+ producers and removeObjectAtIndex:0 from the consumers): the storage is a lock-free
+ ring buffer, so enqueue and dequeue are O(1) and don't serialize each other.
+ 
+ The queue has a fixed capacity. When it's full, `tryEnqueueObject:` fails and the
+ blocking methods wait for a free slot, so the producers are slowed down to the
+ speed of the consumers (backpressure).
+ */
+@interface LFConcurrentQueue : NSObject
+
+- (instancetype)init UNAVAILABLE_ATTRIBUTE;
++ (instancetype)new UNAVAILABLE_ATTRIBUTE;
+
+/**
+ Creates and returns a queue.
+ 
+ @param capacity Maximum object count, will be rounded up to a power of 2.
+ @return A new queue, or nil if an error occurs.
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+/// Maximum object count of the queue.
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/// Current object count. It's only a hint when other threads are working on the queue.
+@property (nonatomic, readonly) NSUInteger count;
+
+/// Appends an object, returns NO immediately if the queue is full.
+- (BOOL)tryEnqueueObject:(id)object;
+
+/// Appends an object, waits for a free slot if the queue is full.
+- (void)enqueueObject:(id)object;
+
+/**
+ Appends an object, waits for a free slot if the queue is full.
+ 
+ @param object  The object, should not be nil.
+ @param timeout Maximum waiting time in seconds.
+ @return NO if the queue is still full when timed out.
+ */
+- (BOOL)enqueueObject:(id)object timeout:(NSTimeInterval)timeout;
+
+/// Removes and returns the oldest object, returns nil immediately if the queue is empty.
+- (id)tryDequeueObject;
+
+/// Removes and returns the oldest object, waits for an object if the queue is empty.
+- (id)dequeueObject;
+
+/// Removes and returns the oldest object, returns nil if the queue is still empty when timed out.
+- (id)dequeueObjectWithTimeout:(NSTimeInterval)timeout;
+
+/// Removes and returns up to `maxCount` objects in FIFO order, never waits.
+- (NSArray *)dequeueObjectsWithMaxCount:(NSUInteger)maxCount;
+
+@end
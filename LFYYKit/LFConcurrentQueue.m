@@ -0,0 +1,114 @@
+//
+//  LFConcurrentQueue.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFConcurrentQueue.h"
+#import "LFRingQueue.h"
+#import <sched.h>
+
+static inline dispatch_time_t LFTimeoutToDispatchTime(NSTimeInterval timeout) {
+    if (timeout <= 0) return DISPATCH_TIME_NOW;
+    if (timeout >= DBL_MAX) return DISPATCH_TIME_FOREVER;
+    return dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+}
+
+@implementation LFConcurrentQueue {
+    LFRingQueue *_queue;
+    dispatch_semaphore_t _slots; ///< free slot count, producers wait on it
+    dispatch_semaphore_t _items; ///< object count, consumers wait on it
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (!self) return nil;
+    _queue = LFRingQueueCreate(capacity);
+    if (!_queue) return nil;
+    _capacity = LFRingQueueGetCapacity(_queue);
+    // Start at 0 and signal up to the capacity: a semaphore disposed with a value below
+    // its initial value aborts, and the queue may be released with objects in it.
+    _slots = dispatch_semaphore_create(0);
+    for (NSUInteger i = 0; i < _capacity; i++) {
+        dispatch_semaphore_signal(_slots);
+    }
+    _items = dispatch_semaphore_create(0);
+    return self;
+}
+
+- (void)dealloc {
+    if (_queue) {
+        void *item;
+        while (LFRingQueueTryDequeue(_queue, &item)) {
+            CFRelease(item);
+        }
+        LFRingQueueRelease(_queue);
+        _queue = NULL;
+    }
+}
+
+- (NSUInteger)count {
+    return LFRingQueueGetApproximateCount(_queue);
+}
+
+#pragma mark - Private
+
+/// The caller owns a free slot (from `_slots`), the ring accepts the object unless
+/// a consumer which owns the previous lap of the slot hasn't released it yet.
+- (void)_pushObject:(id)object {
+    void *item = (void *)CFBridgingRetain(object);
+    while (!LFRingQueueTryEnqueue(_queue, item)) sched_yield();
+    dispatch_semaphore_signal(_items);
+}
+
+/// The caller owns an object (from `_items`), the ring returns it unless the
+/// producer which claimed the slot hasn't published it yet.
+- (id)_popObject {
+    void *item = NULL;
+    while (!LFRingQueueTryDequeue(_queue, &item)) sched_yield();
+    dispatch_semaphore_signal(_slots);
+    return CFBridgingRelease(item);
+}
+
+#pragma mark - Public
+
+- (BOOL)tryEnqueueObject:(id)object {
+    return [self enqueueObject:object timeout:0];
+}
+
+- (void)enqueueObject:(id)object {
+    [self enqueueObject:object timeout:DBL_MAX];
+}
+
+- (BOOL)enqueueObject:(id)object timeout:(NSTimeInterval)timeout {
+    if (!object) return NO;
+    if (dispatch_semaphore_wait(_slots, LFTimeoutToDispatchTime(timeout)) != 0) return NO;
+    [self _pushObject:object];
+    return YES;
+}
+
+- (id)tryDequeueObject {
+    return [self dequeueObjectWithTimeout:0];
+}
+
+- (id)dequeueObject {
+    return [self dequeueObjectWithTimeout:DBL_MAX];
+}
+
+- (id)dequeueObjectWithTimeout:(NSTimeInterval)timeout {
+    if (dispatch_semaphore_wait(_items, LFTimeoutToDispatchTime(timeout)) != 0) return nil;
+    return [self _popObject];
+}
+
+- (NSArray *)dequeueObjectsWithMaxCount:(NSUInteger)maxCount {
+    NSMutableArray *objects = [NSMutableArray new];
+    while (objects.count < maxCount) {
+        if (dispatch_semaphore_wait(_items, DISPATCH_TIME_NOW) != 0) break;
+        [objects addObject:[self _popObject]];
+    }
+    return objects;
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  LFFastEnumerationSnapshot.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifndef LFFastEnumerationSnapshot_h
+#define LFFastEnumerationSnapshot_h
+
+/*
+ Helpers for the thread safe containers to implement NSFastEnumeration over an
+ immutable point-in-time snapshot, so a `for..in` loop takes the lock only once
+ (when the snapshot is taken) and never sees the container changing under it.
+ 
+ Usage:
+ if (state->state == 0) LFFastEnumerationStateSetSnapshot(state, [self snapshot]);
+ return LFFastEnumerationStateNext(state, stackbuf, len);
+ */
+
+/// Stores the snapshot in the enumeration state. The snapshot is autoreleased,
+/// so it lives until the end of the `for..in` loop without retaining it in the state.
+static inline void LFFastEnumerationStateSetSnapshot(NSFastEnumerationState *state, NSArray *snapshot) {
+    if (!snapshot) snapshot = @[];
+    CFAutorelease(CFBridgingRetain(snapshot));
+    state->extra[0] = (unsigned long)(__bridge void *)snapshot;
+    state->mutationsPtr = &state->extra[1]; // the snapshot never mutates
+}
+
+/// Copies the next chunk of the snapshot to `stackbuf`, returns 0 when the enumeration ends.
+static inline NSUInteger LFFastEnumerationStateNext(NSFastEnumerationState *state, id __unsafe_unretained stackbuf[], NSUInteger len) {
+    NSArray *snapshot = (__bridge NSArray *)(void *)state->extra[0];
+    NSUInteger index = state->state;
+    NSUInteger count = MIN(len, snapshot.count - index);
+    if (count == 0) return 0;
+    [snapshot getObjects:stackbuf range:NSMakeRange(index, count)];
+    state->itemsPtr = stackbuf;
+    state->state = index + count;
+    return count;
+}
+
+#endif
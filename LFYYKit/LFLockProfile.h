@@ -0,0 +1,98 @@
+//
+//  LFLockProfile.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+#import "LFLockStatistics.h"
+
+#ifndef LFLockProfile_h
+#define LFLockProfile_h
+
+/*
+ The counters behind LFLockStatistics, used by the thread safe containers.
+
+ A container creates its profile when the instrumentation is first used, and never
+ releases it before dealloc. The profile is published in a `void *` slot with a CAS
+ (release), and the lock paths read the slot with an acquire load, so they see either
+ NULL or a fully initialized profile. The lock functions below only test a pointer and
+ a flag when the profile is nil or disabled, the measuring code is out of line.
+
+ Usage:
+ void *_profile; // ivar, see LFLockProfileGetOrCreate
+ #define LOCK(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
+ __VA_ARGS__; \
+ LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+ */
+@interface LFLockProfile : NSObject {
+    @package
+    BOOL _enabled;
+    uint64_t _holdStart; ///< set by the holder of the exclusive lock, 0 if not measured
+    uint64_t _acquisitions;
+    uint64_t _contended;
+    uint64_t _mainThreadContended;
+    uint64_t _waitTime;
+    uint64_t _mainThreadWaitTime;
+    uint64_t _maxWaitTime;
+    uint64_t _maxHoldTime;
+    uint64_t _histogram[LF_LOCK_HISTOGRAM_BUCKET_COUNT];
+}
+
+/// The profile is registered in the LFLockStatistics registry until dealloc.
+- (instancetype)initWithName:(NSString *)name;
+@property (atomic, copy) NSString *name;
+@property (atomic, getter=isEnabled) BOOL enabled;
+
+- (LFLockStatistics *)statistics;
+- (void)reset;
+
+@end
+
+/// Out of line measuring paths, do not call directly.
+FOUNDATION_EXTERN void _LFLockProfileWaitSemaphore(LFLockProfile *profile, dispatch_semaphore_t lock);
+FOUNDATION_EXTERN void _LFLockProfileSignalSemaphore(LFLockProfile *profile, dispatch_semaphore_t lock);
+FOUNDATION_EXTERN void _LFLockProfileLockRWLock(LFLockProfile *profile, pthread_rwlock_t *lock, BOOL write);
+
+/// Returns the profile published in a slot, or nil.
+static inline __unsafe_unretained LFLockProfile *LFLockProfileLoad(void **slot) {
+    return (__bridge LFLockProfile *)__atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+/**
+ Returns the profile published in a slot. If there's none yet, creates a profile named
+ after the owner, and publishes it retained by the slot; if another thread published one
+ first, that one is returned.
+ */
+FOUNDATION_EXTERN LFLockProfile *LFLockProfileGetOrCreate(void **slot, id owner);
+
+/// Releases the profile published in a slot, call it in the owner's dealloc.
+FOUNDATION_EXTERN void LFLockProfileRelease(void **slot);
+
+static inline BOOL LFLockProfileIsEnabled(__unsafe_unretained LFLockProfile *profile) {
+    return profile && __atomic_load_n(&profile->_enabled, __ATOMIC_RELAXED);
+}
+
+/// Waits for a dispatch semaphore used as an exclusive lock.
+static inline void LFLockProfileWait(__unsafe_unretained LFLockProfile *profile, dispatch_semaphore_t lock) {
+    if (LFLockProfileIsEnabled(profile)) _LFLockProfileWaitSemaphore(profile, lock);
+    else dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
+}
+
+/// Signals a dispatch semaphore taken by `LFLockProfileWait`.
+static inline void LFLockProfileSignal(__unsafe_unretained LFLockProfile *profile, dispatch_semaphore_t lock) {
+    if (profile && profile->_holdStart) _LFLockProfileSignalSemaphore(profile, lock);
+    else dispatch_semaphore_signal(lock);
+}
+
+/// Locks a reader/writer lock, it's unlocked with pthread_rwlock_unlock.
+static inline void LFLockProfileLockRW(__unsafe_unretained LFLockProfile *profile, pthread_rwlock_t *lock, BOOL write) {
+    if (LFLockProfileIsEnabled(profile)) _LFLockProfileLockRWLock(profile, lock, write);
+    else if (write) pthread_rwlock_wrlock(lock);
+    else pthread_rwlock_rdlock(lock);
+}
+
+#endif
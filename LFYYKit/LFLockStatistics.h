@@ -0,0 +1,80 @@
+//
+//  LFLockStatistics.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/// The number of buckets in `waitTimeHistogram`.
+#define LF_LOCK_HISTOGRAM_BUCKET_COUNT 9
+
+/**
+ Lock statistics of an instrumented container, see
+ `-[LFThreadSafeArray setInstrumentationEnabled:]` and
+ `-[LFThreadSafeDictionary setInstrumentationEnabled:]`.
+
+ @discussion An instance is an immutable copy of the counters taken when it was
+ created. The class methods give access to the statistics of every instrumented
+ container alive, so a stalling container can be found without Instruments:
+
+     for (LFLockStatistics *s in [LFLockStatistics allStatistics]) {
+         if (s.mainThreadWaitTime > 0.01) NSLog(@"%@", s);
+     }
+ */
+@interface LFLockStatistics : NSObject
+
+/// The instrumentation name of the container, or nil.
+@property (nonatomic, readonly) NSString *name;
+
+/// The number of times the lock was taken.
+@property (nonatomic, readonly) uint64_t acquisitionCount;
+
+/// The number of times the lock was busy and the caller had to wait.
+@property (nonatomic, readonly) uint64_t contendedCount;
+
+/// The number of contended acquisitions on the main thread.
+@property (nonatomic, readonly) uint64_t mainThreadContendedCount;
+
+/// The total time spent waiting for the lock, in seconds.
+@property (nonatomic, readonly) NSTimeInterval totalWaitTime;
+
+/// The total time the main thread spent waiting for the lock, in seconds.
+@property (nonatomic, readonly) NSTimeInterval mainThreadWaitTime;
+
+/// The longest wait for the lock, in seconds.
+@property (nonatomic, readonly) NSTimeInterval maxWaitTime;
+
+/**
+ The longest time the lock was held, in seconds.
+
+ @discussion Only the exclusive lock is measured: a sharded dictionary, whose stripes
+ are reader/writer locks which may be held by several readers, always reports 0.
+ */
+@property (nonatomic, readonly) NSTimeInterval maxHoldTime;
+
+/**
+ The number of acquisitions in each wait time bucket.
+
+ @discussion The bucket `i` counts the waits shorter than `waitTimeHistogramBounds[i]`,
+ the last bucket counts all longer waits. An uncontended acquisition falls in the first bucket.
+ */
+@property (nonatomic, readonly) NSArray *waitTimeHistogram;
+
+/// The upper bounds of the histogram buckets in seconds (1us, 4us, 16us ... 16ms).
++ (NSArray *)waitTimeHistogramBounds;
+
+#pragma mark - Registry
+
+/// Returns the statistics of every instrumented container alive.
++ (NSArray *)allStatistics;
+
+/// Returns the sum of the statistics of every instrumented container alive (maximums are maximums).
++ (LFLockStatistics *)aggregateStatistics;
+
+/// Resets the counters of every instrumented container alive.
++ (void)resetAllStatistics;
+
+@end
@@ -0,0 +1,252 @@
+//
+//  LFLockStatistics.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFLockStatistics.h"
+#import "LFLockProfile.h"
+#import <mach/mach_time.h>
+
+/// Upper bound of the first histogram bucket, each next bucket is 4 times larger.
+#define HISTOGRAM_FIRST_BOUND_NS 1000ULL
+
+static inline uint64_t LFLockProfileNow(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+static inline void LFLockProfileStoreMax(uint64_t *max, uint64_t value) {
+    uint64_t current = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > current) {
+        if (__atomic_compare_exchange_n(max, &current, value, YES, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+}
+
+static inline NSUInteger LFLockProfileBucket(uint64_t waitTime) {
+    NSUInteger bucket = 0;
+    uint64_t bound = HISTOGRAM_FIRST_BOUND_NS;
+    while (bucket < LF_LOCK_HISTOGRAM_BUCKET_COUNT - 1 && waitTime >= bound) {
+        bucket++;
+        bound *= 4;
+    }
+    return bucket;
+}
+
+static void LFLockProfileRecordWait(LFLockProfile *profile, BOOL contended, uint64_t waitTime) {
+    __atomic_fetch_add(&profile->_acquisitions, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&profile->_histogram[LFLockProfileBucket(waitTime)], 1, __ATOMIC_RELAXED);
+    if (!contended) return;
+    __atomic_fetch_add(&profile->_contended, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&profile->_waitTime, waitTime, __ATOMIC_RELAXED);
+    if (pthread_main_np()) {
+        __atomic_fetch_add(&profile->_mainThreadContended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&profile->_mainThreadWaitTime, waitTime, __ATOMIC_RELAXED);
+    }
+    LFLockProfileStoreMax(&profile->_maxWaitTime, waitTime);
+}
+
+void _LFLockProfileWaitSemaphore(LFLockProfile *profile, dispatch_semaphore_t lock) {
+    BOOL contended = NO;
+    uint64_t waitTime = 0;
+    if (dispatch_semaphore_wait(lock, DISPATCH_TIME_NOW) != 0) {
+        contended = YES;
+        uint64_t start = LFLockProfileNow();
+        dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
+        waitTime = LFLockProfileNow() - start;
+    }
+    LFLockProfileRecordWait(profile, contended, waitTime);
+    profile->_holdStart = LFLockProfileNow();
+}
+
+void _LFLockProfileSignalSemaphore(LFLockProfile *profile, dispatch_semaphore_t lock) {
+    uint64_t holdTime = LFLockProfileNow() - profile->_holdStart;
+    profile->_holdStart = 0;
+    dispatch_semaphore_signal(lock);
+    LFLockProfileStoreMax(&profile->_maxHoldTime, holdTime);
+}
+
+void _LFLockProfileLockRWLock(LFLockProfile *profile, pthread_rwlock_t *lock, BOOL write) {
+    BOOL contended = NO;
+    uint64_t waitTime = 0;
+    if ((write ? pthread_rwlock_trywrlock(lock) : pthread_rwlock_tryrdlock(lock)) != 0) {
+        contended = YES;
+        uint64_t start = LFLockProfileNow();
+        if (write) pthread_rwlock_wrlock(lock);
+        else pthread_rwlock_rdlock(lock);
+        waitTime = LFLockProfileNow() - start;
+    }
+    LFLockProfileRecordWait(profile, contended, waitTime);
+}
+
+
+#pragma mark - Registry
+
+static NSHashTable *LFLockProfileRegistry;
+static dispatch_semaphore_t LFLockProfileRegistryLock;
+
+static void LFLockProfileRegistryInit(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        LFLockProfileRegistry = [NSHashTable weakObjectsHashTable];
+        LFLockProfileRegistryLock = dispatch_semaphore_create(1);
+    });
+}
+
+static NSArray *LFLockProfileRegistryGetProfiles(void) {
+    LFLockProfileRegistryInit();
+    dispatch_semaphore_wait(LFLockProfileRegistryLock, DISPATCH_TIME_FOREVER);
+    NSArray *profiles = LFLockProfileRegistry.allObjects;
+    dispatch_semaphore_signal(LFLockProfileRegistryLock);
+    return profiles;
+}
+
+LFLockProfile *LFLockProfileGetOrCreate(void **slot, id owner) {
+    void *profile = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (profile) return (__bridge LFLockProfile *)profile;
+    NSString *name = [NSString stringWithFormat:@"<%@: %p>", [owner class], owner];
+    void *created = (__bridge_retained void *)[[LFLockProfile alloc] initWithName:name];
+    if (__atomic_compare_exchange_n(slot, &profile, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return (__bridge LFLockProfile *)created;
+    }
+    CFRelease(created); // lost the race, `profile` is the published one
+    return (__bridge LFLockProfile *)profile;
+}
+
+void LFLockProfileRelease(void **slot) {
+    void *profile = __atomic_exchange_n(slot, NULL, __ATOMIC_ACQ_REL);
+    if (profile) CFRelease(profile);
+}
+
+
+@interface LFLockStatistics ()
+@property (nonatomic, readwrite) NSString *name;
+@property (nonatomic, readwrite) uint64_t acquisitionCount;
+@property (nonatomic, readwrite) uint64_t contendedCount;
+@property (nonatomic, readwrite) uint64_t mainThreadContendedCount;
+@property (nonatomic, readwrite) NSTimeInterval totalWaitTime;
+@property (nonatomic, readwrite) NSTimeInterval mainThreadWaitTime;
+@property (nonatomic, readwrite) NSTimeInterval maxWaitTime;
+@property (nonatomic, readwrite) NSTimeInterval maxHoldTime;
+@property (nonatomic, readwrite) NSArray *waitTimeHistogram;
+@end
+
+
+@implementation LFLockProfile
+
+- (instancetype)initWithName:(NSString *)name {
+    self = [super init];
+    if (!self) return nil;
+    self.name = name;
+    LFLockProfileRegistryInit();
+    dispatch_semaphore_wait(LFLockProfileRegistryLock, DISPATCH_TIME_FOREVER);
+    [LFLockProfileRegistry addObject:self];
+    dispatch_semaphore_signal(LFLockProfileRegistryLock);
+    return self;
+}
+
+- (BOOL)isEnabled {
+    return __atomic_load_n(&_enabled, __ATOMIC_RELAXED);
+}
+
+- (void)setEnabled:(BOOL)enabled {
+    __atomic_store_n(&_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+- (LFLockStatistics *)statistics {
+    LFLockStatistics *statistics = [LFLockStatistics new];
+    statistics.name = self.name;
+    statistics.acquisitionCount = __atomic_load_n(&_acquisitions, __ATOMIC_RELAXED);
+    statistics.contendedCount = __atomic_load_n(&_contended, __ATOMIC_RELAXED);
+    statistics.mainThreadContendedCount = __atomic_load_n(&_mainThreadContended, __ATOMIC_RELAXED);
+    statistics.totalWaitTime = __atomic_load_n(&_waitTime, __ATOMIC_RELAXED) / (double)NSEC_PER_SEC;
+    statistics.mainThreadWaitTime = __atomic_load_n(&_mainThreadWaitTime, __ATOMIC_RELAXED) / (double)NSEC_PER_SEC;
+    statistics.maxWaitTime = __atomic_load_n(&_maxWaitTime, __ATOMIC_RELAXED) / (double)NSEC_PER_SEC;
+    statistics.maxHoldTime = __atomic_load_n(&_maxHoldTime, __ATOMIC_RELAXED) / (double)NSEC_PER_SEC;
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:LF_LOCK_HISTOGRAM_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < LF_LOCK_HISTOGRAM_BUCKET_COUNT; i++) {
+        [histogram addObject:@(__atomic_load_n(&_histogram[i], __ATOMIC_RELAXED))];
+    }
+    statistics.waitTimeHistogram = histogram;
+    return statistics;
+}
+
+- (void)reset {
+    __atomic_store_n(&_acquisitions, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_contended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_mainThreadContended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_waitTime, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_mainThreadWaitTime, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_maxWaitTime, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_maxHoldTime, 0, __ATOMIC_RELAXED);
+    for (NSUInteger i = 0; i < LF_LOCK_HISTOGRAM_BUCKET_COUNT; i++) {
+        __atomic_store_n(&_histogram[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+@end
+
+
+@implementation LFLockStatistics
+
++ (NSArray *)waitTimeHistogramBounds {
+    NSMutableArray *bounds = [NSMutableArray arrayWithCapacity:LF_LOCK_HISTOGRAM_BUCKET_COUNT - 1];
+    uint64_t bound = HISTOGRAM_FIRST_BOUND_NS;
+    for (NSUInteger i = 0; i < LF_LOCK_HISTOGRAM_BUCKET_COUNT - 1; i++) {
+        [bounds addObject:@(bound / (double)NSEC_PER_SEC)];
+        bound *= 4;
+    }
+    return bounds;
+}
+
++ (NSArray *)allStatistics {
+    NSMutableArray *statistics = [NSMutableArray new];
+    for (LFLockProfile *profile in LFLockProfileRegistryGetProfiles()) {
+        [statistics addObject:[profile statistics]];
+    }
+    return statistics;
+}
+
++ (LFLockStatistics *)aggregateStatistics {
+    LFLockStatistics *aggregate = [LFLockStatistics new];
+    uint64_t histogram[LF_LOCK_HISTOGRAM_BUCKET_COUNT] = {0};
+    for (LFLockStatistics *s in [self allStatistics]) {
+        aggregate.acquisitionCount += s.acquisitionCount;
+        aggregate.contendedCount += s.contendedCount;
+        aggregate.mainThreadContendedCount += s.mainThreadContendedCount;
+        aggregate.totalWaitTime += s.totalWaitTime;
+        aggregate.mainThreadWaitTime += s.mainThreadWaitTime;
+        aggregate.maxWaitTime = MAX(aggregate.maxWaitTime, s.maxWaitTime);
+        aggregate.maxHoldTime = MAX(aggregate.maxHoldTime, s.maxHoldTime);
+        for (NSUInteger i = 0; i < LF_LOCK_HISTOGRAM_BUCKET_COUNT; i++) {
+            histogram[i] += [s.waitTimeHistogram[i] unsignedLongLongValue];
+        }
+    }
+    NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:LF_LOCK_HISTOGRAM_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < LF_LOCK_HISTOGRAM_BUCKET_COUNT; i++) {
+        [buckets addObject:@(histogram[i])];
+    }
+    aggregate.waitTimeHistogram = buckets;
+    return aggregate;
+}
+
++ (void)resetAllStatistics {
+    for (LFLockProfile *profile in LFLockProfileRegistryGetProfiles()) {
+        [profile reset];
+    }
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> name:%@ acquisitions:%llu contended:%llu (main thread:%llu) wait:%.3fms (main thread:%.3fms) max wait:%.3fms max hold:%.3fms histogram:%@",
+            self.class, self, _name, _acquisitionCount, _contendedCount, _mainThreadContendedCount,
+            _totalWaitTime * 1000, _mainThreadWaitTime * 1000, _maxWaitTime * 1000, _maxHoldTime * 1000,
+            [_waitTimeHistogram componentsJoinedByString:@","]];
+}
+
+@end
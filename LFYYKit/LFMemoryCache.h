@@ -0,0 +1,159 @@
+//
+//  LFMemoryCache.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+/**
+ LFMemoryCache is a fast in-memory cache that stores key-value pairs.
+
+ @discussion Different from NSCache:
+
+ * It uses LRU (least-recently-used) to remove objects, the LRU list is a doubly linked
+   list, so both the lookup and the list update are O(1).
+ * It can be controlled by cost, count, and age (a default age, or a per-entry age).
+ * It can be configured to automatically evict objects when receive memory warning
+   or app enter background.
+ * Evicted objects are released on a background queue by default.
+
+ The entries are distributed across several stripes selected by key hash, each stripe
+ has its own lock and its own LRU list, so lookups from many threads don't serialize.
+ The limits are divided evenly between the stripes, so the eviction order is LRU per
+ stripe, which is close to a global LRU when the keys are well distributed.
+ */
+@interface LFMemoryCache : NSObject
+
+#pragma mark - Attribute
+
+/// The name of the cache. Default is nil.
+@property (copy) NSString *name;
+
+/// The number of objects in the cache (read-only).
+@property (readonly) NSUInteger totalCount;
+
+/// The total cost of objects in the cache (read-only).
+@property (readonly) NSUInteger totalCost;
+
+/// The stripe count of the cache (read-only).
+@property (readonly) NSUInteger shardCount;
+
+#pragma mark - Limit
+
+/**
+ The maximum number of objects the cache should hold.
+
+ @discussion The default value is NSUIntegerMax, which means no limit.
+ This is not a strict limit—if the cache goes over the limit, some objects in the
+ cache could be evicted later in background thread.
+ */
+@property NSUInteger countLimit;
+
+/**
+ The maximum total cost that the cache can hold before it starts evicting objects.
+
+ @discussion The default value is NSUIntegerMax, which means no limit.
+ This is not a strict limit—if the cache goes over the limit, some objects in the
+ cache could be evicted later in background thread.
+ */
+@property NSUInteger costLimit;
+
+/**
+ The default maximum expiry time of objects in cache.
+
+ @discussion The default value is DBL_MAX, which means no limit.
+ An object is never returned after it expires, and is evicted later in background thread.
+ */
+@property NSTimeInterval ageLimit;
+
+/**
+ The auto trim check time interval in seconds. Default is 5.0.
+
+ @discussion The cache holds an internal timer to check whether the cache reaches
+ its limits, and if the limit is reached, it begins to evict objects.
+ */
+@property NSTimeInterval autoTrimInterval;
+
+/// If `YES`, the cache will remove all objects when the app receives a memory warning.
+/// The default value is `YES`.
+@property BOOL shouldRemoveAllObjectsOnMemoryWarning;
+
+/// If `YES`, The cache will remove all objects when the app enter background.
+/// The default value is `YES`.
+@property BOOL shouldRemoveAllObjectsWhenEnteringBackground;
+
+/// A block to be executed when the app receives a memory warning. Default is nil.
+@property (copy) void(^didReceiveMemoryWarningBlock)(LFMemoryCache *cache);
+
+/// A block to be executed when the app enter background. Default is nil.
+@property (copy) void(^didEnterBackgroundBlock)(LFMemoryCache *cache);
+
+/// If `YES`, the evicted objects will be released on main thread, otherwise they are
+/// released on a background queue. Default is NO. Set it to `YES` if the objects
+/// contain instances which should be released on main thread (such as UIView/CALayer).
+@property BOOL releaseOnMainThread;
+
+/// If `YES`, the evicted objects will be released asynchronously to avoid blocking
+/// the access methods. Default is YES.
+@property BOOL releaseAsynchronously;
+
+#pragma mark - Initializer
+
+/// Creates a cache with one stripe per active processor.
+- (instancetype)init;
+
+/**
+ Creates a cache with a specified stripe count.
+
+ @param shardCount Stripe count, will be rounded up to a power of 2 in range [1, 64].
+ Pass 0 to use the active processor count.
+ */
+- (instancetype)initWithShardCount:(NSUInteger)shardCount NS_DESIGNATED_INITIALIZER;
+
+#pragma mark - Access Methods
+
+/// Returns a Boolean value that indicates whether a given key is in cache.
+- (BOOL)containsObjectForKey:(id)key;
+
+/// Returns the value associated with a given key, or nil if absent or expired.
+- (id)objectForKey:(id)key;
+
+/// Sets the value of the specified key in the cache (0 cost).
+/// If the object is nil, the key is removed.
+- (void)setObject:(id)object forKey:(id)key;
+
+/// Sets the value of the specified key in the cache, and associates the key-value
+/// pair with the specified cost. If the object is nil, the key is removed.
+- (void)setObject:(id)object forKey:(id)key withCost:(NSUInteger)cost;
+
+/**
+ Sets the value of the specified key in the cache, with a cost and an expiry time.
+
+ @param object   The object to be stored in the cache. If nil, the key is removed.
+ @param key      The key with which to associate the value. If nil, do nothing.
+ @param cost     The cost with which to associate the key-value pair.
+ @param ageLimit The expiry time of the entry in seconds, pass 0 to use the cache's `ageLimit`.
+ */
+- (void)setObject:(id)object forKey:(id)key withCost:(NSUInteger)cost ageLimit:(NSTimeInterval)ageLimit;
+
+/// Removes the value of the specified key in the cache.
+- (void)removeObjectForKey:(id)key;
+
+/// Empties the cache immediately.
+- (void)removeAllObjects;
+
+#pragma mark - Trim
+
+/// Removes objects from the cache with LRU, until the `totalCount` is below or equal to the specified value.
+- (void)trimToCount:(NSUInteger)count;
+
+/// Removes objects from the cache with LRU, until the `totalCost` is below or equal to the specified value.
+- (void)trimToCost:(NSUInteger)cost;
+
+/// Removes objects from the cache which are expired, or not accessed in the specified time.
+- (void)trimToAge:(NSTimeInterval)age;
+
+@end
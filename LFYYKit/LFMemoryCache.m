@@ -0,0 +1,477 @@
+//
+//  LFMemoryCache.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFMemoryCache.h"
+#import <QuartzCore/QuartzCore.h>
+#import <pthread.h>
+
+#define MAX_SHARD_COUNT 64
+
+static inline dispatch_queue_t LFMemoryCacheGetReleaseQueue() {
+    return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0);
+}
+
+/**
+ A node in linked map.
+ Typically, you should not use this class directly.
+ */
+@interface _LFLinkedMapNode : NSObject {
+    @package
+    __unsafe_unretained _LFLinkedMapNode *_prev; // retained by dic
+    __unsafe_unretained _LFLinkedMapNode *_next; // retained by dic
+    id _key;
+    id _value;
+    NSUInteger _cost;
+    NSTimeInterval _time;   ///< last access time
+    NSTimeInterval _expire; ///< expiry time
+}
+@end
+
+@implementation _LFLinkedMapNode
+@end
+
+
+/**
+ A linked map used by LFMemoryCache, it's one stripe of the cache.
+ It's not thread-safe, the owner should hold `_lock` when accessing it.
+
+ The first object (head) is the most recently used, the last object (tail) is
+ the least recently used, so the LRU operations are all O(1).
+ */
+@interface _LFLinkedMap : NSObject {
+    @package
+    pthread_mutex_t _lock;
+    CFMutableDictionaryRef _dic; // do not set object directly
+    NSUInteger _totalCost;
+    NSUInteger _totalCount;
+    _LFLinkedMapNode *_head; // MRU, do not change it directly
+    _LFLinkedMapNode *_tail; // LRU, do not change it directly
+}
+
+/// Insert a node at head and update the total cost.
+/// Node and node.key should not be nil.
+- (void)insertNodeAtHead:(_LFLinkedMapNode *)node;
+
+/// Bring a inner node to header.
+/// Node should already inside the dic.
+- (void)bringNodeToHead:(_LFLinkedMapNode *)node;
+
+/// Remove a inner node and update the total cost.
+/// Node should already inside the dic.
+- (void)removeNode:(_LFLinkedMapNode *)node;
+
+/// Remove tail node if exist.
+- (_LFLinkedMapNode *)removeTailNode;
+
+/// Remove all node, returns the old storage to be released by the caller.
+- (CFMutableDictionaryRef)removeAll CF_RETURNS_RETAINED;
+
+@end
+
+@implementation _LFLinkedMap
+
+- (instancetype)init {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    return self;
+}
+
+- (void)dealloc {
+    CFRelease(_dic);
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void)insertNodeAtHead:(_LFLinkedMapNode *)node {
+    CFDictionarySetValue(_dic, (__bridge const void *)(node->_key), (__bridge const void *)(node));
+    _totalCost += node->_cost;
+    _totalCount++;
+    if (_head) {
+        node->_next = _head;
+        _head->_prev = node;
+        _head = node;
+    } else {
+        _head = _tail = node;
+    }
+}
+
+- (void)bringNodeToHead:(_LFLinkedMapNode *)node {
+    if (_head == node) return;
+
+    if (_tail == node) {
+        _tail = node->_prev;
+        _tail->_next = nil;
+    } else {
+        node->_next->_prev = node->_prev;
+        node->_prev->_next = node->_next;
+    }
+    node->_next = _head;
+    node->_prev = nil;
+    _head->_prev = node;
+    _head = node;
+}
+
+- (void)removeNode:(_LFLinkedMapNode *)node {
+    CFDictionaryRemoveValue(_dic, (__bridge const void *)(node->_key));
+    _totalCost -= node->_cost;
+    _totalCount--;
+    if (node->_next) node->_next->_prev = node->_prev;
+    if (node->_prev) node->_prev->_next = node->_next;
+    if (_head == node) _head = node->_next;
+    if (_tail == node) _tail = node->_prev;
+}
+
+- (_LFLinkedMapNode *)removeTailNode {
+    if (!_tail) return nil;
+    _LFLinkedMapNode *tail = _tail;
+    CFDictionaryRemoveValue(_dic, (__bridge const void *)(_tail->_key));
+    _totalCost -= _tail->_cost;
+    _totalCount--;
+    if (_head == _tail) {
+        _head = _tail = nil;
+    } else {
+        _tail = _tail->_prev;
+        _tail->_next = nil;
+    }
+    return tail;
+}
+
+- (CFMutableDictionaryRef)removeAll {
+    _totalCost = 0;
+    _totalCount = 0;
+    _head = nil;
+    _tail = nil;
+    if (CFDictionaryGetCount(_dic) == 0) return NULL;
+    CFMutableDictionaryRef holder = _dic;
+    _dic = CFDictionaryCreateMutable(CFAllocatorGetDefault(), 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    return holder;
+}
+
+@end
+
+
+@implementation LFMemoryCache {
+    void **_maps; ///< _LFLinkedMap, retained
+    NSUInteger _shardCount;
+    dispatch_queue_t _queue; ///< trim queue, serial
+}
+
+static inline _LFLinkedMap *LFMemoryCacheMapForKey(void **maps, NSUInteger count, id key) {
+    NSUInteger hash = [key hash];
+    hash ^= hash >> 16; // NSNumber and NSString hashes are poorly distributed in the low bits
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return (__bridge _LFLinkedMap *)maps[hash & (count - 1)];
+}
+
+/// Returns the limit of one stripe.
+static inline NSUInteger LFMemoryCacheShardLimit(NSUInteger limit, NSUInteger count) {
+    if (limit == NSUIntegerMax) return NSUIntegerMax;
+    return (limit + count - 1) / count;
+}
+
+#pragma mark - Private
+
+- (void)_releaseObject:(id)holder {
+    if (!holder) return;
+    if (_releaseAsynchronously) {
+        dispatch_queue_t queue = _releaseOnMainThread ? dispatch_get_main_queue() : LFMemoryCacheGetReleaseQueue();
+        dispatch_async(queue, ^{
+            [holder class]; // hold and release in queue
+        });
+    } else if (_releaseOnMainThread && !pthread_main_np()) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [holder class]; // hold and release in queue
+        });
+    }
+}
+
+- (void)_trimRecursively {
+    __weak typeof(self) _self = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_autoTrimInterval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        __strong typeof(_self) self = _self;
+        if (!self) return;
+        [self _trimInBackground];
+        [self _trimRecursively];
+    });
+}
+
+- (void)_trimInBackground {
+    dispatch_async(_queue, ^{
+        [self trimToCost:self->_costLimit];
+        [self trimToCount:self->_countLimit];
+        [self trimToAge:self->_ageLimit];
+    });
+}
+
+- (void)_appDidReceiveMemoryWarningNotification {
+    if (self.didReceiveMemoryWarningBlock) {
+        self.didReceiveMemoryWarningBlock(self);
+    }
+    if (self.shouldRemoveAllObjectsOnMemoryWarning) {
+        [self removeAllObjects];
+    }
+}
+
+- (void)_appDidEnterBackgroundNotification {
+    if (self.didEnterBackgroundBlock) {
+        self.didEnterBackgroundBlock(self);
+    }
+    if (self.shouldRemoveAllObjectsWhenEnteringBackground) {
+        [self removeAllObjects];
+    }
+}
+
+/// Removes nodes from the tail of every stripe while `condition` returns YES.
+- (void)_trimWithCondition:(BOOL (^)(_LFLinkedMap *map, _LFLinkedMapNode *tail))condition {
+    NSMutableArray *holder = [NSMutableArray new];
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        _LFLinkedMap *map = (__bridge _LFLinkedMap *)_maps[i];
+        pthread_mutex_lock(&map->_lock);
+        while (map->_tail && condition(map, map->_tail)) {
+            _LFLinkedMapNode *node = [map removeTailNode];
+            if (node) [holder addObject:node];
+        }
+        pthread_mutex_unlock(&map->_lock);
+    }
+    if (holder.count) [self _releaseObject:holder];
+}
+
+#pragma mark - Public
+
+- (instancetype)init {
+    return [self initWithShardCount:0];
+}
+
+- (instancetype)initWithShardCount:(NSUInteger)shardCount {
+    self = super.init;
+    if (!self) return nil;
+    if (shardCount == 0) shardCount = [NSProcessInfo processInfo].activeProcessorCount;
+    if (shardCount > MAX_SHARD_COUNT) shardCount = MAX_SHARD_COUNT;
+    NSUInteger count = 1;
+    while (count < shardCount) count <<= 1;
+    _maps = calloc(count, sizeof(void *));
+    if (!_maps) return nil;
+    for (NSUInteger i = 0; i < count; i++) {
+        _maps[i] = (__bridge_retained void *)[_LFLinkedMap new];
+    }
+    _shardCount = count;
+    _queue = dispatch_queue_create("com.laifeng.kit.cache.memory", DISPATCH_QUEUE_SERIAL);
+
+    _countLimit = NSUIntegerMax;
+    _costLimit = NSUIntegerMax;
+    _ageLimit = DBL_MAX;
+    _autoTrimInterval = 5.0;
+    _shouldRemoveAllObjectsOnMemoryWarning = YES;
+    _shouldRemoveAllObjectsWhenEnteringBackground = YES;
+    _releaseOnMainThread = NO;
+    _releaseAsynchronously = YES;
+
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_appDidReceiveMemoryWarningNotification) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_appDidEnterBackgroundNotification) name:UIApplicationDidEnterBackgroundNotification object:nil];
+
+    [self _trimRecursively];
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
+    if (_maps) {
+        for (NSUInteger i = 0; i < _shardCount; i++) {
+            CFRelease(_maps[i]);
+        }
+        free(_maps);
+        _maps = NULL;
+    }
+}
+
+- (NSUInteger)shardCount {
+    return _shardCount;
+}
+
+- (NSUInteger)totalCount {
+    NSUInteger count = 0;
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        _LFLinkedMap *map = (__bridge _LFLinkedMap *)_maps[i];
+        pthread_mutex_lock(&map->_lock);
+        count += map->_totalCount;
+        pthread_mutex_unlock(&map->_lock);
+    }
+    return count;
+}
+
+- (NSUInteger)totalCost {
+    NSUInteger cost = 0;
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        _LFLinkedMap *map = (__bridge _LFLinkedMap *)_maps[i];
+        pthread_mutex_lock(&map->_lock);
+        cost += map->_totalCost;
+        pthread_mutex_unlock(&map->_lock);
+    }
+    return cost;
+}
+
+- (BOOL)containsObjectForKey:(id)key {
+    return [self objectForKey:key] != nil;
+}
+
+- (id)objectForKey:(id)key {
+    if (!key) return nil;
+    _LFLinkedMap *map = LFMemoryCacheMapForKey(_maps, _shardCount, key);
+    id value = nil;
+    _LFLinkedMapNode *expired = nil;
+    pthread_mutex_lock(&map->_lock);
+    _LFLinkedMapNode *node = (__bridge _LFLinkedMapNode *)CFDictionaryGetValue(map->_dic, (__bridge const void *)(key));
+    if (node) {
+        NSTimeInterval now = CACurrentMediaTime();
+        if (node->_expire <= now) {
+            [map removeNode:node];
+            expired = node;
+        } else {
+            node->_time = now;
+            [map bringNodeToHead:node];
+            value = node->_value;
+        }
+    }
+    pthread_mutex_unlock(&map->_lock);
+    [self _releaseObject:expired];
+    return value;
+}
+
+- (void)setObject:(id)object forKey:(id)key {
+    [self setObject:object forKey:key withCost:0 ageLimit:0];
+}
+
+- (void)setObject:(id)object forKey:(id)key withCost:(NSUInteger)cost {
+    [self setObject:object forKey:key withCost:cost ageLimit:0];
+}
+
+- (void)setObject:(id)object forKey:(id)key withCost:(NSUInteger)cost ageLimit:(NSTimeInterval)ageLimit {
+    if (!key) return;
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    if (ageLimit <= 0) ageLimit = _ageLimit;
+    NSUInteger costLimit = LFMemoryCacheShardLimit(_costLimit, _shardCount);
+    NSUInteger countLimit = LFMemoryCacheShardLimit(_countLimit, _shardCount);
+    _LFLinkedMap *map = LFMemoryCacheMapForKey(_maps, _shardCount, key);
+    _LFLinkedMapNode *evicted = nil;
+    BOOL needTrimCost = NO;
+
+    pthread_mutex_lock(&map->_lock);
+    _LFLinkedMapNode *node = (__bridge _LFLinkedMapNode *)CFDictionaryGetValue(map->_dic, (__bridge const void *)(key));
+    NSTimeInterval now = CACurrentMediaTime();
+    if (node) {
+        map->_totalCost -= node->_cost;
+        map->_totalCost += cost;
+        node->_cost = cost;
+        node->_time = now;
+        node->_expire = ageLimit == DBL_MAX ? DBL_MAX : now + ageLimit;
+        node->_value = object;
+        [map bringNodeToHead:node];
+    } else {
+        node = [_LFLinkedMapNode new];
+        node->_cost = cost;
+        node->_time = now;
+        node->_expire = ageLimit == DBL_MAX ? DBL_MAX : now + ageLimit;
+        node->_key = key;
+        node->_value = object;
+        [map insertNodeAtHead:node];
+    }
+    needTrimCost = map->_totalCost > costLimit;
+    if (map->_totalCount > countLimit) {
+        evicted = [map removeTailNode];
+    }
+    pthread_mutex_unlock(&map->_lock);
+
+    [self _releaseObject:evicted];
+    if (needTrimCost) {
+        dispatch_async(_queue, ^{
+            [self trimToCost:self->_costLimit];
+        });
+    }
+}
+
+- (void)removeObjectForKey:(id)key {
+    if (!key) return;
+    _LFLinkedMap *map = LFMemoryCacheMapForKey(_maps, _shardCount, key);
+    pthread_mutex_lock(&map->_lock);
+    _LFLinkedMapNode *node = (__bridge _LFLinkedMapNode *)CFDictionaryGetValue(map->_dic, (__bridge const void *)(key));
+    if (node) [map removeNode:node];
+    pthread_mutex_unlock(&map->_lock);
+    [self _releaseObject:node];
+}
+
+- (void)removeAllObjects {
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        _LFLinkedMap *map = (__bridge _LFLinkedMap *)_maps[i];
+        pthread_mutex_lock(&map->_lock);
+        CFMutableDictionaryRef holder = [map removeAll];
+        pthread_mutex_unlock(&map->_lock);
+        if (holder) [self _releaseObject:CFBridgingRelease(holder)];
+    }
+}
+
+- (void)trimToCount:(NSUInteger)count {
+    if (count == NSUIntegerMax) return;
+    if (count == 0) {
+        [self removeAllObjects];
+        return;
+    }
+    NSUInteger limit = LFMemoryCacheShardLimit(count, _shardCount);
+    [self _trimWithCondition:^BOOL(_LFLinkedMap *map, _LFLinkedMapNode *tail) {
+        return map->_totalCount > limit;
+    }];
+}
+
+- (void)trimToCost:(NSUInteger)cost {
+    if (cost == NSUIntegerMax) return;
+    if (cost == 0) {
+        [self removeAllObjects];
+        return;
+    }
+    NSUInteger limit = LFMemoryCacheShardLimit(cost, _shardCount);
+    [self _trimWithCondition:^BOOL(_LFLinkedMap *map, _LFLinkedMapNode *tail) {
+        return map->_totalCost > limit;
+    }];
+}
+
+- (void)trimToAge:(NSTimeInterval)age {
+    if (age <= 0) {
+        [self removeAllObjects];
+        return;
+    }
+    // The list is ordered by access time, but not by expiry time (the entries may have
+    // their own age limit), so walk the whole list to find the expired entries.
+    NSTimeInterval now = CACurrentMediaTime();
+    NSMutableArray *holder = [NSMutableArray new];
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        _LFLinkedMap *map = (__bridge _LFLinkedMap *)_maps[i];
+        pthread_mutex_lock(&map->_lock);
+        _LFLinkedMapNode *node = map->_tail;
+        while (node) {
+            _LFLinkedMapNode *prev = node->_prev;
+            if (now - node->_time > age || node->_expire <= now) {
+                [holder addObject:node];
+                [map removeNode:node];
+            }
+            node = prev;
+        }
+        pthread_mutex_unlock(&map->_lock);
+    }
+    if (holder.count) [self _releaseObject:holder];
+}
+
+- (NSString *)description {
+    if (_name) return [NSString stringWithFormat:@"<%@: %p> (%@)", self.class, self, _name];
+    else return [NSString stringWithFormat:@"<%@: %p>", self.class, self];
+}
+
+@end
@@ -0,0 +1,36 @@
+//
+//  LFPersistentDictionary.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ An immutable dictionary with cheap updates.
+
+ @discussion The entries are stored in a hash array mapped trie (HAMT), 32 branches
+ per level. An update never changes the receiver: it returns a new dictionary which
+ shares every untouched node with the receiver, so it costs O(log32 n) time and memory
+ instead of the O(n) of `-mutableCopy`. Since it's immutable, a dictionary can be handed
+ to other threads without copying or locking (`-copy` returns the receiver).
+
+ It's a subclass of NSDictionary, so it can be used anywhere an NSDictionary is expected.
+ */
+@interface LFPersistentDictionary : NSDictionary
+
+/// Returns a new dictionary with the key set to the object. If the object is nil, the key is removed.
+- (LFPersistentDictionary *)dictionaryBySettingObject:(id)object forKey:(id <NSCopying>)key;
+
+/// Returns a new dictionary without the key, or the receiver if the key is absent.
+- (LFPersistentDictionary *)dictionaryByRemovingObjectForKey:(id)key;
+
+/// Returns a new dictionary with the entries of another dictionary added.
+- (LFPersistentDictionary *)dictionaryByAddingEntriesFromDictionary:(NSDictionary *)dictionary;
+
+/// Returns a new dictionary without the keys.
+- (LFPersistentDictionary *)dictionaryByRemovingObjectsForKeys:(NSArray *)keys;
+
+@end
@@ -0,0 +1,458 @@
+//
+//  LFPersistentDictionary.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFPersistentDictionary.h"
+
+#define HAMT_BITS 5
+#define HAMT_MASK 0x1f
+#define HAMT_MAX_SHIFT (sizeof(NSUInteger) * 8)
+
+typedef NS_ENUM(uint8_t, LFHAMTSlotType) {
+    LFHAMTSlotTypeEntry = 0,
+    LFHAMTSlotTypeNode,
+    LFHAMTSlotTypeCollision,
+};
+
+/// Base class of the objects stored in a trie node.
+@interface _LFHAMTSlot : NSObject {
+    @package
+    LFHAMTSlotType _type;
+}
+@end
+
+@implementation _LFHAMTSlot
+@end
+
+/// A key-value pair.
+@interface _LFHAMTEntry : _LFHAMTSlot {
+    @package
+    NSUInteger _hash;
+    id _key;
+    id _value;
+}
+@end
+
+@implementation _LFHAMTEntry
+@end
+
+/// Entries whose keys have the same full hash.
+@interface _LFHAMTCollision : _LFHAMTSlot {
+    @package
+    NSUInteger _hash;
+    NSArray *_entries; ///< _LFHAMTEntry
+}
+@end
+
+@implementation _LFHAMTCollision
+@end
+
+/**
+ A trie node, the bitmap tells which of the 32 branches exist, and the slots
+ array only holds the existing ones (in branch order). A node is never
+ mutated after it's shared.
+ */
+@interface _LFHAMTNode : _LFHAMTSlot {
+    @package
+    uint32_t _bitmap;
+    uint32_t _slotCount;
+    void **_slots; ///< _LFHAMTSlot, retained
+}
+@end
+
+@implementation _LFHAMTNode
+
+- (void)dealloc {
+    if (_slots) {
+        for (uint32_t i = 0; i < _slotCount; i++) {
+            CFRelease(_slots[i]);
+        }
+        free(_slots);
+    }
+}
+
+@end
+
+static inline NSUInteger LFHAMTHash(id key) {
+    NSUInteger hash = [key hash];
+    hash *= (NSUInteger)0x9E3779B97F4A7C15ULL; // NSNumber and NSString hashes are poorly distributed
+    return hash ^ (hash >> 29);
+}
+
+static inline uint32_t LFHAMTBit(NSUInteger hash, NSUInteger shift) {
+    return 1u << ((hash >> shift) & HAMT_MASK);
+}
+
+static inline uint32_t LFHAMTPosition(uint32_t bitmap, uint32_t bit) {
+    return (uint32_t)__builtin_popcount(bitmap & (bit - 1));
+}
+
+static inline _LFHAMTSlot *LFHAMTSlotAt(_LFHAMTNode *node, uint32_t position) {
+    return (__bridge _LFHAMTSlot *)node->_slots[position];
+}
+
+static inline NSUInteger LFHAMTSlotHash(_LFHAMTSlot *slot) {
+    if (slot->_type == LFHAMTSlotTypeEntry) return ((_LFHAMTEntry *)slot)->_hash;
+    return ((_LFHAMTCollision *)slot)->_hash;
+}
+
+static _LFHAMTNode *LFHAMTNodeCreate(uint32_t bitmap, uint32_t slotCount) {
+    _LFHAMTNode *node = [_LFHAMTNode new];
+    node->_type = LFHAMTSlotTypeNode;
+    node->_bitmap = bitmap;
+    node->_slotCount = slotCount;
+    node->_slots = slotCount ? calloc(slotCount, sizeof(void *)) : NULL;
+    return node;
+}
+
+/// Returns a copy of the node with the slot at `position` replaced.
+static _LFHAMTNode *LFHAMTNodeReplacing(_LFHAMTNode *node, uint32_t position, _LFHAMTSlot *slot) {
+    _LFHAMTNode *copied = LFHAMTNodeCreate(node->_bitmap, node->_slotCount);
+    for (uint32_t i = 0; i < node->_slotCount; i++) {
+        copied->_slots[i] = (void *)CFBridgingRetain(i == position ? slot : LFHAMTSlotAt(node, i));
+    }
+    return copied;
+}
+
+/// Returns a copy of the node with a new slot inserted for `bit`.
+static _LFHAMTNode *LFHAMTNodeInserting(_LFHAMTNode *node, uint32_t bit, _LFHAMTSlot *slot) {
+    uint32_t position = LFHAMTPosition(node->_bitmap, bit);
+    _LFHAMTNode *copied = LFHAMTNodeCreate(node->_bitmap | bit, node->_slotCount + 1);
+    for (uint32_t i = 0, j = 0; i < copied->_slotCount; i++) {
+        copied->_slots[i] = (void *)CFBridgingRetain(i == position ? slot : LFHAMTSlotAt(node, j++));
+    }
+    return copied;
+}
+
+/// Returns a copy of the node without the slot for `bit`.
+static _LFHAMTNode *LFHAMTNodeRemoving(_LFHAMTNode *node, uint32_t bit) {
+    uint32_t position = LFHAMTPosition(node->_bitmap, bit);
+    _LFHAMTNode *copied = LFHAMTNodeCreate(node->_bitmap & ~bit, node->_slotCount - 1);
+    for (uint32_t i = 0, j = 0; i < node->_slotCount; i++) {
+        if (i == position) continue;
+        copied->_slots[j++] = (void *)CFBridgingRetain(LFHAMTSlotAt(node, i));
+    }
+    return copied;
+}
+
+/// Combines an existing entry (or collision) with a new entry whose key is different.
+static _LFHAMTSlot *LFHAMTMerge(_LFHAMTSlot *slot, _LFHAMTEntry *entry, NSUInteger shift) {
+    NSUInteger slotHash = LFHAMTSlotHash(slot);
+    if (slotHash == entry->_hash || shift >= HAMT_MAX_SHIFT) {
+        _LFHAMTCollision *collision = [_LFHAMTCollision new];
+        collision->_type = LFHAMTSlotTypeCollision;
+        collision->_hash = entry->_hash;
+        if (slot->_type == LFHAMTSlotTypeEntry) {
+            collision->_entries = @[slot, entry];
+        } else {
+            collision->_entries = [((_LFHAMTCollision *)slot)->_entries arrayByAddingObject:entry];
+        }
+        return collision;
+    }
+    uint32_t slotBit = LFHAMTBit(slotHash, shift);
+    uint32_t entryBit = LFHAMTBit(entry->_hash, shift);
+    if (slotBit == entryBit) {
+        _LFHAMTNode *node = LFHAMTNodeCreate(slotBit, 1);
+        node->_slots[0] = (void *)CFBridgingRetain(LFHAMTMerge(slot, entry, shift + HAMT_BITS));
+        return node;
+    }
+    _LFHAMTNode *node = LFHAMTNodeCreate(slotBit | entryBit, 2);
+    BOOL slotFirst = slotBit < entryBit;
+    node->_slots[0] = (void *)CFBridgingRetain(slotFirst ? slot : entry);
+    node->_slots[1] = (void *)CFBridgingRetain(slotFirst ? entry : slot);
+    return node;
+}
+
+static _LFHAMTEntry *LFHAMTFind(_LFHAMTNode *node, id key, NSUInteger hash) {
+    NSUInteger shift = 0;
+    while (node) {
+        uint32_t bit = LFHAMTBit(hash, shift);
+        if (!(node->_bitmap & bit)) return nil;
+        _LFHAMTSlot *slot = LFHAMTSlotAt(node, LFHAMTPosition(node->_bitmap, bit));
+        switch (slot->_type) {
+            case LFHAMTSlotTypeEntry: {
+                _LFHAMTEntry *entry = (_LFHAMTEntry *)slot;
+                if (entry->_hash == hash && (entry->_key == key || [entry->_key isEqual:key])) return entry;
+                return nil;
+            }
+            case LFHAMTSlotTypeCollision: {
+                _LFHAMTCollision *collision = (_LFHAMTCollision *)slot;
+                if (collision->_hash != hash) return nil;
+                for (_LFHAMTEntry *entry in collision->_entries) {
+                    if ([entry->_key isEqual:key]) return entry;
+                }
+                return nil;
+            }
+            case LFHAMTSlotTypeNode: {
+                node = (_LFHAMTNode *)slot;
+                shift += HAMT_BITS;
+            } break;
+        }
+    }
+    return nil;
+}
+
+/// Returns a new node with the entry set, or the same node if nothing changed.
+static _LFHAMTNode *LFHAMTInsert(_LFHAMTNode *node, _LFHAMTEntry *entry, NSUInteger shift, BOOL *added) {
+    uint32_t bit = LFHAMTBit(entry->_hash, shift);
+    if (!(node->_bitmap & bit)) {
+        *added = YES;
+        return LFHAMTNodeInserting(node, bit, entry);
+    }
+    uint32_t position = LFHAMTPosition(node->_bitmap, bit);
+    _LFHAMTSlot *slot = LFHAMTSlotAt(node, position);
+    _LFHAMTSlot *newSlot = nil;
+    switch (slot->_type) {
+        case LFHAMTSlotTypeEntry: {
+            _LFHAMTEntry *old = (_LFHAMTEntry *)slot;
+            if (old->_hash == entry->_hash && [old->_key isEqual:entry->_key]) {
+                if (old->_value == entry->_value) return node;
+                newSlot = entry;
+            } else {
+                *added = YES;
+                newSlot = LFHAMTMerge(old, entry, shift + HAMT_BITS);
+            }
+        } break;
+        case LFHAMTSlotTypeCollision: {
+            _LFHAMTCollision *old = (_LFHAMTCollision *)slot;
+            if (old->_hash != entry->_hash) {
+                *added = YES;
+                newSlot = LFHAMTMerge(old, entry, shift + HAMT_BITS);
+                break;
+            }
+            NSMutableArray *entries = old->_entries.mutableCopy;
+            NSUInteger index = [entries indexOfObjectPassingTest:^BOOL(_LFHAMTEntry *e, NSUInteger idx, BOOL *stop) {
+                return [e->_key isEqual:entry->_key];
+            }];
+            if (index == NSNotFound) {
+                *added = YES;
+                [entries addObject:entry];
+            } else {
+                entries[index] = entry;
+            }
+            _LFHAMTCollision *collision = [_LFHAMTCollision new];
+            collision->_type = LFHAMTSlotTypeCollision;
+            collision->_hash = old->_hash;
+            collision->_entries = entries.copy;
+            newSlot = collision;
+        } break;
+        case LFHAMTSlotTypeNode: {
+            _LFHAMTNode *child = (_LFHAMTNode *)slot;
+            _LFHAMTNode *newChild = LFHAMTInsert(child, entry, shift + HAMT_BITS, added);
+            if (newChild == child) return node;
+            newSlot = newChild;
+        } break;
+    }
+    return LFHAMTNodeReplacing(node, position, newSlot);
+}
+
+/**
+ Removes the key from the node.
+ Returns the same node if the key is absent, nil if the node becomes empty, or the
+ slot which should replace the node in its parent: a node with a single entry (or
+ collision) left is collapsed into that entry, so the trie stays as shallow as possible.
+ */
+static _LFHAMTSlot *LFHAMTRemove(_LFHAMTNode *node, id key, NSUInteger hash, NSUInteger shift, id *removedValue) {
+    uint32_t bit = LFHAMTBit(hash, shift);
+    if (!(node->_bitmap & bit)) return node;
+    uint32_t position = LFHAMTPosition(node->_bitmap, bit);
+    _LFHAMTSlot *slot = LFHAMTSlotAt(node, position);
+    _LFHAMTSlot *newSlot = nil;
+    switch (slot->_type) {
+        case LFHAMTSlotTypeEntry: {
+            _LFHAMTEntry *entry = (_LFHAMTEntry *)slot;
+            if (entry->_hash != hash || ![entry->_key isEqual:key]) return node;
+            *removedValue = entry->_value;
+            newSlot = nil;
+        } break;
+        case LFHAMTSlotTypeCollision: {
+            _LFHAMTCollision *collision = (_LFHAMTCollision *)slot;
+            if (collision->_hash != hash) return node;
+            NSUInteger index = [collision->_entries indexOfObjectPassingTest:^BOOL(_LFHAMTEntry *e, NSUInteger idx, BOOL *stop) {
+                return [e->_key isEqual:key];
+            }];
+            if (index == NSNotFound) return node;
+            *removedValue = ((_LFHAMTEntry *)collision->_entries[index])->_value;
+            NSMutableArray *entries = collision->_entries.mutableCopy;
+            [entries removeObjectAtIndex:index];
+            if (entries.count == 1) {
+                newSlot = entries.firstObject;
+            } else {
+                _LFHAMTCollision *newCollision = [_LFHAMTCollision new];
+                newCollision->_type = LFHAMTSlotTypeCollision;
+                newCollision->_hash = hash;
+                newCollision->_entries = entries.copy;
+                newSlot = newCollision;
+            }
+        } break;
+        case LFHAMTSlotTypeNode: {
+            newSlot = LFHAMTRemove((_LFHAMTNode *)slot, key, hash, shift + HAMT_BITS, removedValue);
+            if (newSlot == slot) return node;
+        } break;
+    }
+
+    if (!newSlot) {
+        if (node->_slotCount == 1) return nil;
+        if (node->_slotCount == 2 && shift > 0) {
+            _LFHAMTSlot *other = LFHAMTSlotAt(node, position == 0 ? 1 : 0);
+            if (other->_type != LFHAMTSlotTypeNode) return other;
+        }
+        return LFHAMTNodeRemoving(node, bit);
+    }
+    if (newSlot->_type != LFHAMTSlotTypeNode && node->_slotCount == 1 && shift > 0) {
+        return newSlot;
+    }
+    return LFHAMTNodeReplacing(node, position, newSlot);
+}
+
+static void LFHAMTEnumerate(_LFHAMTNode *node, void (^block)(_LFHAMTEntry *entry, BOOL *stop), BOOL *stop) {
+    for (uint32_t i = 0; i < node->_slotCount && !*stop; i++) {
+        _LFHAMTSlot *slot = LFHAMTSlotAt(node, i);
+        switch (slot->_type) {
+            case LFHAMTSlotTypeEntry: {
+                block((_LFHAMTEntry *)slot, stop);
+            } break;
+            case LFHAMTSlotTypeCollision: {
+                for (_LFHAMTEntry *entry in ((_LFHAMTCollision *)slot)->_entries) {
+                    block(entry, stop);
+                    if (*stop) break;
+                }
+            } break;
+            case LFHAMTSlotTypeNode: {
+                LFHAMTEnumerate((_LFHAMTNode *)slot, block, stop);
+            } break;
+        }
+    }
+}
+
+
+@implementation LFPersistentDictionary {
+    _LFHAMTNode *_root; ///< nil if empty
+    NSUInteger _count;
+}
+
+#pragma mark - Private
+
+- (instancetype)_initWithRoot:(_LFHAMTNode *)root count:(NSUInteger)count {
+    self = [super init];
+    if (!self) return nil;
+    _root = count ? root : nil;
+    _count = count;
+    return self;
+}
+
+- (void)_enumerateEntriesUsingBlock:(void (^)(_LFHAMTEntry *entry, BOOL *stop))block {
+    if (!_root) return;
+    BOOL stop = NO;
+    LFHAMTEnumerate(_root, block, &stop);
+}
+
+#pragma mark - NSDictionary primitive
+
+- (instancetype)init {
+    return [self _initWithRoot:nil count:0];
+}
+
+- (instancetype)initWithObjects:(const id [])objects forKeys:(const id <NSCopying> [])keys count:(NSUInteger)cnt {
+    _LFHAMTNode *root = LFHAMTNodeCreate(0, 0);
+    NSUInteger count = 0;
+    for (NSUInteger i = 0; i < cnt; i++) {
+        if (!objects[i] || !keys[i]) continue;
+        _LFHAMTEntry *entry = [_LFHAMTEntry new];
+        entry->_key = [(id)keys[i] copyWithZone:NULL];
+        entry->_value = objects[i];
+        entry->_hash = LFHAMTHash(entry->_key);
+        BOOL added = NO;
+        root = LFHAMTInsert(root, entry, 0, &added);
+        if (added) count++;
+    }
+    return [self _initWithRoot:root count:count];
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectForKey:(id)aKey {
+    if (!aKey || !_root) return nil;
+    _LFHAMTEntry *entry = LFHAMTFind(_root, aKey, LFHAMTHash(aKey));
+    return entry ? entry->_value : nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [self.allKeys objectEnumerator];
+}
+
+#pragma mark - NSDictionary
+
+- (NSArray *)allKeys {
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:_count];
+    [self _enumerateEntriesUsingBlock:^(_LFHAMTEntry *entry, BOOL *stop) {
+        [keys addObject:entry->_key];
+    }];
+    return keys;
+}
+
+- (NSArray *)allValues {
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:_count];
+    [self _enumerateEntriesUsingBlock:^(_LFHAMTEntry *entry, BOOL *stop) {
+        [values addObject:entry->_value];
+    }];
+    return values;
+}
+
+- (void)enumerateKeysAndObjectsUsingBlock:(void (^)(id key, id obj, BOOL *stop))block {
+    if (!block) return;
+    [self _enumerateEntriesUsingBlock:^(_LFHAMTEntry *entry, BOOL *stop) {
+        block(entry->_key, entry->_value, stop);
+    }];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+#pragma mark - Persistent update
+
+- (LFPersistentDictionary *)dictionaryBySettingObject:(id)object forKey:(id <NSCopying>)key {
+    if (!key) return self;
+    if (!object) return [self dictionaryByRemovingObjectForKey:key];
+    _LFHAMTEntry *entry = [_LFHAMTEntry new];
+    entry->_key = [(id)key copyWithZone:NULL];
+    entry->_value = object;
+    entry->_hash = LFHAMTHash(entry->_key);
+    BOOL added = NO;
+    _LFHAMTNode *root = LFHAMTInsert(_root ? _root : LFHAMTNodeCreate(0, 0), entry, 0, &added);
+    if (root == _root) return self;
+    return [[LFPersistentDictionary alloc] _initWithRoot:root count:_count + (added ? 1 : 0)];
+}
+
+- (LFPersistentDictionary *)dictionaryByRemovingObjectForKey:(id)key {
+    if (!key || !_root) return self;
+    id removed = nil;
+    _LFHAMTSlot *root = LFHAMTRemove(_root, key, LFHAMTHash(key), 0, &removed);
+    if (root == _root) return self;
+    return [[LFPersistentDictionary alloc] _initWithRoot:(_LFHAMTNode *)root count:_count - 1];
+}
+
+- (LFPersistentDictionary *)dictionaryByAddingEntriesFromDictionary:(NSDictionary *)dictionary {
+    __block LFPersistentDictionary *result = self;
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+        result = [result dictionaryBySettingObject:obj forKey:key];
+    }];
+    return result;
+}
+
+- (LFPersistentDictionary *)dictionaryByRemovingObjectsForKeys:(NSArray *)keys {
+    LFPersistentDictionary *result = self;
+    for (id key in keys) {
+        result = [result dictionaryByRemovingObjectForKey:key];
+    }
+    return result;
+}
+
+@end
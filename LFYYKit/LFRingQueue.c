@@ -0,0 +1,126 @@
+//
+//  LFRingQueue.c
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#include "LFRingQueue.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define LF_CACHE_LINE_SIZE 64
+
+typedef struct {
+    size_t sequence;
+    void *item;
+} LFRingQueueCell;
+
+struct LFRingQueue {
+    LFRingQueueCell *cells;
+    size_t mask;
+    char pad0[LF_CACHE_LINE_SIZE]; // keep the producer and consumer positions in different cache lines
+    size_t enqueuePosition;
+    char pad1[LF_CACHE_LINE_SIZE];
+    size_t dequeuePosition;
+    char pad2[LF_CACHE_LINE_SIZE];
+};
+
+LFRingQueue *LFRingQueueCreate(size_t capacity) {
+    if (capacity < 2) capacity = 2;
+    if (capacity > (SIZE_MAX >> 2)) return NULL;
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    
+    LFRingQueue *queue = calloc(1, sizeof(LFRingQueue));
+    if (!queue) return NULL;
+    queue->cells = calloc(size, sizeof(LFRingQueueCell));
+    if (!queue->cells) {
+        free(queue);
+        return NULL;
+    }
+    for (size_t i = 0; i < size; i++) {
+        queue->cells[i].sequence = i;
+    }
+    queue->mask = size - 1;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return queue;
+}
+
+void LFRingQueueRelease(LFRingQueue *queue) {
+    if (!queue) return;
+    free(queue->cells);
+    free(queue);
+}
+
+size_t LFRingQueueGetCapacity(const LFRingQueue *queue) {
+    return queue->mask + 1;
+}
+
+size_t LFRingQueueGetApproximateCount(const LFRingQueue *queue) {
+    size_t dequeue = __atomic_load_n(&queue->dequeuePosition, __ATOMIC_RELAXED);
+    size_t enqueue = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+    intptr_t count = (intptr_t)(enqueue - dequeue);
+    if (count < 0) return 0;
+    if ((size_t)count > queue->mask + 1) return queue->mask + 1;
+    return (size_t)count;
+}
+
+bool LFRingQueueTryEnqueue(LFRingQueue *queue, void *item) {
+    LFRingQueueCell *cell;
+    size_t position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+        if (diff == 0) {
+            // the slot is free, claim the position
+            if (__atomic_compare_exchange_n(&queue->enqueuePosition, &position, position + 1,
+                                            true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // the slot still holds an item of the previous lap: full
+        } else {
+            position = __atomic_load_n(&queue->enqueuePosition, __ATOMIC_RELAXED);
+        }
+    }
+    cell->item = item;
+    __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool LFRingQueueTryDequeue(LFRingQueue *queue, void **item) {
+    LFRingQueueCell *cell;
+    size_t position = __atomic_load_n(&queue->dequeuePosition, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &queue->cells[position & queue->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+        if (diff == 0) {
+            // the slot is published, claim the position
+            if (__atomic_compare_exchange_n(&queue->dequeuePosition, &position, position + 1,
+                                            true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // the slot is not published yet: empty
+        } else {
+            position = __atomic_load_n(&queue->dequeuePosition, __ATOMIC_RELAXED);
+        }
+    }
+    if (item) *item = cell->item;
+    cell->item = NULL;
+    // free the slot for the producer of the next lap
+    __atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+size_t LFRingQueueTryDequeueBatch(LFRingQueue *queue, void **items, size_t maxCount) {
+    size_t count = 0;
+    while (count < maxCount && LFRingQueueTryDequeue(queue, &items[count])) {
+        count++;
+    }
+    return count;
+}
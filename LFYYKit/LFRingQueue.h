@@ -0,0 +1,57 @@
+//
+//  LFRingQueue.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#ifndef LFRingQueue_h
+#define LFRingQueue_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ A bounded lock-free multi-producer/multi-consumer ring queue of pointers.
+ 
+ @discussion Every slot holds a sequence number, producers and consumers claim
+ a position with a single compare-and-swap and then publish the slot by bumping
+ its sequence, so there is no lock and no allocation after creation.
+ 
+ The queue is plain C (only GCC/Clang atomic builtins), it doesn't retain the items.
+ LFConcurrentQueue is the Objective-C wrapper with object ownership and blocking operations.
+ */
+typedef struct LFRingQueue LFRingQueue;
+
+/// Creates a queue, `capacity` is rounded up to a power of 2 (at least 2).
+/// Returns NULL if an error occurs.
+LFRingQueue *LFRingQueueCreate(size_t capacity);
+
+/// Destroys a queue, the items left in the queue are not touched.
+void LFRingQueueRelease(LFRingQueue *queue);
+
+/// Returns the capacity of the queue.
+size_t LFRingQueueGetCapacity(const LFRingQueue *queue);
+
+/// Returns the number of items in the queue. It's only a hint when other threads are working on the queue.
+size_t LFRingQueueGetApproximateCount(const LFRingQueue *queue);
+
+/// Appends an item, returns false if the queue is full.
+bool LFRingQueueTryEnqueue(LFRingQueue *queue, void *item);
+
+/// Removes the oldest item, returns false if the queue is empty.
+bool LFRingQueueTryDequeue(LFRingQueue *queue, void **item);
+
+/// Removes up to `maxCount` items into `items`, returns the number of removed items.
+size_t LFRingQueueTryDequeueBatch(LFRingQueue *queue, void **items, size_t maxCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,7 +7,78 @@
 //
 
 #import <UIKit/UIKit.h>
+#import "LFLockStatistics.h"
 
+/**
+ A simple implementation of thread safe mutable array.
+ 
+ @discussion By default every access is guarded by a single lock. An array created
+ with `initCopyOnWriteWithArray:` publishes an immutable snapshot after every mutation,
+ and all reads work on the current snapshot without holding the lock, so a long sort
+ or join never stalls the writers. Writes cost O(n) in this mode, use it for arrays
+ which are read much more often than they are mutated.
+ */
 @interface LFThreadSafeArray : NSMutableArray
 
+/**
+ Creates and returns a copy-on-write array.
+ 
+ @param array The initial objects, may be nil.
+ @return A new array, or nil if an error occurs.
+ */
+- (instancetype)initCopyOnWriteWithArray:(NSArray *)array;
+
+/// Whether the array publishes a snapshot after every mutation.
+@property (nonatomic, readonly, getter=isCopyOnWrite) BOOL copyOnWrite;
+
+/**
+ Returns an immutable point-in-time copy of the array.
+ 
+ @discussion It's O(1) for a copy-on-write array, otherwise the array is copied under the lock.
+ */
+- (NSArray *)snapshot;
+
+/**
+ Performs multiple mutations atomically.
+ 
+ @discussion The lock is taken once for the whole block, and other threads never see
+ a half-applied state (a copy-on-write array publishes only one snapshot after the block).
+ The block receives the backing mutable array, which is only valid inside the block.
+ Do not access the receiver itself inside the block, or it will deadlock.
+ 
+ @param block The block to perform the mutations.
+ */
+- (void)performBatchUpdates:(void (^)(NSMutableArray *array))block;
+
+/**
+ Performs multiple reads on a consistent state.
+ 
+ @discussion The block must not mutate the array. A copy-on-write array passes the
+ current snapshot to the block without taking the lock.
+ 
+ @param block The block to perform the reads.
+ */
+- (void)performBatchReads:(void (^)(NSArray *array))block;
+
+#pragma mark - Instrumentation
+
+/**
+ Whether the lock statistics are recorded. Default is NO.
+
+ @discussion When enabled, every lock acquisition records whether the lock was busy,
+ how long the caller waited (and whether it was the main thread), and how long the
+ lock was held. The statistics are also reported by `+[LFLockStatistics allStatistics]`.
+ When disabled, the cost is one branch per lock acquisition.
+ */
+@property (getter=isInstrumentationEnabled) BOOL instrumentationEnabled;
+
+/// The name reported in the statistics. Default is the class name and address of the array.
+@property (copy) NSString *instrumentationName;
+
+/// Returns a copy of the lock statistics recorded since the last reset.
+- (LFLockStatistics *)lockStatistics;
+
+/// Resets the lock statistics.
+- (void)resetLockStatistics;
+
 @end
@@ -7,6 +7,8 @@
 //
 
 #import "LFThreadSafeArray.h"
+#import "LFFastEnumerationSnapshot.h"
+#import "LFLockProfile.h"
 #import <LFCategory/LFCategory.h>
 
 #define INIT(...) self = super.init; \
@@ -17,15 +19,28 @@ _lock = dispatch_semaphore_create(1); \
 return self;
 
 
-#define LOCK(...) dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER); \
+#define LOCK(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
 __VA_ARGS__; \
-dispatch_semaphore_signal(_lock);
+LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+
+#define WRITE(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
+__VA_ARGS__; \
+if (_copyOnWrite) self.publishedSnapshot = [_arr copy]; \
+LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+
+@interface LFThreadSafeArray ()
+/// Current immutable snapshot in copy-on-write mode. The atomic accessor retains
+/// the snapshot for the reader, so the reads never touch the writer's lock.
+@property (atomic, strong) NSArray *publishedSnapshot;
+@end
 
 @implementation LFThreadSafeArray
 
 {
     NSMutableArray *_arr;  //Subclass a class cluster...
     dispatch_semaphore_t _lock;
+    BOOL _copyOnWrite;
+    void *_profile; ///< LFLockProfile, NULL until the instrumentation is first used, see LFLockProfileGetOrCreate
 }
 
 #pragma mark - init
@@ -34,6 +49,10 @@ dispatch_semaphore_signal(_lock);
     INIT(_arr = [[NSMutableArray alloc] init]);
 }
 
+- (void)dealloc {
+    LFLockProfileRelease(&_profile);
+}
+
 - (instancetype)initWithCapacity:(NSUInteger)numItems {
     INIT(_arr = [[NSMutableArray alloc] initWithCapacity:numItems]);
 }
@@ -54,268 +73,339 @@ dispatch_semaphore_signal(_lock);
     INIT(_arr = [[NSMutableArray alloc] initWithContentsOfURL:url]);
 }
 
+- (instancetype)initCopyOnWriteWithArray:(NSArray *)array {
+    INIT(_arr = array ? [[NSMutableArray alloc] initWithArray:array] : [[NSMutableArray alloc] init];
+         _copyOnWrite = YES;
+         self.publishedSnapshot = [_arr copy]);
+}
+
 #pragma mark - method
 
+- (BOOL)isCopyOnWrite {
+    return _copyOnWrite;
+}
+
+- (NSArray *)snapshot {
+    if (_copyOnWrite) return self.publishedSnapshot;
+    LOCK(NSArray * arr = [_arr copy]); return arr;
+}
+
 - (NSUInteger)count {
+    if (_copyOnWrite) return self.snapshot.count;
     LOCK(NSUInteger count = _arr.count); return count;
 }
 
 - (id)objectAtIndex:(NSUInteger)index {
+    if (_copyOnWrite) return [self.snapshot objectAtIndex:index];
     LOCK(id obj = [_arr objectAtIndex:index]); return obj;
 }
 
 - (NSArray *)arrayByAddingObject:(id)anObject {
+    if (_copyOnWrite) return [self.snapshot arrayByAddingObject:anObject];
     LOCK(NSArray * arr = [_arr arrayByAddingObject:anObject]); return arr;
 }
 
 - (NSArray *)arrayByAddingObjectsFromArray:(NSArray *)otherArray {
+    if (_copyOnWrite) return [self.snapshot arrayByAddingObjectsFromArray:otherArray];
     LOCK(NSArray * arr = [_arr arrayByAddingObjectsFromArray:otherArray]); return arr;
 }
 
 - (NSString *)componentsJoinedByString:(NSString *)separator {
+    if (_copyOnWrite) return [self.snapshot componentsJoinedByString:separator];
     LOCK(NSString * str = [_arr componentsJoinedByString:separator]); return str;
 }
 
 - (BOOL)containsObject:(id)anObject {
+    if (_copyOnWrite) return [self.snapshot containsObject:anObject];
     LOCK(BOOL c = [_arr containsObject:anObject]); return c;
 }
 
 - (NSString *)description {
+    if (_copyOnWrite) return self.snapshot.description;
     LOCK(NSString * d = _arr.description); return d;
 }
 
 - (NSString *)descriptionWithLocale:(id)locale {
+    if (_copyOnWrite) return [self.snapshot descriptionWithLocale:locale];
     LOCK(NSString * d = [_arr descriptionWithLocale:locale]); return d;
 }
 
 - (NSString *)descriptionWithLocale:(id)locale indent:(NSUInteger)level {
+    if (_copyOnWrite) return [self.snapshot descriptionWithLocale:locale indent:level];
     LOCK(NSString * d = [_arr descriptionWithLocale:locale indent:level]); return d;
 }
 
 - (id)firstObjectCommonWithArray:(NSArray *)otherArray {
+    if (_copyOnWrite) return [self.snapshot firstObjectCommonWithArray:otherArray];
     LOCK(id o = [_arr firstObjectCommonWithArray:otherArray]); return o;
 }
 
 - (void)getObjects:(id __unsafe_unretained[])objects range:(NSRange)range {
+    if (_copyOnWrite) {
+        [self.snapshot getObjects:objects range:range];
+        return;
+    }
     LOCK([_arr getObjects:objects range:range]);
 }
 
 - (NSUInteger)indexOfObject:(id)anObject {
+    if (_copyOnWrite) return [self.snapshot indexOfObject:anObject];
     LOCK(NSUInteger i = [_arr indexOfObject:anObject]); return i;
 }
 
 - (NSUInteger)indexOfObject:(id)anObject inRange:(NSRange)range {
+    if (_copyOnWrite) return [self.snapshot indexOfObject:anObject inRange:range];
     LOCK(NSUInteger i = [_arr indexOfObject:anObject inRange:range]); return i;
 }
 
 - (NSUInteger)indexOfObjectIdenticalTo:(id)anObject {
+    if (_copyOnWrite) return [self.snapshot indexOfObjectIdenticalTo:anObject];
     LOCK(NSUInteger i = [_arr indexOfObjectIdenticalTo:anObject]); return i;
 }
 
 - (NSUInteger)indexOfObjectIdenticalTo:(id)anObject inRange:(NSRange)range {
+    if (_copyOnWrite) return [self.snapshot indexOfObjectIdenticalTo:anObject inRange:range];
     LOCK(NSUInteger i = [_arr indexOfObjectIdenticalTo:anObject inRange:range]); return i;
 }
 
 - (id)firstObject {
+    if (_copyOnWrite) return self.snapshot.firstObject;
     LOCK(id o = _arr.firstObject); return o;
 }
 
 - (id)lastObject {
+    if (_copyOnWrite) return self.snapshot.lastObject;
     LOCK(id o = _arr.lastObject); return o;
 }
 
 - (NSEnumerator *)objectEnumerator {
-    LOCK(NSEnumerator * e = [_arr objectEnumerator]); return e;
+    return [self.snapshot objectEnumerator];
 }
 
 - (NSEnumerator *)reverseObjectEnumerator {
-    LOCK(NSEnumerator * e = [_arr reverseObjectEnumerator]); return e;
+    return [self.snapshot reverseObjectEnumerator];
 }
 
 - (NSData *)sortedArrayHint {
+    if (_copyOnWrite) return [self.snapshot sortedArrayHint];
     LOCK(NSData * d = [_arr sortedArrayHint]); return d;
 }
 
 - (NSArray *)sortedArrayUsingFunction:(NSInteger (*)(id, id, void *))comparator context:(void *)context {
+    if (_copyOnWrite) return [self.snapshot sortedArrayUsingFunction:comparator context:context];
     LOCK(NSArray * arr = [_arr sortedArrayUsingFunction:comparator context:context]) return arr;
 }
 
 - (NSArray *)sortedArrayUsingFunction:(NSInteger (*)(id, id, void *))comparator context:(void *)context hint:(NSData *)hint {
+    if (_copyOnWrite) return [self.snapshot sortedArrayUsingFunction:comparator context:context hint:hint];
     LOCK(NSArray * arr = [_arr sortedArrayUsingFunction:comparator context:context hint:hint]); return arr;
 }
 
 - (NSArray *)sortedArrayUsingSelector:(SEL)comparator {
+    if (_copyOnWrite) return [self.snapshot sortedArrayUsingSelector:comparator];
     LOCK(NSArray * arr = [_arr sortedArrayUsingSelector:comparator]); return arr;
 }
 
 - (NSArray *)subarrayWithRange:(NSRange)range {
+    if (_copyOnWrite) return [self.snapshot subarrayWithRange:range];
     LOCK(NSArray * arr = [_arr subarrayWithRange:range]) return arr;
 }
 
 - (void)makeObjectsPerformSelector:(SEL)aSelector {
+    if (_copyOnWrite) {
+        [self.snapshot makeObjectsPerformSelector:aSelector];
+        return;
+    }
     LOCK([_arr makeObjectsPerformSelector:aSelector]);
 }
 
 - (void)makeObjectsPerformSelector:(SEL)aSelector withObject:(id)argument {
+    if (_copyOnWrite) {
+        [self.snapshot makeObjectsPerformSelector:aSelector withObject:argument];
+        return;
+    }
     LOCK([_arr makeObjectsPerformSelector:aSelector withObject:argument]);
 }
 
 - (NSArray *)objectsAtIndexes:(NSIndexSet *)indexes {
+    if (_copyOnWrite) return [self.snapshot objectsAtIndexes:indexes];
     LOCK(NSArray * arr = [_arr objectsAtIndexes:indexes]); return arr;
 }
 
 - (id)objectAtIndexedSubscript:(NSUInteger)idx {
+    if (_copyOnWrite) return [self.snapshot objectAtIndexedSubscript:idx];
     LOCK(id o = [_arr objectAtIndexedSubscript:idx]); return o;
 }
 
 - (void)enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+    if (_copyOnWrite) {
+        [self.snapshot enumerateObjectsUsingBlock:block];
+        return;
+    }
     LOCK([_arr enumerateObjectsUsingBlock:block]);
 }
 
 - (void)enumerateObjectsWithOptions:(NSEnumerationOptions)opts usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+    if (_copyOnWrite) {
+        [self.snapshot enumerateObjectsWithOptions:opts usingBlock:block];
+        return;
+    }
     LOCK([_arr enumerateObjectsWithOptions:opts usingBlock:block]);
 }
 
 - (void)enumerateObjectsAtIndexes:(NSIndexSet *)s options:(NSEnumerationOptions)opts usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+    if (_copyOnWrite) {
+        [self.snapshot enumerateObjectsAtIndexes:s options:opts usingBlock:block];
+        return;
+    }
     LOCK([_arr enumerateObjectsAtIndexes:s options:opts usingBlock:block]);
 }
 
 - (NSUInteger)indexOfObjectPassingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexOfObjectPassingTest:predicate];
     LOCK(NSUInteger i = [_arr indexOfObjectPassingTest:predicate]); return i;
 }
 
 - (NSUInteger)indexOfObjectWithOptions:(NSEnumerationOptions)opts passingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexOfObjectWithOptions:opts passingTest:predicate];
     LOCK(NSUInteger i = [_arr indexOfObjectWithOptions:opts passingTest:predicate]); return i;
 }
 
 - (NSUInteger)indexOfObjectAtIndexes:(NSIndexSet *)s options:(NSEnumerationOptions)opts passingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexOfObjectAtIndexes:s options:opts passingTest:predicate];
     LOCK(NSUInteger i = [_arr indexOfObjectAtIndexes:s options:opts passingTest:predicate]); return i;
 }
 
 - (NSIndexSet *)indexesOfObjectsPassingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexesOfObjectsPassingTest:predicate];
     LOCK(NSIndexSet * i = [_arr indexesOfObjectsPassingTest:predicate]); return i;
 }
 
 - (NSIndexSet *)indexesOfObjectsWithOptions:(NSEnumerationOptions)opts passingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexesOfObjectsWithOptions:opts passingTest:predicate];
     LOCK(NSIndexSet * i = [_arr indexesOfObjectsWithOptions:opts passingTest:predicate]); return i;
 }
 
 - (NSIndexSet *)indexesOfObjectsAtIndexes:(NSIndexSet *)s options:(NSEnumerationOptions)opts passingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    if (_copyOnWrite) return [self.snapshot indexesOfObjectsAtIndexes:s options:opts passingTest:predicate];
     LOCK(NSIndexSet * i = [_arr indexesOfObjectsAtIndexes:s options:opts passingTest:predicate]); return i;
 }
 
 - (NSArray *)sortedArrayUsingComparator:(NSComparator)cmptr {
+    if (_copyOnWrite) return [self.snapshot sortedArrayUsingComparator:cmptr];
     LOCK(NSArray * a = [_arr sortedArrayUsingComparator:cmptr]); return a;
 }
 
 - (NSArray *)sortedArrayWithOptions:(NSSortOptions)opts usingComparator:(NSComparator)cmptr {
+    if (_copyOnWrite) return [self.snapshot sortedArrayWithOptions:opts usingComparator:cmptr];
     LOCK(NSArray * a = [_arr sortedArrayWithOptions:opts usingComparator:cmptr]); return a;
 }
 
 - (NSUInteger)indexOfObject:(id)obj inSortedRange:(NSRange)r options:(NSBinarySearchingOptions)opts usingComparator:(NSComparator)cmp {
+    if (_copyOnWrite) return [self.snapshot indexOfObject:obj inSortedRange:r options:opts usingComparator:cmp];
     LOCK(NSUInteger i = [_arr indexOfObject:obj inSortedRange:r options:opts usingComparator:cmp]); return i;
 }
 
 #pragma mark - mutable
 
 - (void)addObject:(id)anObject {
-    LOCK([_arr addObject:anObject]);
+    WRITE([_arr addObject:anObject]);
 }
 
 - (void)insertObject:(id)anObject atIndex:(NSUInteger)index {
-    LOCK([_arr insertObject:anObject atIndex:index]);
+    WRITE([_arr insertObject:anObject atIndex:index]);
 }
 
 - (void)removeLastObject {
-    LOCK([_arr removeLastObject]);
+    WRITE([_arr removeLastObject]);
 }
 
 - (void)removeObjectAtIndex:(NSUInteger)index {
-    LOCK([_arr removeObjectAtIndex:index]);
+    WRITE([_arr removeObjectAtIndex:index]);
 }
 
 - (void)replaceObjectAtIndex:(NSUInteger)index withObject:(id)anObject {
-    LOCK([_arr replaceObjectAtIndex:index withObject:anObject]);
+    WRITE([_arr replaceObjectAtIndex:index withObject:anObject]);
 }
 
 - (void)addObjectsFromArray:(NSArray *)otherArray {
-    LOCK([_arr addObjectsFromArray:otherArray]);
+    WRITE([_arr addObjectsFromArray:otherArray]);
 }
 
 - (void)exchangeObjectAtIndex:(NSUInteger)idx1 withObjectAtIndex:(NSUInteger)idx2 {
-    LOCK([_arr exchangeObjectAtIndex:idx1 withObjectAtIndex:idx2]);
+    WRITE([_arr exchangeObjectAtIndex:idx1 withObjectAtIndex:idx2]);
 }
 
 - (void)removeAllObjects {
-    LOCK([_arr removeAllObjects]);
+    WRITE([_arr removeAllObjects]);
 }
 
 - (void)removeObject:(id)anObject inRange:(NSRange)range {
-    LOCK([_arr removeObject:anObject inRange:range]);
+    WRITE([_arr removeObject:anObject inRange:range]);
 }
 
 - (void)removeObject:(id)anObject {
-    LOCK([_arr removeObject:anObject]);
+    WRITE([_arr removeObject:anObject]);
 }
 
 - (void)removeObjectIdenticalTo:(id)anObject inRange:(NSRange)range {
-    LOCK([_arr removeObjectIdenticalTo:anObject inRange:range]);
+    WRITE([_arr removeObjectIdenticalTo:anObject inRange:range]);
 }
 
 - (void)removeObjectIdenticalTo:(id)anObject {
-    LOCK([_arr removeObjectIdenticalTo:anObject]);
+    WRITE([_arr removeObjectIdenticalTo:anObject]);
 }
 
 - (void)removeObjectsInArray:(NSArray *)otherArray {
-    LOCK([_arr removeObjectsInArray:otherArray]);
+    WRITE([_arr removeObjectsInArray:otherArray]);
 }
 
 - (void)removeObjectsInRange:(NSRange)range {
-    LOCK([_arr removeObjectsInRange:range]);
+    WRITE([_arr removeObjectsInRange:range]);
 }
 
 - (void)replaceObjectsInRange:(NSRange)range withObjectsFromArray:(NSArray *)otherArray range:(NSRange)otherRange {
-    LOCK([_arr replaceObjectsInRange:range withObjectsFromArray:otherArray range:otherRange]);
+    WRITE([_arr replaceObjectsInRange:range withObjectsFromArray:otherArray range:otherRange]);
 }
 
 - (void)replaceObjectsInRange:(NSRange)range withObjectsFromArray:(NSArray *)otherArray {
-    LOCK([_arr replaceObjectsInRange:range withObjectsFromArray:otherArray]);
+    WRITE([_arr replaceObjectsInRange:range withObjectsFromArray:otherArray]);
 }
 
 - (void)setArray:(NSArray *)otherArray {
-    LOCK([_arr setArray:otherArray]);
+    WRITE([_arr setArray:otherArray]);
 }
 
 - (void)sortUsingFunction:(NSInteger (*)(id, id, void *))compare context:(void *)context {
-    LOCK([_arr sortUsingFunction:compare context:context]);
+    WRITE([_arr sortUsingFunction:compare context:context]);
 }
 
 - (void)sortUsingSelector:(SEL)comparator {
-    LOCK([_arr sortUsingSelector:comparator]);
+    WRITE([_arr sortUsingSelector:comparator]);
 }
 
 - (void)insertObjects:(NSArray *)objects atIndexes:(NSIndexSet *)indexes {
-    LOCK([_arr insertObjects:objects atIndexes:indexes]);
+    WRITE([_arr insertObjects:objects atIndexes:indexes]);
 }
 
 - (void)removeObjectsAtIndexes:(NSIndexSet *)indexes {
-    LOCK([_arr removeObjectsAtIndexes:indexes]);
+    WRITE([_arr removeObjectsAtIndexes:indexes]);
 }
 
 - (void)replaceObjectsAtIndexes:(NSIndexSet *)indexes withObjects:(NSArray *)objects {
-    LOCK([_arr replaceObjectsAtIndexes:indexes withObjects:objects]);
+    WRITE([_arr replaceObjectsAtIndexes:indexes withObjects:objects]);
 }
 
 - (void)setObject:(id)obj atIndexedSubscript:(NSUInteger)idx {
-    LOCK([_arr setObject:obj atIndexedSubscript:idx]);
+    WRITE([_arr setObject:obj atIndexedSubscript:idx]);
 }
 
 - (void)sortUsingComparator:(NSComparator)cmptr {
-    LOCK([_arr sortUsingComparator:cmptr]);
+    WRITE([_arr sortUsingComparator:cmptr]);
 }
 
 - (void)sortWithOptions:(NSSortOptions)opts usingComparator:(NSComparator)cmptr {
-    LOCK([_arr sortWithOptions:opts usingComparator:cmptr]);
+    WRITE([_arr sortWithOptions:opts usingComparator:cmptr]);
 }
 
 - (BOOL)isEqualToArray:(NSArray *)otherArray {
@@ -323,16 +413,63 @@ dispatch_semaphore_signal(_lock);
     if ([otherArray isKindOfClass:LFThreadSafeArray.class]) {
         LFThreadSafeArray *other = (id)otherArray;
         BOOL isEqual;
-        dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
-        dispatch_semaphore_wait(other->_lock, DISPATCH_TIME_FOREVER);
+        LFLockProfileWait(LFLockProfileLoad(&_profile), _lock);
+        LFLockProfileWait(LFLockProfileLoad(&other->_profile), other->_lock);
         isEqual = [_arr isEqualToArray:other->_arr];
-        dispatch_semaphore_signal(other->_lock);
-        dispatch_semaphore_signal(_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&other->_profile), other->_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
         return isEqual;
     }
     return NO;
 }
 
+#pragma mark - batch
+
+- (void)performBatchUpdates:(void (^)(NSMutableArray *array))block {
+    if (!block) return;
+    WRITE(block(_arr));
+}
+
+- (void)performBatchReads:(void (^)(NSArray *array))block {
+    if (!block) return;
+    if (_copyOnWrite) {
+        block(self.snapshot);
+        return;
+    }
+    LOCK(block(_arr));
+}
+
+#pragma mark - instrumentation
+
+- (LFLockProfile *)_lockProfile {
+    return LFLockProfileGetOrCreate(&_profile, self);
+}
+
+- (BOOL)isInstrumentationEnabled {
+    return LFLockProfileLoad(&_profile).isEnabled;
+}
+
+- (void)setInstrumentationEnabled:(BOOL)instrumentationEnabled {
+    if (!instrumentationEnabled && !LFLockProfileLoad(&_profile)) return;
+    [self _lockProfile].enabled = instrumentationEnabled;
+}
+
+- (NSString *)instrumentationName {
+    return LFLockProfileLoad(&_profile).name;
+}
+
+- (void)setInstrumentationName:(NSString *)instrumentationName {
+    [self _lockProfile].name = instrumentationName;
+}
+
+- (LFLockStatistics *)lockStatistics {
+    return [[self _lockProfile] statistics];
+}
+
+- (void)resetLockStatistics {
+    [LFLockProfileLoad(&_profile) reset];
+}
+
 #pragma mark - protocol
 
 - (id)copyWithZone:(NSZone *)zone {
@@ -340,6 +477,7 @@ dispatch_semaphore_signal(_lock);
 }
 
 - (id)mutableCopyWithZone:(NSZone *)zone {
+    if (_copyOnWrite) return [[self.class allocWithZone:zone] initCopyOnWriteWithArray:self.snapshot];
     LOCK(id copiedDictionary = [[self.class allocWithZone:zone] initWithArray:_arr]);
     return copiedDictionary;
 }
@@ -347,8 +485,9 @@ dispatch_semaphore_signal(_lock);
 - (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
                                   objects:(id __unsafe_unretained[])stackbuf
                                     count:(NSUInteger)len {
-    LOCK(NSUInteger count = [_arr countByEnumeratingWithState:state objects:stackbuf count:len]);
-    return count;
+    // Enumerate the snapshot taken by the first call, instead of locking for every chunk.
+    if (state->state == 0) LFFastEnumerationStateSetSnapshot(state, self.snapshot);
+    return LFFastEnumerationStateNext(state, stackbuf, len);
 }
 
 - (BOOL)isEqual:(id)object {
@@ -357,17 +496,18 @@ dispatch_semaphore_signal(_lock);
     if ([object isKindOfClass:LFThreadSafeArray.class]) {
         LFThreadSafeArray *other = object;
         BOOL isEqual;
-        dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
-        dispatch_semaphore_wait(other->_lock, DISPATCH_TIME_FOREVER);
+        LFLockProfileWait(LFLockProfileLoad(&_profile), _lock);
+        LFLockProfileWait(LFLockProfileLoad(&other->_profile), other->_lock);
         isEqual = [_arr isEqual:other->_arr];
-        dispatch_semaphore_signal(other->_lock);
-        dispatch_semaphore_signal(_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&other->_profile), other->_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
         return isEqual;
     }
     return NO;
 }
 
 - (NSUInteger)hash {
+    if (_copyOnWrite) return self.snapshot.hash;
     LOCK(NSUInteger hash = [_arr hash]);
     return hash;
 }
@@ -375,43 +515,45 @@ dispatch_semaphore_signal(_lock);
 #pragma mark - custom methods for NSArray(YYAdd)
 
 - (id)randomObject {
+    if (_copyOnWrite) return [self.snapshot lf_randomObject];
     LOCK(id o = [_arr lf_randomObject]) return o;
 }
 
 - (id)objectOrNilAtIndex:(NSUInteger)index {
+    if (_copyOnWrite) return [self.snapshot lf_objectOrNilAtIndex:index];
     LOCK(id o = [_arr lf_objectOrNilAtIndex:index]) return o;
 }
 
 - (void)removeFirstObject {
-    LOCK([_arr lf_removeFirstObject]);
+    WRITE([_arr lf_removeFirstObject]);
 }
 
 - (id)popFirstObject {
-    LOCK(id o = [_arr lf_popFirstObject]) return o;
+    WRITE(id o = [_arr lf_popFirstObject]) return o;
 }
 
 - (id)popLastObject {
-    LOCK(id o = [_arr lf_popLastObject]) return o;
+    WRITE(id o = [_arr lf_popLastObject]) return o;
 }
 
 - (void)appendObjects:(NSArray *)objects {
-    LOCK([_arr appendObjects:objects]);
+    WRITE([_arr appendObjects:objects]);
 }
 
 - (void)prependObjects:(NSArray *)objects {
-    LOCK([_arr lf_prependObjects:objects]);
+    WRITE([_arr lf_prependObjects:objects]);
 }
 
 - (void)insertObjects:(NSArray *)objects atIndex:(NSUInteger)index {
-    LOCK([_arr lf_insertObjects:objects atIndex:index]);
+    WRITE([_arr lf_insertObjects:objects atIndex:index]);
 }
 
 - (void)reverse {
-    LOCK([_arr lf_reverse]);
+    WRITE([_arr lf_reverse]);
 }
 
 - (void)shuffle {
-    LOCK([_arr lf_shuffle]);
+    WRITE([_arr lf_shuffle]);
 }
 
 @end
@@ -7,7 +7,121 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "LFLockStatistics.h"
 
+/**
+ A simple implementation of thread safe mutable dictionary.
+
+ @discussion By default every access is guarded by a single lock. A dictionary
+ created with `initWithShardCount:` distributes its entries across several
+ stripes selected by key hash, each stripe guarded by its own reader/writer lock,
+ so concurrent reads scale across cores and a writer only blocks its own stripe.
+ */
 @interface LFThreadSafeDictionary : NSMutableDictionary
 
+/**
+ Creates and returns a sharded dictionary.
+
+ @discussion Single key access (objectForKey:, setObject:forKey:, removeObjectForKey:...)
+ only locks the stripe which holds the key. Access to the whole dictionary (count,
+ allKeys, enumeration, description...) locks every stripe in order.
+
+ @param shardCount Stripe count, will be rounded up to a power of 2 in range [1, 64].
+ Pass 0 to use the active processor count.
+ @return A new dictionary, or nil if an error occurs.
+ */
+- (instancetype)initWithShardCount:(NSUInteger)shardCount;
+
+/// Stripe count of the dictionary, 0 means the dictionary is guarded by a single lock.
+@property (nonatomic, readonly) NSUInteger shardCount;
+
+/**
+ Creates and returns a dictionary backed by a persistent (immutable) dictionary.
+
+ @discussion Readers never lock: they read the current version, which is published
+ atomically. A writer builds a new version which shares the untouched nodes with the
+ old one (O(log32 n)), and writers are serialized by a lock. `snapshot`, `copy`, the
+ enumerations and the other whole-dictionary reads cost O(1) to start, instead of
+ copying or locking the whole storage.
+
+ Use it for read-mostly dictionaries which are snapshotted or enumerated often.
+
+ @param dictionary The initial entries, may be nil.
+ @return A new dictionary, or nil if an error occurs.
+ */
+- (instancetype)initPersistentWithDictionary:(NSDictionary *)dictionary;
+
+/// Whether the dictionary is backed by a persistent dictionary.
+@property (nonatomic, readonly, getter=isPersistent) BOOL persistent;
+
+/**
+ Returns an immutable copy of the current entries.
+
+ @discussion In persistent mode it's the current version itself (an LFPersistentDictionary),
+ otherwise the entries are copied under the lock.
+ */
+- (NSDictionary *)snapshot;
+
+/**
+ Performs multiple mutations atomically.
+ 
+ @discussion The lock (every stripe in sharded mode) is taken once for the whole block,
+ and other threads never see a half-applied state. The block receives a direct mutable
+ view of the storage, which is only valid inside the block. Do not access the receiver
+ itself inside the block, or it will deadlock.
+ 
+ @param block The block to perform the mutations.
+ */
+- (void)performBatchUpdates:(void (^)(NSMutableDictionary *dictionary))block;
+
+/**
+ Performs multiple reads on a consistent state.
+ 
+ @discussion Same as `performBatchUpdates:`, but the block must not mutate the
+ dictionary, so the stripes are only locked for reading in sharded mode.
+ 
+ @param block The block to perform the reads.
+ */
+- (void)performBatchReads:(void (^)(NSDictionary *dictionary))block;
+
+/**
+ Returns the value associated with a given key, or creates and inserts it.
+ 
+ @discussion If the key is absent, `block` is called to create the value, and the
+ value is inserted into the dictionary if it's not nil. The dictionary is not locked
+ while the block runs. When several threads ask for the same absent key at the same
+ time, only the first one calls the block, the others wait for its result instead of
+ computing the same value again. If the block throws, the exception is raised to
+ the caller which ran it, and the waiting callers get nil.
+ 
+ Do not call this method with the same key inside the block, or it will deadlock.
+ 
+ @param aKey  The key, should not be nil.
+ @param block The block to create the value, it may return nil.
+ @return The existing or the created value.
+ */
+- (id)objectForKey:(id)aKey orInsertUsingBlock:(id (^)(void))block;
+
+#pragma mark - Instrumentation
+
+/**
+ Whether the lock statistics are recorded. Default is NO.
+
+ @discussion When enabled, every lock acquisition records whether the lock was busy,
+ how long the caller waited (and whether it was the main thread), and how long the
+ lock was held. The statistics are also reported by `+[LFLockStatistics allStatistics]`.
+ When disabled, the cost is one branch per lock acquisition.
+ */
+@property (getter=isInstrumentationEnabled) BOOL instrumentationEnabled;
+
+/// The name reported in the statistics. Default is the class name and address of the dictionary.
+@property (copy) NSString *instrumentationName;
+
+/// Returns a copy of the lock statistics recorded since the last reset.
+/// In sharded mode the stripes are reported together, in persistent mode only the writers take the lock.
+- (LFLockStatistics *)lockStatistics;
+
+/// Resets the lock statistics.
+- (void)resetLockStatistics;
+
 @end
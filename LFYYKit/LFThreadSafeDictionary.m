@@ -7,27 +7,251 @@
 //
 
 #import "LFThreadSafeDictionary.h"
+#import "LFFastEnumerationSnapshot.h"
+#import "LFPersistentDictionary.h"
+#import "LFLockProfile.h"
 #import <LFCategory/LFCategory.h>
+#import <pthread.h>
 
 #define INIT(...) self = super.init; \
 if (!self) return nil; \
 __VA_ARGS__; \
 if (!_dic) return nil; \
 _lock = dispatch_semaphore_create(1); \
+_pendingLock = dispatch_semaphore_create(1); \
+_pendingValues = [NSMutableDictionary new]; \
 return self;
 
 
-#define LOCK(...) dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER); \
+#define LOCK(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
 __VA_ARGS__; \
-dispatch_semaphore_signal(_lock);
+LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+
+#define SHARD_LOCK(key, write, ...) LFDictionaryShard *_shard = LFDictionaryShardForKey(_shards, _shardCount, key); \
+LFLockProfileLockRW(LFLockProfileLoad(&_profile), &_shard->lock, write); \
+NSMutableDictionary *_sdic = (__bridge NSMutableDictionary *)_shard->dic; \
+__VA_ARGS__; \
+pthread_rwlock_unlock(&_shard->lock);
+
+#define SHARD_READ(key, ...) SHARD_LOCK(key, NO, __VA_ARGS__)
+#define SHARD_WRITE(key, ...) SHARD_LOCK(key, YES, __VA_ARGS__)
+
+#define SHARD_READ_ALL(...) LFDictionaryShardsLock(_shards, _shardCount, LFLockProfileLoad(&_profile), NO); \
+__VA_ARGS__; \
+LFDictionaryShardsUnlock(_shards, _shardCount);
+
+#define SHARD_WRITE_ALL(...) LFDictionaryShardsLock(_shards, _shardCount, LFLockProfileLoad(&_profile), YES); \
+__VA_ARGS__; \
+LFDictionaryShardsUnlock(_shards, _shardCount);
+
+#define PERSISTENT_WRITE(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
+LFPersistentDictionary *_root = self.publishedRoot; \
+__VA_ARGS__; \
+self.publishedRoot = _root; \
+LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+
+#define MAX_SHARD_COUNT 64
+
+typedef struct {
+    pthread_rwlock_t lock;
+    void *dic; ///< NSMutableDictionary, retained
+} LFDictionaryShard;
+
+static inline LFDictionaryShard *LFDictionaryShardForKey(LFDictionaryShard *shards, NSUInteger count, id key) {
+    NSUInteger hash = [key hash];
+    hash ^= hash >> 16; // NSNumber and NSString hashes are poorly distributed in the low bits
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return &shards[hash & (count - 1)];
+}
+
+/// Always lock in index order, so the whole-dictionary operations never deadlock each other.
+static inline void LFDictionaryShardsLock(LFDictionaryShard *shards, NSUInteger count, __unsafe_unretained LFLockProfile *profile, BOOL write) {
+    for (NSUInteger i = 0; i < count; i++) {
+        LFLockProfileLockRW(profile, &shards[i].lock, write);
+    }
+}
+
+static inline void LFDictionaryShardsUnlock(LFDictionaryShard *shards, NSUInteger count) {
+    for (NSUInteger i = count; i > 0; i--) {
+        pthread_rwlock_unlock(&shards[i - 1].lock);
+    }
+}
+
+/**
+ A mutable view of all stripes, used by the batch methods while every stripe
+ is locked by the owner. It only implements the primitive methods of
+ NSMutableDictionary, all others are derived from them by Foundation.
+ */
+@interface _LFShardedDictionaryView : NSMutableDictionary
+- (instancetype)initWithShards:(LFDictionaryShard *)shards count:(NSUInteger)count;
+@end
+
+@implementation _LFShardedDictionaryView {
+    LFDictionaryShard *_shards;
+    NSUInteger _shardCount;
+}
+
+- (instancetype)initWithShards:(LFDictionaryShard *)shards count:(NSUInteger)count {
+    self = [super init];
+    _shards = shards;
+    _shardCount = count;
+    return self;
+}
+
+- (NSUInteger)count {
+    NSUInteger c = 0;
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        c += ((__bridge NSMutableDictionary *)_shards[i].dic).count;
+    }
+    return c;
+}
+
+- (id)objectForKey:(id)aKey {
+    return [(__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, aKey)->dic objectForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    NSMutableArray *keys = [NSMutableArray new];
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        [keys addObjectsFromArray:((__bridge NSMutableDictionary *)_shards[i].dic).allKeys];
+    }
+    return [keys objectEnumerator];
+}
+
+- (void)setObject:(id)anObject forKey:(id <NSCopying>)aKey {
+    [(__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, aKey)->dic setObject:anObject forKey:aKey];
+}
+
+- (void)removeObjectForKey:(id)aKey {
+    [(__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, aKey)->dic removeObjectForKey:aKey];
+}
+
+- (void)removeAllObjects {
+    for (NSUInteger i = 0; i < _shardCount; i++) {
+        [(__bridge NSMutableDictionary *)_shards[i].dic removeAllObjects];
+    }
+}
+
+@end
+
+/// A persistent dictionary is immutable, so it's shared instead of copied.
+static inline LFPersistentDictionary *LFPersistentDictionaryWithDictionary(NSDictionary *dictionary) {
+    if ([dictionary isKindOfClass:LFPersistentDictionary.class]) return (LFPersistentDictionary *)dictionary;
+    return [[LFPersistentDictionary alloc] initWithDictionary:dictionary ? dictionary : @{}];
+}
+
+/**
+ A mutable view of a persistent dictionary, used by `performBatchUpdates:` in
+ persistent mode. Every mutation replaces the root, which is published by the
+ owner once the block returns.
+ */
+@interface _LFPersistentDictionaryView : NSMutableDictionary {
+    @package
+    LFPersistentDictionary *_root;
+}
+@end
+
+@implementation _LFPersistentDictionaryView
+
+- (NSUInteger)count {
+    return _root.count;
+}
+
+- (id)objectForKey:(id)aKey {
+    return [_root objectForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [_root keyEnumerator];
+}
+
+- (void)setObject:(id)anObject forKey:(id <NSCopying>)aKey {
+    _root = [_root dictionaryBySettingObject:anObject forKey:aKey];
+}
+
+- (void)removeObjectForKey:(id)aKey {
+    _root = [_root dictionaryByRemovingObjectForKey:aKey];
+}
+
+- (void)removeAllObjects {
+    _root = [LFPersistentDictionary new];
+}
+
+@end
+
+/// A value which is being created by `objectForKey:orInsertUsingBlock:`.
+@interface _LFDictionaryPendingValue : NSObject {
+    @package
+    dispatch_group_t _group; ///< left when the value is created
+    id _value;
+}
+@end
+
+@implementation _LFDictionaryPendingValue
+@end
+
+@interface LFThreadSafeDictionary ()
+/// The current version in persistent mode, replaced by writers under the lock.
+@property (atomic, strong) LFPersistentDictionary *publishedRoot;
+@end
 
 @implementation LFThreadSafeDictionary{
     NSMutableDictionary *_dic;  //Subclass a class cluster...
     dispatch_semaphore_t _lock;
+    LFDictionaryShard *_shards; ///< nil if not sharded
+    NSUInteger _shardCount;
+    BOOL _persistent;
+    void *_profile; ///< LFLockProfile, NULL until the instrumentation is first used, see LFLockProfileGetOrCreate
+    
+    dispatch_semaphore_t _pendingLock; ///< lock for _pendingValues
+    NSMutableDictionary *_pendingValues; ///< key -> _LFDictionaryPendingValue
 }
 
 #pragma mark - init
 
+- (instancetype)initWithShardCount:(NSUInteger)shardCount {
+    self = super.init;
+    if (!self) return nil;
+    if (shardCount == 0) shardCount = [NSProcessInfo processInfo].activeProcessorCount;
+    if (shardCount > MAX_SHARD_COUNT) shardCount = MAX_SHARD_COUNT;
+    NSUInteger count = 1;
+    while (count < shardCount) count <<= 1;
+    _shards = calloc(count, sizeof(LFDictionaryShard));
+    if (!_shards) return nil;
+    for (NSUInteger i = 0; i < count; i++) {
+        pthread_rwlock_init(&_shards[i].lock, NULL);
+        _shards[i].dic = (__bridge_retained void *)[NSMutableDictionary new];
+    }
+    _shardCount = count;
+    _pendingLock = dispatch_semaphore_create(1);
+    _pendingValues = [NSMutableDictionary new];
+    return self;
+}
+
+- (instancetype)initPersistentWithDictionary:(NSDictionary *)dictionary {
+    self = super.init;
+    if (!self) return nil;
+    _persistent = YES;
+    _lock = dispatch_semaphore_create(1);
+    self.publishedRoot = LFPersistentDictionaryWithDictionary(dictionary);
+    _pendingLock = dispatch_semaphore_create(1);
+    _pendingValues = [NSMutableDictionary new];
+    return self;
+}
+
+- (void)dealloc {
+    LFLockProfileRelease(&_profile);
+    if (_shards) {
+        for (NSUInteger i = 0; i < _shardCount; i++) {
+            pthread_rwlock_destroy(&_shards[i].lock);
+            CFRelease(_shards[i].dic);
+        }
+        free(_shards);
+        _shards = NULL;
+    }
+}
+
 - (instancetype)init {
     INIT(_dic = [[NSMutableDictionary alloc] init]);
 }
@@ -53,45 +277,98 @@ dispatch_semaphore_signal(_lock);
 }
 
 
+#pragma mark - private
+
+/// Returns an immutable copy of all entries, the stripes are merged in sharded mode.
+- (NSDictionary *)_dictionaryCopy {
+    if (_persistent) return self.publishedRoot;
+    if (_shards) {
+        SHARD_READ_ALL(NSMutableDictionary * dic = [NSMutableDictionary new];
+                       for (NSUInteger i = 0; i < _shardCount; i++) {
+                           [dic addEntriesFromDictionary:(__bridge NSMutableDictionary *)_shards[i].dic];
+                       }
+        ) return dic;
+    }
+    LOCK(NSDictionary * dic = [_dic copy]); return dic;
+}
+
+- (void)_shardedSetEntriesFromDictionary:(NSDictionary *)dictionary {
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id obj, BOOL *stop) {
+        NSMutableDictionary *dic = (__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, key)->dic;
+        [dic setObject:obj forKey:key];
+    }];
+}
+
 #pragma mark - method
 
+- (NSUInteger)shardCount {
+    return _shardCount;
+}
+
+- (BOOL)isPersistent {
+    return _persistent;
+}
+
+- (NSDictionary *)snapshot {
+    return [self _dictionaryCopy];
+}
+
 - (NSUInteger)count {
+    if (_persistent) return self.publishedRoot.count;
+    if (_shards) {
+        SHARD_READ_ALL(NSUInteger c = 0;
+                       for (NSUInteger i = 0; i < _shardCount; i++) {
+                           c += ((__bridge NSMutableDictionary *)_shards[i].dic).count;
+                       }
+        ) return c;
+    }
     LOCK(NSUInteger c = _dic.count); return c;
 }
 
 - (id)objectForKey:(id)aKey {
+    if (_persistent) return [self.publishedRoot objectForKey:aKey];
+    if (_shards) {
+        SHARD_READ(aKey, id o = [_sdic objectForKey:aKey]); return o;
+    }
     LOCK(id o = [_dic objectForKey:aKey]); return o;
 }
 
 - (NSEnumerator *)keyEnumerator {
-    LOCK(NSEnumerator * e = [_dic keyEnumerator]); return e;
+    return [self.allKeys objectEnumerator];
 }
 
 - (NSArray *)allKeys {
+    if (!_dic) return [[self _dictionaryCopy] allKeys];
     LOCK(NSArray * a = [_dic allKeys]); return a;
 }
 
 - (NSArray *)allKeysForObject:(id)anObject {
+    if (!_dic) return [[self _dictionaryCopy] allKeysForObject:anObject];
     LOCK(NSArray * a = [_dic allKeysForObject:anObject]); return a;
 }
 
 - (NSArray *)allValues {
+    if (!_dic) return [[self _dictionaryCopy] allValues];
     LOCK(NSArray * a = [_dic allValues]); return a;
 }
 
 - (NSString *)description {
+    if (!_dic) return [[self _dictionaryCopy] description];
     LOCK(NSString * d = [_dic description]); return d;
 }
 
 - (NSString *)descriptionInStringsFileFormat {
+    if (!_dic) return [[self _dictionaryCopy] descriptionInStringsFileFormat];
     LOCK(NSString * d = [_dic descriptionInStringsFileFormat]); return d;
 }
 
 - (NSString *)descriptionWithLocale:(id)locale {
+    if (!_dic) return [[self _dictionaryCopy] descriptionWithLocale:locale];
     LOCK(NSString * d = [_dic descriptionWithLocale:locale]); return d;
 }
 
 - (NSString *)descriptionWithLocale:(id)locale indent:(NSUInteger)level {
+    if (!_dic) return [[self _dictionaryCopy] descriptionWithLocale:locale indent:level];
     LOCK(NSString * d = [_dic descriptionWithLocale:locale indent:level]); return d;
 }
 
@@ -100,91 +377,287 @@ dispatch_semaphore_signal(_lock);
     
     if ([otherDictionary isKindOfClass:LFThreadSafeDictionary.class]) {
         LFThreadSafeDictionary *other = (id)otherDictionary;
+        if (!_dic || !other->_dic) {
+            return [[self _dictionaryCopy] isEqualToDictionary:[other _dictionaryCopy]];
+        }
         BOOL isEqual;
-        dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
-        dispatch_semaphore_wait(other->_lock, DISPATCH_TIME_FOREVER);
+        LFLockProfileWait(LFLockProfileLoad(&_profile), _lock);
+        LFLockProfileWait(LFLockProfileLoad(&other->_profile), other->_lock);
         isEqual = [_dic isEqual:other->_dic];
-        dispatch_semaphore_signal(other->_lock);
-        dispatch_semaphore_signal(_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&other->_profile), other->_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
         return isEqual;
     }
     return NO;
 }
 
 - (NSEnumerator *)objectEnumerator {
-    LOCK(NSEnumerator * e = [_dic objectEnumerator]); return e;
+    return [self.allValues objectEnumerator];
 }
 
 - (NSArray *)objectsForKeys:(NSArray *)keys notFoundMarker:(id)marker {
+    if (!_dic) return [[self _dictionaryCopy] objectsForKeys:keys notFoundMarker:marker];
     LOCK(NSArray * a = [_dic objectsForKeys:keys notFoundMarker:marker]); return a;
 }
 
 - (NSArray *)keysSortedByValueUsingSelector:(SEL)comparator {
+    if (!_dic) return [[self _dictionaryCopy] keysSortedByValueUsingSelector:comparator];
     LOCK(NSArray * a = [_dic keysSortedByValueUsingSelector:comparator]); return a;
 }
 
 - (void)getObjects:(id __unsafe_unretained[])objects andKeys:(id __unsafe_unretained[])keys {
+    if (!_dic) {
+        [[self _dictionaryCopy] getObjects:objects andKeys:keys];
+        return;
+    }
     LOCK([_dic getObjects:objects andKeys:keys]);
 }
 
 - (id)objectForKeyedSubscript:(id)key {
+    if (_persistent) return [self.publishedRoot objectForKey:key];
+    if (_shards) {
+        SHARD_READ(key, id o = [_sdic objectForKeyedSubscript:key]); return o;
+    }
     LOCK(id o = [_dic objectForKeyedSubscript:key]); return o;
 }
 
 - (void)enumerateKeysAndObjectsUsingBlock:(void (^)(id key, id obj, BOOL *stop))block {
+    if (!_dic) {
+        [[self _dictionaryCopy] enumerateKeysAndObjectsUsingBlock:block];
+        return;
+    }
     LOCK([_dic enumerateKeysAndObjectsUsingBlock:block]);
 }
 
 - (void)enumerateKeysAndObjectsWithOptions:(NSEnumerationOptions)opts usingBlock:(void (^)(id key, id obj, BOOL *stop))block {
+    if (!_dic) {
+        [[self _dictionaryCopy] enumerateKeysAndObjectsWithOptions:opts usingBlock:block];
+        return;
+    }
     LOCK([_dic enumerateKeysAndObjectsWithOptions:opts usingBlock:block]);
 }
 
 - (NSArray *)keysSortedByValueUsingComparator:(NSComparator)cmptr {
+    if (!_dic) return [[self _dictionaryCopy] keysSortedByValueUsingComparator:cmptr];
     LOCK(NSArray * a = [_dic keysSortedByValueUsingComparator:cmptr]); return a;
 }
 
 - (NSArray *)keysSortedByValueWithOptions:(NSSortOptions)opts usingComparator:(NSComparator)cmptr {
+    if (!_dic) return [[self _dictionaryCopy] keysSortedByValueWithOptions:opts usingComparator:cmptr];
     LOCK(NSArray * a = [_dic keysSortedByValueWithOptions:opts usingComparator:cmptr]); return a;
 }
 
 - (NSSet *)keysOfEntriesPassingTest:(BOOL (^)(id key, id obj, BOOL *stop))predicate {
+    if (!_dic) return [[self _dictionaryCopy] keysOfEntriesPassingTest:predicate];
     LOCK(NSSet * a = [_dic keysOfEntriesPassingTest:predicate]); return a;
 }
 
 - (NSSet *)keysOfEntriesWithOptions:(NSEnumerationOptions)opts passingTest:(BOOL (^)(id key, id obj, BOOL *stop))predicate {
+    if (!_dic) return [[self _dictionaryCopy] keysOfEntriesWithOptions:opts passingTest:predicate];
     LOCK(NSSet * a = [_dic keysOfEntriesWithOptions:opts passingTest:predicate]); return a;
 }
 
 #pragma mark - mutable
 
 - (void)removeObjectForKey:(id)aKey {
+    if (_persistent) {
+        PERSISTENT_WRITE(_root = [_root dictionaryByRemovingObjectForKey:aKey]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE(aKey, [_sdic removeObjectForKey:aKey]);
+        return;
+    }
     LOCK([_dic removeObjectForKey:aKey]);
 }
 
 - (void)setObject:(id)anObject forKey:(id <NSCopying> )aKey {
+    if (_persistent) {
+        // Throws before taking the lock, as NSMutableDictionary does.
+        if (!aKey) [NSException raise:NSInvalidArgumentException format:@"*** %s: key cannot be nil", __PRETTY_FUNCTION__];
+        if (!anObject) [NSException raise:NSInvalidArgumentException format:@"*** %s: object cannot be nil (key: %@)", __PRETTY_FUNCTION__, aKey];
+        PERSISTENT_WRITE(_root = [_root dictionaryBySettingObject:anObject forKey:aKey]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE(aKey, [_sdic setObject:anObject forKey:aKey]);
+        return;
+    }
     LOCK([_dic setObject:anObject forKey:aKey]);
 }
 
 - (void)addEntriesFromDictionary:(NSDictionary *)otherDictionary {
+    if (_persistent) {
+        PERSISTENT_WRITE(_root = [_root dictionaryByAddingEntriesFromDictionary:otherDictionary]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL([self _shardedSetEntriesFromDictionary:otherDictionary]);
+        return;
+    }
     LOCK([_dic addEntriesFromDictionary:otherDictionary]);
 }
 
 - (void)removeAllObjects {
+    if (_persistent) {
+        PERSISTENT_WRITE(_root = [LFPersistentDictionary new]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL(for (NSUInteger i = 0; i < _shardCount; i++) {
+                            [(__bridge NSMutableDictionary *)_shards[i].dic removeAllObjects];
+                        }
+        ) return;
+    }
     LOCK([_dic removeAllObjects]);
 }
 
 - (void)removeObjectsForKeys:(NSArray *)keyArray {
+    if (_persistent) {
+        PERSISTENT_WRITE(_root = [_root dictionaryByRemovingObjectsForKeys:keyArray]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL(for (id key in keyArray) {
+                            [(__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, key)->dic removeObjectForKey:key];
+                        }
+        ) return;
+    }
     LOCK([_dic removeObjectsForKeys:keyArray]);
 }
 
 - (void)setDictionary:(NSDictionary *)otherDictionary {
+    if (_persistent) {
+        PERSISTENT_WRITE(_root = LFPersistentDictionaryWithDictionary(otherDictionary));
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL(for (NSUInteger i = 0; i < _shardCount; i++) {
+                            [(__bridge NSMutableDictionary *)_shards[i].dic removeAllObjects];
+                        }
+                        [self _shardedSetEntriesFromDictionary:otherDictionary];
+        ) return;
+    }
     LOCK([_dic setDictionary:otherDictionary]);
 }
 
 - (void)setObject:(id)obj forKeyedSubscript:(id <NSCopying> )key {
+    if (_persistent) {
+        if (!key) return;
+        PERSISTENT_WRITE(_root = [_root dictionaryBySettingObject:obj forKey:key]);
+        return;
+    }
+    if (_shards) {
+        SHARD_WRITE(key, [_sdic setObject:obj forKeyedSubscript:key]);
+        return;
+    }
     LOCK([_dic setObject:obj forKeyedSubscript:key]);
 }
 
+#pragma mark - get or create
+
+- (id)objectForKey:(id)aKey orInsertUsingBlock:(id (^)(void))block {
+    if (!aKey) return nil;
+    id object = [self objectForKey:aKey];
+    if (object || !block) return object;
+    
+    // Check again under the pending lock: the value may be inserted by another thread
+    // since the first lookup. The storage lock is always taken after the pending lock.
+    dispatch_semaphore_wait(_pendingLock, DISPATCH_TIME_FOREVER);
+    object = [self objectForKey:aKey];
+    if (object) {
+        dispatch_semaphore_signal(_pendingLock);
+        return object;
+    }
+    _LFDictionaryPendingValue *pending = _pendingValues[aKey];
+    if (pending) {
+        dispatch_semaphore_signal(_pendingLock);
+        dispatch_group_wait(pending->_group, DISPATCH_TIME_FOREVER);
+        return pending->_value;
+    }
+    pending = [_LFDictionaryPendingValue new];
+    pending->_group = dispatch_group_create();
+    dispatch_group_enter(pending->_group);
+    _pendingValues[aKey] = pending;
+    dispatch_semaphore_signal(_pendingLock);
+    
+    // Unregister and wake the waiters even if the block throws, they get nil then.
+    @try {
+        object = block();
+        // Insert before unregistering, so a new caller finds either the value or the pending one.
+        if (object) [self setObject:object forKey:aKey];
+    } @finally {
+        dispatch_semaphore_wait(_pendingLock, DISPATCH_TIME_FOREVER);
+        [_pendingValues removeObjectForKey:aKey];
+        dispatch_semaphore_signal(_pendingLock);
+        pending->_value = object;
+        dispatch_group_leave(pending->_group);
+    }
+    return object;
+}
+
+#pragma mark - batch
+
+- (void)performBatchUpdates:(void (^)(NSMutableDictionary *dictionary))block {
+    if (!block) return;
+    if (_persistent) {
+        PERSISTENT_WRITE(_LFPersistentDictionaryView *view = [_LFPersistentDictionaryView new];
+                         view->_root = _root;
+                         block(view);
+                         _root = view->_root;
+        ) return;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL(block([[_LFShardedDictionaryView alloc] initWithShards:_shards count:_shardCount]));
+        return;
+    }
+    LOCK(block(_dic));
+}
+
+- (void)performBatchReads:(void (^)(NSDictionary *dictionary))block {
+    if (!block) return;
+    if (_persistent) {
+        block(self.publishedRoot); // immutable, no lock needed
+        return;
+    }
+    if (_shards) {
+        SHARD_READ_ALL(block([[_LFShardedDictionaryView alloc] initWithShards:_shards count:_shardCount]));
+        return;
+    }
+    LOCK(block(_dic));
+}
+
+#pragma mark - instrumentation
+
+- (LFLockProfile *)_lockProfile {
+    return LFLockProfileGetOrCreate(&_profile, self);
+}
+
+- (BOOL)isInstrumentationEnabled {
+    return LFLockProfileLoad(&_profile).isEnabled;
+}
+
+- (void)setInstrumentationEnabled:(BOOL)instrumentationEnabled {
+    if (!instrumentationEnabled && !LFLockProfileLoad(&_profile)) return;
+    [self _lockProfile].enabled = instrumentationEnabled;
+}
+
+- (NSString *)instrumentationName {
+    return LFLockProfileLoad(&_profile).name;
+}
+
+- (void)setInstrumentationName:(NSString *)instrumentationName {
+    [self _lockProfile].name = instrumentationName;
+}
+
+- (LFLockStatistics *)lockStatistics {
+    return [[self _lockProfile] statistics];
+}
+
+- (void)resetLockStatistics {
+    [LFLockProfileLoad(&_profile) reset];
+}
+
 #pragma mark - protocol
 
 - (id)copyWithZone:(NSZone *)zone {
@@ -192,6 +665,15 @@ dispatch_semaphore_signal(_lock);
 }
 
 - (id)mutableCopyWithZone:(NSZone *)zone {
+    if (_persistent) {
+        // The copy shares all nodes with the receiver until one of them is mutated.
+        return [[self.class allocWithZone:zone] initPersistentWithDictionary:self.publishedRoot];
+    }
+    if (_shards) {
+        LFThreadSafeDictionary *copiedDictionary = [[self.class allocWithZone:zone] initWithShardCount:_shardCount];
+        [copiedDictionary setDictionary:[self _dictionaryCopy]];
+        return copiedDictionary;
+    }
     LOCK(id copiedDictionary = [[self.class allocWithZone:zone] initWithDictionary:_dic]);
     return copiedDictionary;
 }
@@ -199,8 +681,9 @@ dispatch_semaphore_signal(_lock);
 - (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
                                   objects:(id __unsafe_unretained[])stackbuf
                                     count:(NSUInteger)len {
-    LOCK(NSUInteger count = [_dic countByEnumeratingWithState:state objects:stackbuf count:len]);
-    return count;
+    // Enumerate a copy of the keys taken by the first call, instead of locking for every chunk.
+    if (state->state == 0) LFFastEnumerationStateSetSnapshot(state, self.allKeys);
+    return LFFastEnumerationStateNext(state, stackbuf, len);
 }
 
 - (BOOL)isEqual:(id)object {
@@ -208,18 +691,24 @@ dispatch_semaphore_signal(_lock);
     
     if ([object isKindOfClass:LFThreadSafeDictionary.class]) {
         LFThreadSafeDictionary *other = object;
+        if (!_dic || !other->_dic) {
+            return [[self _dictionaryCopy] isEqual:[other _dictionaryCopy]];
+        }
         BOOL isEqual;
-        dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER);
-        dispatch_semaphore_wait(other->_lock, DISPATCH_TIME_FOREVER);
+        LFLockProfileWait(LFLockProfileLoad(&_profile), _lock);
+        LFLockProfileWait(LFLockProfileLoad(&other->_profile), other->_lock);
         isEqual = [_dic isEqual:other->_dic];
-        dispatch_semaphore_signal(other->_lock);
-        dispatch_semaphore_signal(_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&other->_profile), other->_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
         return isEqual;
     }
     return NO;
 }
 
 - (NSUInteger)hash {
+    // NSDictionary's hash is its count, so the sharded and persistent modes return the
+    // count of their snapshot, which is equal for the equal dictionaries of any mode.
+    if (!_dic) return self.count;
     LOCK(NSUInteger hash = [_dic hash]);
     return hash;
 }
@@ -227,22 +716,46 @@ dispatch_semaphore_signal(_lock);
 #pragma mark - custom methods for NSDictionary(YYAdd)
 
 - (NSDictionary *)entriesForKeys:(NSArray *)keys {
+    if (!_dic) return [[self _dictionaryCopy] lf_entriesForKeys:keys];
     LOCK(NSDictionary * dic = [_dic lf_entriesForKeys:keys]) return dic;
 }
 
 - (NSString *)jsonStringEncoded {
+    if (!_dic) return [[self _dictionaryCopy] lf_jsonStringEncoded];
     LOCK(NSString * s = [_dic lf_jsonStringEncoded]) return s;
 }
 
 - (NSString *)jsonPrettyStringEncoded {
+    if (!_dic) return [[self _dictionaryCopy] lf_jsonPrettyStringEncoded];
     LOCK(NSString * s = [_dic lf_jsonPrettyStringEncoded]) return s;
 }
 
 - (id)popObjectForKey:(id)aKey {
+    if (_persistent) {
+        PERSISTENT_WRITE(id o = [_root objectForKey:aKey];
+                         _root = [_root dictionaryByRemovingObjectForKey:aKey];
+        ) return o;
+    }
+    if (_shards) {
+        SHARD_WRITE(aKey, id o = [_sdic lf_popObjectForKey:aKey]) return o;
+    }
     LOCK(id o = [_dic lf_popObjectForKey:aKey]) return o;
 }
 
 - (NSDictionary *)popEntriesForKeys:(NSArray *)keys {
+    if (_persistent) {
+        PERSISTENT_WRITE(NSDictionary * d = [_root lf_entriesForKeys:keys];
+                         _root = [_root dictionaryByRemovingObjectsForKeys:keys];
+        ) return d;
+    }
+    if (_shards) {
+        SHARD_WRITE_ALL(NSMutableDictionary * d = [NSMutableDictionary new];
+                        for (id key in keys) {
+                            id o = [(__bridge NSMutableDictionary *)LFDictionaryShardForKey(_shards, _shardCount, key)->dic lf_popObjectForKey:key];
+                            if (o) d[key] = o;
+                        }
+        ) return d;
+    }
     LOCK(NSDictionary * d = [_dic lf_popEntriesForKeys:keys]) return d;
 }
 
@@ -0,0 +1,62 @@
+//
+//  LFThreadSafeIntegerDictionary.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ A thread safe mutable dictionary specialized for NSUInteger keys.
+ 
+ @discussion It has the same API shape as LFThreadSafeDictionary, but the keys are
+ never boxed into NSNumber: the entries are stored in a flat C array with open
+ addressing (linear probing), and the objects are retained by the dictionary.
+ Lookup, insertion and removal don't allocate memory, except when the table grows.
+ 
+ The dictionary supports indexed subscripting: `dic[3] = obj; id o = dic[3];`.
+ */
+@interface LFThreadSafeIntegerDictionary : NSObject <NSCopying>
+
+- (instancetype)init;
+
+/// Creates a dictionary which can hold `capacity` objects without growing.
+- (instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+
+/// The number of entries in the dictionary.
+@property (readonly) NSUInteger count;
+
+/// Returns the value associated with a given key, or nil.
+- (id)objectForKey:(NSUInteger)key;
+
+/// Sets the value of the specified key, the key is removed if the object is nil.
+- (void)setObject:(id)object forKey:(NSUInteger)key;
+
+/// Removes a given key and its associated value.
+- (void)removeObjectForKey:(NSUInteger)key;
+
+/// Removes a given key and returns its associated value, or nil.
+- (id)popObjectForKey:(NSUInteger)key;
+
+/// Empties the dictionary.
+- (void)removeAllObjects;
+
+/// Removes the entries which pass the test. The block is called while the dictionary is locked,
+/// do not access the dictionary inside the block.
+- (void)removeObjectsPassingTest:(BOOL (^)(NSUInteger key, id obj))predicate;
+
+/// Returns all the keys, in no particular order.
+- (NSIndexSet *)allKeys;
+
+/// Returns all the values, in no particular order.
+- (NSArray *)allValues;
+
+/// Enumerates a point-in-time copy of the entries, the dictionary is not locked while the block runs.
+- (void)enumerateKeysAndObjectsUsingBlock:(void (^)(NSUInteger key, id obj, BOOL *stop))block;
+
+- (id)objectAtIndexedSubscript:(NSUInteger)key;
+- (void)setObject:(id)object atIndexedSubscript:(NSUInteger)key;
+
+@end
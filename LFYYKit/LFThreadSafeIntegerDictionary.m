@@ -0,0 +1,261 @@
+//
+//  LFThreadSafeIntegerDictionary.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFThreadSafeIntegerDictionary.h"
+
+#define LOCK(...) dispatch_semaphore_wait(_lock, DISPATCH_TIME_FOREVER); \
+__VA_ARGS__; \
+dispatch_semaphore_signal(_lock);
+
+#define MIN_TABLE_SIZE 8
+
+typedef struct {
+    NSUInteger key;
+    void *value; ///< retained object, NULL if the slot is empty
+} LFIntegerDictionaryEntry;
+
+static inline NSUInteger LFIntegerDictionaryHash(NSUInteger key) {
+    key *= (NSUInteger)0x9E3779B97F4A7C15ULL; // frame index and ids are sequential, spread them
+    return key ^ (key >> 16);
+}
+
+/// Returns a table size (power of 2) which keeps the load factor below 3/4.
+static inline NSUInteger LFIntegerDictionaryTableSize(NSUInteger capacity) {
+    NSUInteger size = MIN_TABLE_SIZE;
+    while (size - size / 4 <= capacity) size <<= 1;
+    return size;
+}
+
+@implementation LFThreadSafeIntegerDictionary {
+    LFIntegerDictionaryEntry *_entries;
+    NSUInteger _mask; ///< table size - 1
+    NSUInteger _count;
+    dispatch_semaphore_t _lock;
+}
+
+#pragma mark - Private (should be called with lock held)
+
+/// Returns the slot of the key, or the empty slot where the key should be inserted.
+static inline NSUInteger LFIntegerDictionaryFindSlot(LFIntegerDictionaryEntry *entries, NSUInteger mask, NSUInteger key) {
+    NSUInteger i = LFIntegerDictionaryHash(key) & mask;
+    while (entries[i].value && entries[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+- (BOOL)_growIfNeeded {
+    NSUInteger size = _mask + 1;
+    if (_count + 1 < size - size / 4) return YES;
+    NSUInteger newSize = size << 1;
+    LFIntegerDictionaryEntry *entries = calloc(newSize, sizeof(LFIntegerDictionaryEntry));
+    if (!entries) return NO;
+    for (NSUInteger i = 0; i < size; i++) {
+        if (!_entries[i].value) continue;
+        NSUInteger slot = LFIntegerDictionaryFindSlot(entries, newSize - 1, _entries[i].key);
+        entries[slot] = _entries[i];
+    }
+    free(_entries);
+    _entries = entries;
+    _mask = newSize - 1;
+    return YES;
+}
+
+/// Removes the entry in slot `i`, and returns its value (retained).
+/// The following entries of the probe sequence are shifted back, so no tombstone is needed.
+- (void *)_removeEntryAtSlot:(NSUInteger)i {
+    void *value = _entries[i].value;
+    NSUInteger j = i;
+    for (;;) {
+        j = (j + 1) & _mask;
+        if (!_entries[j].value) break;
+        NSUInteger home = LFIntegerDictionaryHash(_entries[j].key) & _mask;
+        // the entry at j can move to i only if its home slot is not cyclically in (i, j]
+        BOOL stay = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stay) {
+            _entries[i] = _entries[j];
+            i = j;
+        }
+    }
+    _entries[i].value = NULL;
+    _entries[i].key = 0;
+    _count--;
+    return value;
+}
+
+#pragma mark - Public
+
+- (instancetype)init {
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (!self) return nil;
+    NSUInteger size = LFIntegerDictionaryTableSize(capacity);
+    _entries = calloc(size, sizeof(LFIntegerDictionaryEntry));
+    if (!_entries) return nil;
+    _mask = size - 1;
+    _lock = dispatch_semaphore_create(1);
+    return self;
+}
+
+- (void)dealloc {
+    if (_entries) {
+        for (NSUInteger i = 0; i <= _mask; i++) {
+            if (_entries[i].value) CFRelease(_entries[i].value);
+        }
+        free(_entries);
+        _entries = NULL;
+    }
+}
+
+- (NSUInteger)count {
+    LOCK(NSUInteger c = _count); return c;
+}
+
+- (id)objectForKey:(NSUInteger)key {
+    LOCK(NSUInteger slot = LFIntegerDictionaryFindSlot(_entries, _mask, key);
+         id o = (__bridge id)_entries[slot].value);
+    return o;
+}
+
+- (void)setObject:(id)object forKey:(NSUInteger)key {
+    if (!object) {
+        [self removeObjectForKey:key];
+        return;
+    }
+    void *value = (void *)CFBridgingRetain(object);
+    void *old = NULL;
+    LOCK(NSUInteger slot = LFIntegerDictionaryFindSlot(_entries, _mask, key);
+         if (_entries[slot].value) {
+             old = _entries[slot].value;
+             _entries[slot].value = value;
+         } else if ([self _growIfNeeded]) {
+             slot = LFIntegerDictionaryFindSlot(_entries, _mask, key);
+             _entries[slot].key = key;
+             _entries[slot].value = value;
+             _count++;
+         } else {
+             old = value; // out of memory, drop the object
+         });
+    if (old) CFRelease(old); // release outside the lock, it may be slow (dealloc a large image)
+}
+
+- (void)removeObjectForKey:(NSUInteger)key {
+    void *old = NULL;
+    LOCK(NSUInteger slot = LFIntegerDictionaryFindSlot(_entries, _mask, key);
+         if (_entries[slot].value) old = [self _removeEntryAtSlot:slot]);
+    if (old) CFRelease(old);
+}
+
+- (id)popObjectForKey:(NSUInteger)key {
+    void *old = NULL;
+    LOCK(NSUInteger slot = LFIntegerDictionaryFindSlot(_entries, _mask, key);
+         if (_entries[slot].value) old = [self _removeEntryAtSlot:slot]);
+    return old ? CFBridgingRelease(old) : nil;
+}
+
+- (void)removeAllObjects {
+    LOCK(NSUInteger size = _mask + 1;
+         LFIntegerDictionaryEntry *entries = _entries;
+         _entries = calloc(size, sizeof(LFIntegerDictionaryEntry));
+         if (_entries) {
+             _count = 0;
+         } else {
+             _entries = entries;
+             entries = NULL;
+         });
+    if (!entries) return;
+    for (NSUInteger i = 0; i < size; i++) {
+        if (entries[i].value) CFRelease(entries[i].value);
+    }
+    free(entries);
+}
+
+- (void)removeObjectsPassingTest:(BOOL (^)(NSUInteger key, id obj))predicate {
+    if (!predicate) return;
+    NSMutableArray *holder = [NSMutableArray new];
+    LOCK(NSUInteger i = 0;
+         while (i <= _mask) {
+             // a removal may shift the next entry back to slot `i`, so check it again
+             if (_entries[i].value && predicate(_entries[i].key, (__bridge id)_entries[i].value)) {
+                 [holder addObject:CFBridgingRelease([self _removeEntryAtSlot:i])];
+             } else {
+                 i++;
+             }
+         });
+    holder = nil; // release outside the lock
+}
+
+- (NSIndexSet *)allKeys {
+    NSMutableIndexSet *keys = [NSMutableIndexSet new];
+    LOCK(for (NSUInteger i = 0; i <= _mask; i++) {
+             if (_entries[i].value) [keys addIndex:_entries[i].key];
+         });
+    return keys;
+}
+
+- (NSArray *)allValues {
+    NSMutableArray *values = [NSMutableArray new];
+    LOCK(for (NSUInteger i = 0; i <= _mask; i++) {
+             if (_entries[i].value) [values addObject:(__bridge id)_entries[i].value];
+         });
+    return values;
+}
+
+- (void)enumerateKeysAndObjectsUsingBlock:(void (^)(NSUInteger key, id obj, BOOL *stop))block {
+    if (!block) return;
+    NSMutableData *keys = [NSMutableData new];
+    NSMutableArray *values = [NSMutableArray new];
+    LOCK(for (NSUInteger i = 0; i <= _mask; i++) {
+             if (!_entries[i].value) continue;
+             [keys appendBytes:&_entries[i].key length:sizeof(NSUInteger)];
+             [values addObject:(__bridge id)_entries[i].value];
+         });
+    const NSUInteger *keyPtr = keys.bytes;
+    BOOL stop = NO;
+    for (NSUInteger i = 0, max = values.count; i < max; i++) {
+        block(keyPtr[i], values[i], &stop);
+        if (stop) break;
+    }
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)key {
+    return [self objectForKey:key];
+}
+
+- (void)setObject:(id)object atIndexedSubscript:(NSUInteger)key {
+    [self setObject:object forKey:key];
+}
+
+#pragma mark - NSCopying
+
+- (id)copyWithZone:(NSZone *)zone {
+    LFThreadSafeIntegerDictionary *copied = nil;
+    LOCK(copied = [[self.class allocWithZone:zone] initWithCapacity:_count];
+         for (NSUInteger i = 0; i <= _mask; i++) {
+             if (!_entries[i].value) continue;
+             NSUInteger slot = LFIntegerDictionaryFindSlot(copied->_entries, copied->_mask, _entries[i].key);
+             copied->_entries[slot].key = _entries[i].key;
+             copied->_entries[slot].value = (void *)CFRetain(_entries[i].value);
+             copied->_count++;
+         });
+    return copied;
+}
+
+- (NSString *)description {
+    NSMutableString *desc = [NSMutableString stringWithFormat:@"<%@: %p> {", self.class, self];
+    [self enumerateKeysAndObjectsUsingBlock:^(NSUInteger key, id obj, BOOL *stop) {
+        [desc appendFormat:@"\n    %lu = %@;", (unsigned long)key, obj];
+    }];
+    [desc appendString:@"\n}"];
+    return desc;
+}
+
+@end
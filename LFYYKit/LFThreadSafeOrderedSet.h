@@ -0,0 +1,79 @@
+//
+//  LFThreadSafeOrderedSet.h
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "LFLockStatistics.h"
+
+/**
+ A simple implementation of thread safe mutable ordered set.
+
+ @discussion It keeps the insertion order like LFThreadSafeArray, and also a hash
+ index of the objects, so `containsObject:`, `indexOfObject:` and `removeObject:` look
+ up the object by hash instead of scanning the whole array under the lock. Use it
+ instead of LFThreadSafeArray for large collections of unique objects (observers,
+ identifiers...) which are often searched.
+
+ Every access is guarded by a single lock. Enumerations work on a point-in-time snapshot.
+ */
+@interface LFThreadSafeOrderedSet : NSMutableOrderedSet
+
+/**
+ Returns an immutable point-in-time copy of the ordered set, copied under the lock.
+ */
+- (NSOrderedSet *)snapshot;
+
+/**
+ Adds the object if it's not in the ordered set yet.
+
+ @return YES if the object was added, NO if it was already in the ordered set.
+ */
+- (BOOL)addObjectIfAbsent:(id)object;
+
+/**
+ Removes the object if it's in the ordered set.
+
+ @return YES if the object was removed, NO if it was not in the ordered set.
+ */
+- (BOOL)removeObjectIfPresent:(id)object;
+
+/**
+ Performs multiple mutations atomically.
+
+ @discussion The lock is taken once for the whole block, and other threads never see
+ a half-applied state. The block receives the backing mutable ordered set, which is only
+ valid inside the block. Do not access the receiver itself inside the block, or it will deadlock.
+
+ @param block The block to perform the mutations.
+ */
+- (void)performBatchUpdates:(void (^)(NSMutableOrderedSet *orderedSet))block;
+
+/**
+ Performs multiple reads on a consistent state.
+
+ @discussion Same as `performBatchUpdates:`, but the block must not mutate the ordered set.
+
+ @param block The block to perform the reads.
+ */
+- (void)performBatchReads:(void (^)(NSOrderedSet *orderedSet))block;
+
+#pragma mark - Instrumentation
+
+/// Whether the lock statistics are recorded. Default is NO.
+/// See `-[LFThreadSafeArray instrumentationEnabled]`.
+@property (getter=isInstrumentationEnabled) BOOL instrumentationEnabled;
+
+/// The name reported in the statistics. Default is the class name and address of the ordered set.
+@property (copy) NSString *instrumentationName;
+
+/// Returns a copy of the lock statistics recorded since the last reset.
+- (LFLockStatistics *)lockStatistics;
+
+/// Resets the lock statistics.
+- (void)resetLockStatistics;
+
+@end
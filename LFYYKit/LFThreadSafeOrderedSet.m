@@ -0,0 +1,319 @@
+//
+//  LFThreadSafeOrderedSet.m
+//  LFFoundation
+//
+//  Created by 汪潇翔 on 17/10/2026.
+//  Copyright © 2026 汪潇翔. All rights reserved.
+//
+
+#import "LFThreadSafeOrderedSet.h"
+#import "LFFastEnumerationSnapshot.h"
+#import "LFLockProfile.h"
+
+#define INIT(...) self = super.init; \
+if (!self) return nil; \
+__VA_ARGS__; \
+if (!_set) return nil; \
+_lock = dispatch_semaphore_create(1); \
+return self;
+
+
+#define LOCK(...) LFLockProfileWait(LFLockProfileLoad(&_profile), _lock); \
+__VA_ARGS__; \
+LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+
+
+@implementation LFThreadSafeOrderedSet {
+    NSMutableOrderedSet *_set;  //Subclass a class cluster...
+    dispatch_semaphore_t _lock;
+    void *_profile; ///< LFLockProfile, NULL until the instrumentation is first used, see LFLockProfileGetOrCreate
+}
+
+#pragma mark - init
+
+- (instancetype)init {
+    INIT(_set = [[NSMutableOrderedSet alloc] init]);
+}
+
+- (void)dealloc {
+    LFLockProfileRelease(&_profile);
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)numItems {
+    INIT(_set = [[NSMutableOrderedSet alloc] initWithCapacity:numItems]);
+}
+
+- (instancetype)initWithObjects:(const id[])objects count:(NSUInteger)cnt {
+    INIT(_set = [[NSMutableOrderedSet alloc] initWithObjects:objects count:cnt]);
+}
+
+- (instancetype)initWithArray:(NSArray *)array {
+    INIT(_set = [[NSMutableOrderedSet alloc] initWithArray:array]);
+}
+
+- (instancetype)initWithOrderedSet:(NSOrderedSet *)set {
+    INIT(_set = [[NSMutableOrderedSet alloc] initWithOrderedSet:set]);
+}
+
+- (instancetype)initWithSet:(NSSet *)set {
+    INIT(_set = [[NSMutableOrderedSet alloc] initWithSet:set]);
+}
+
+#pragma mark - method
+
+- (NSOrderedSet *)snapshot {
+    LOCK(NSOrderedSet * set = [_set copy]); return set;
+}
+
+- (NSUInteger)count {
+    LOCK(NSUInteger count = _set.count); return count;
+}
+
+- (id)objectAtIndex:(NSUInteger)idx {
+    LOCK(id o = [_set objectAtIndex:idx]); return o;
+}
+
+- (NSUInteger)indexOfObject:(id)object {
+    LOCK(NSUInteger i = [_set indexOfObject:object]); return i;
+}
+
+- (BOOL)containsObject:(id)object {
+    LOCK(BOOL c = [_set containsObject:object]); return c;
+}
+
+- (id)firstObject {
+    LOCK(id o = _set.firstObject); return o;
+}
+
+- (id)lastObject {
+    LOCK(id o = _set.lastObject); return o;
+}
+
+- (void)getObjects:(id __unsafe_unretained[])objects range:(NSRange)range {
+    LOCK([_set getObjects:objects range:range]);
+}
+
+- (NSArray *)objectsAtIndexes:(NSIndexSet *)indexes {
+    LOCK(NSArray * arr = [_set objectsAtIndexes:indexes]); return arr;
+}
+
+- (NSArray *)array {
+    LOCK(NSArray * arr = [_set.array copy]); return arr;
+}
+
+- (NSSet *)set {
+    LOCK(NSSet * set = [_set.set copy]); return set;
+}
+
+- (BOOL)intersectsOrderedSet:(NSOrderedSet *)other {
+    LOCK(BOOL b = [_set intersectsOrderedSet:other]); return b;
+}
+
+- (BOOL)intersectsSet:(NSSet *)set {
+    LOCK(BOOL b = [_set intersectsSet:set]); return b;
+}
+
+- (BOOL)isSubsetOfOrderedSet:(NSOrderedSet *)other {
+    LOCK(BOOL b = [_set isSubsetOfOrderedSet:other]); return b;
+}
+
+- (BOOL)isSubsetOfSet:(NSSet *)set {
+    LOCK(BOOL b = [_set isSubsetOfSet:set]); return b;
+}
+
+- (NSString *)description {
+    LOCK(NSString * d = _set.description); return d;
+}
+
+- (NSString *)descriptionWithLocale:(id)locale {
+    LOCK(NSString * d = [_set descriptionWithLocale:locale]); return d;
+}
+
+- (NSString *)descriptionWithLocale:(id)locale indent:(NSUInteger)level {
+    LOCK(NSString * d = [_set descriptionWithLocale:locale indent:level]); return d;
+}
+
+- (NSEnumerator *)objectEnumerator {
+    return [self.array objectEnumerator];
+}
+
+- (NSEnumerator *)reverseObjectEnumerator {
+    return [self.array reverseObjectEnumerator];
+}
+
+- (void)enumerateObjectsUsingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+    [self.snapshot enumerateObjectsUsingBlock:block];
+}
+
+- (void)enumerateObjectsWithOptions:(NSEnumerationOptions)opts usingBlock:(void (^)(id obj, NSUInteger idx, BOOL *stop))block {
+    [self.snapshot enumerateObjectsWithOptions:opts usingBlock:block];
+}
+
+- (NSUInteger)indexOfObjectPassingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    LOCK(NSUInteger i = [_set indexOfObjectPassingTest:predicate]); return i;
+}
+
+- (NSIndexSet *)indexesOfObjectsPassingTest:(BOOL (^)(id obj, NSUInteger idx, BOOL *stop))predicate {
+    LOCK(NSIndexSet * i = [_set indexesOfObjectsPassingTest:predicate]); return i;
+}
+
+- (NSArray *)sortedArrayUsingComparator:(NSComparator)cmptr {
+    LOCK(NSArray * arr = [_set sortedArrayUsingComparator:cmptr]); return arr;
+}
+
+#pragma mark - mutable
+
+- (void)insertObject:(id)object atIndex:(NSUInteger)idx {
+    LOCK([_set insertObject:object atIndex:idx]);
+}
+
+- (void)removeObjectAtIndex:(NSUInteger)idx {
+    LOCK([_set removeObjectAtIndex:idx]);
+}
+
+- (void)replaceObjectAtIndex:(NSUInteger)idx withObject:(id)object {
+    LOCK([_set replaceObjectAtIndex:idx withObject:object]);
+}
+
+- (void)addObject:(id)object {
+    LOCK([_set addObject:object]);
+}
+
+- (void)addObjectsFromArray:(NSArray *)array {
+    LOCK([_set addObjectsFromArray:array]);
+}
+
+- (void)removeObject:(id)object {
+    LOCK([_set removeObject:object]);
+}
+
+- (void)removeObjectsInArray:(NSArray *)array {
+    LOCK([_set removeObjectsInArray:array]);
+}
+
+- (void)removeObjectsAtIndexes:(NSIndexSet *)indexes {
+    LOCK([_set removeObjectsAtIndexes:indexes]);
+}
+
+- (void)removeAllObjects {
+    LOCK([_set removeAllObjects]);
+}
+
+- (void)exchangeObjectAtIndex:(NSUInteger)idx1 withObjectAtIndex:(NSUInteger)idx2 {
+    LOCK([_set exchangeObjectAtIndex:idx1 withObjectAtIndex:idx2]);
+}
+
+- (void)moveObjectsAtIndexes:(NSIndexSet *)indexes toIndex:(NSUInteger)idx {
+    LOCK([_set moveObjectsAtIndexes:indexes toIndex:idx]);
+}
+
+- (void)intersectOrderedSet:(NSOrderedSet *)other {
+    LOCK([_set intersectOrderedSet:other]);
+}
+
+- (void)minusOrderedSet:(NSOrderedSet *)other {
+    LOCK([_set minusOrderedSet:other]);
+}
+
+- (void)unionOrderedSet:(NSOrderedSet *)other {
+    LOCK([_set unionOrderedSet:other]);
+}
+
+- (void)sortUsingComparator:(NSComparator)cmptr {
+    LOCK([_set sortUsingComparator:cmptr]);
+}
+
+- (BOOL)addObjectIfAbsent:(id)object {
+    if (!object) return NO;
+    LOCK(BOOL added = ![_set containsObject:object]; if (added) [_set addObject:object]); return added;
+}
+
+- (BOOL)removeObjectIfPresent:(id)object {
+    if (!object) return NO;
+    LOCK(NSUInteger i = [_set indexOfObject:object]; if (i != NSNotFound) [_set removeObjectAtIndex:i]); return i != NSNotFound;
+}
+
+#pragma mark - batch
+
+- (void)performBatchUpdates:(void (^)(NSMutableOrderedSet *orderedSet))block {
+    if (!block) return;
+    LOCK(block(_set));
+}
+
+- (void)performBatchReads:(void (^)(NSOrderedSet *orderedSet))block {
+    if (!block) return;
+    LOCK(block(_set));
+}
+
+#pragma mark - instrumentation
+
+- (LFLockProfile *)_lockProfile {
+    return LFLockProfileGetOrCreate(&_profile, self);
+}
+
+- (BOOL)isInstrumentationEnabled {
+    return LFLockProfileLoad(&_profile).isEnabled;
+}
+
+- (void)setInstrumentationEnabled:(BOOL)instrumentationEnabled {
+    if (!instrumentationEnabled && !LFLockProfileLoad(&_profile)) return;
+    [self _lockProfile].enabled = instrumentationEnabled;
+}
+
+- (NSString *)instrumentationName {
+    return LFLockProfileLoad(&_profile).name;
+}
+
+- (void)setInstrumentationName:(NSString *)instrumentationName {
+    [self _lockProfile].name = instrumentationName;
+}
+
+- (LFLockStatistics *)lockStatistics {
+    return [[self _lockProfile] statistics];
+}
+
+- (void)resetLockStatistics {
+    [LFLockProfileLoad(&_profile) reset];
+}
+
+#pragma mark - protocol
+
+- (id)copyWithZone:(NSZone *)zone {
+    return [self mutableCopyWithZone:zone];
+}
+
+- (id)mutableCopyWithZone:(NSZone *)zone {
+    LOCK(id copiedSet = [[self.class allocWithZone:zone] initWithOrderedSet:_set]);
+    return copiedSet;
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                  objects:(id __unsafe_unretained[])stackbuf
+                                    count:(NSUInteger)len {
+    // Enumerate a copy taken by the first call, instead of locking for every chunk.
+    if (state->state == 0) LFFastEnumerationStateSetSnapshot(state, self.array);
+    return LFFastEnumerationStateNext(state, stackbuf, len);
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) return YES;
+
+    if ([object isKindOfClass:LFThreadSafeOrderedSet.class]) {
+        LFThreadSafeOrderedSet *other = object;
+        BOOL isEqual;
+        LFLockProfileWait(LFLockProfileLoad(&_profile), _lock);
+        LFLockProfileWait(LFLockProfileLoad(&other->_profile), other->_lock);
+        isEqual = [_set isEqual:other->_set];
+        LFLockProfileSignal(LFLockProfileLoad(&other->_profile), other->_lock);
+        LFLockProfileSignal(LFLockProfileLoad(&_profile), _lock);
+        return isEqual;
+    }
+    return NO;
+}
+
+- (NSUInteger)hash {
+    LOCK(NSUInteger hash = [_set hash]);
+    return hash;
+}
+
+@end
@@ -18,6 +18,12 @@ FOUNDATION_EXPORT const unsigned char LFYYKitVersionString[];
 
 #import <LFYYKit/LFThreadSafeArray.h>
 #import <LFYYKit/LFThreadSafeDictionary.h>
+#import <LFYYKit/LFThreadSafeOrderedSet.h>
+#import <LFYYKit/LFPersistentDictionary.h>
+#import <LFYYKit/LFThreadSafeIntegerDictionary.h>
+#import <LFYYKit/LFMemoryCache.h>
+#import <LFYYKit/LFConcurrentQueue.h>
+#import <LFYYKit/LFLockStatistics.h>
 
 
 #import <LFYYKit/LFGestureRecognizer.h>
@@ -53,6 +59,14 @@ FOUNDATION_EXPORT const unsigned char LFYYKitVersionString[];
 #import <LFYYKit/LFDispatchQueuePool.h>
 #import <LFYYKit/LFSentinel.h>
 #import <LFYYKit/LFTransaction.h>
+#import <LFYYKit/LFWorkStealingExecutor.h>
+#import <LFYYKit/LFRenderScheduler.h>
+#import <LFYYKit/LFBitmapPool.h>
+#import <LFYYKit/LFRenderCommitQueue.h>
+#import <LFYYKit/LFRenderCache.h>
+#import <LFYYKit/LFIdleTaskQueue.h>
+#import <LFYYKit/LFCancellationToken.h>
+#import <LFYYKit/LFDeferredReleaseQueue.h>
 
 
 
@@ -42,4 +42,14 @@
 /// @param fadeDuration  Same as `contentsFadeDuration` property.
 - (void)setLayout:(LFTextLayout *)layout withFadeDuration:(NSTimeInterval)fadeDuration;
 
+/**
+ Whether the text is rendered asynchronously in tiles (see `LFAsyncLayer.tiled`),
+ only the tiles near the visible area are rendered and kept. When the layout changes,
+ only the tiles of the changed lines are redrawn. Default is NO.
+ */
+@property (nonatomic, assign) BOOL displaysAsynchronouslyInTiles;
+
+/// Renders the tiles which became visible, call it when the view scrolls.
+- (void)updateVisibleTiles;
+
 @end
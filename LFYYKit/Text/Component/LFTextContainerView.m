@@ -9,6 +9,75 @@
 //
 
 #import "LFTextContainerView.h"
+#import "LFAsyncLayer.h"
+
+/**
+ Gets the lengths of the common prefix and suffix (both characters and attributes) of
+ two texts, the edited range lies between them. The suffix doesn't overlap the prefix.
+ It compares in place, without copying substrings.
+ */
+static void LFTextContainerViewGetCommonAffixes(NSAttributedString *oldText, NSAttributedString *newText, NSUInteger *prefix, NSUInteger *suffix) {
+    NSUInteger oldLength = oldText.length, newLength = newText.length;
+    NSUInteger minLength = MIN(oldLength, newLength);
+    CFStringRef oldString = (__bridge CFStringRef)oldText.string;
+    CFStringRef newString = (__bridge CFStringRef)newText.string;
+    CFStringInlineBuffer oldBuffer, newBuffer;
+    CFStringInitInlineBuffer(oldString, &oldBuffer, CFRangeMake(0, oldLength));
+    CFStringInitInlineBuffer(newString, &newBuffer, CFRangeMake(0, newLength));
+    
+    // characters, then the attribute runs inside the same characters
+    NSUInteger head = 0;
+    while (head < minLength &&
+           CFStringGetCharacterFromInlineBuffer(&oldBuffer, head) == CFStringGetCharacterFromInlineBuffer(&newBuffer, head)) head++;
+    NSUInteger index = 0;
+    while (index < head) {
+        NSRange oldRange, newRange;
+        NSDictionary *oldAttrs = [oldText attributesAtIndex:index effectiveRange:&oldRange];
+        NSDictionary *newAttrs = [newText attributesAtIndex:index effectiveRange:&newRange];
+        if (oldAttrs != newAttrs && ![oldAttrs isEqualToDictionary:newAttrs]) break;
+        index = MIN(NSMaxRange(oldRange), NSMaxRange(newRange));
+    }
+    head = MIN(head, index);
+    
+    NSUInteger tail = 0, maxTail = minLength - head;
+    while (tail < maxTail &&
+           CFStringGetCharacterFromInlineBuffer(&oldBuffer, oldLength - 1 - tail) == CFStringGetCharacterFromInlineBuffer(&newBuffer, newLength - 1 - tail)) tail++;
+    NSUInteger count = 0; // the number of the common attributed characters from the end
+    while (count < tail) {
+        NSRange oldRange, newRange;
+        NSDictionary *oldAttrs = [oldText attributesAtIndex:oldLength - 1 - count effectiveRange:&oldRange];
+        NSDictionary *newAttrs = [newText attributesAtIndex:newLength - 1 - count effectiveRange:&newRange];
+        if (oldAttrs != newAttrs && ![oldAttrs isEqualToDictionary:newAttrs]) break;
+        count = MIN(oldLength - oldRange.location, newLength - newRange.location);
+    }
+    tail = MIN(tail, count);
+    
+    if (prefix) *prefix = head;
+    if (suffix) *suffix = tail;
+}
+
+/// Returns the draw point of the layout for the vertical alignment.
+static CGPoint LFTextContainerViewGetDrawPoint(LFTextLayout *layout, CGSize size, LFTextVerticalAlignment verticalAlignment) {
+    CGSize boundingSize = layout.textBoundingSize;
+    CGPoint point = CGPointZero;
+    if (verticalAlignment == LFTextVerticalAlignmentCenter) {
+        if (layout.container.isVerticalForm) {
+            point.x = -(size.width - boundingSize.width) * 0.5;
+        } else {
+            point.y = (size.height - boundingSize.height) * 0.5;
+        }
+    } else if (verticalAlignment == LFTextVerticalAlignmentBottom) {
+        if (layout.container.isVerticalForm) {
+            point.x = -(size.width - boundingSize.width);
+        } else {
+            point.y = (size.height - boundingSize.height);
+        }
+    }
+    return point;
+}
+
+@interface LFTextContainerView () <LFAsyncLayerDelegate>
+@end
 
 @implementation LFTextContainerView {
     BOOL _attachmentChanged;
@@ -20,11 +89,16 @@
     self = [super initWithFrame:frame];
     if (!self) return nil;
     self.backgroundColor = [UIColor clearColor];
+    ((LFAsyncLayer *)self.layer).displaysAsynchronously = NO;
     _attachmentViews = [NSMutableArray array];
     _attachmentLayers = [NSMutableArray array];
     return self;
 }
 
++ (Class)layerClass {
+    return [LFAsyncLayer class];
+}
+
 - (void)setDebugOption:(LFTextDebugOption *)debugOption {
     BOOL needDraw = _debugOption.needDrawDebug;
     _debugOption = debugOption.copy;
@@ -49,9 +123,15 @@
 
 - (void)setLayout:(LFTextLayout *)layout {
     if (_layout == layout) return;
+    LFTextLayout *oldLayout = _layout;
     _layout = layout;
     _attachmentChanged = YES;
-    [self setNeedsDisplay];
+    if (self.displaysAsynchronouslyInTiles) {
+        CGRect rect = [self _changedRectFromLayout:oldLayout toLayout:layout];
+        if (!CGRectIsNull(rect)) [self setNeedsDisplayInRect:rect];
+    } else {
+        [self setNeedsDisplay];
+    }
 }
 
 - (void)setLayout:(LFTextLayout *)layout withFadeDuration:(NSTimeInterval)fadeDuration {
@@ -59,12 +139,117 @@
     self.layout = layout;
 }
 
-- (void)drawRect:(CGRect)rect {
+- (BOOL)displaysAsynchronouslyInTiles {
+    return ((LFAsyncLayer *)self.layer).isTiled;
+}
+
+- (void)setDisplaysAsynchronouslyInTiles:(BOOL)displaysAsynchronouslyInTiles {
+    LFAsyncLayer *layer = (LFAsyncLayer *)self.layer;
+    layer.displaysAsynchronously = displaysAsynchronouslyInTiles;
+    layer.tiled = displaysAsynchronouslyInTiles;
+}
+
+- (void)updateVisibleTiles {
+    [(LFAsyncLayer *)self.layer updateVisibleTiles];
+}
+
+/**
+ Returns the rect which differs between two layouts: the lines from the first changed
+ line to the last changed line, a line above and below included for the decorations
+ (such as borders) which span lines. Returns the bounds if it can't tell.
+ */
+- (CGRect)_changedRectFromLayout:(LFTextLayout *)oldLayout toLayout:(LFTextLayout *)newLayout {
+    CGRect bounds = self.bounds;
+    if (!oldLayout || !newLayout) return bounds;
+    if (oldLayout.container.isVerticalForm || newLayout.container.isVerticalForm) return bounds;
+    if (_textVerticalAlignment != LFTextVerticalAlignmentTop) return bounds;
+    if (oldLayout.truncatedLine || newLayout.truncatedLine) return bounds;
+    
+    NSArray *oldLines = oldLayout.lines;
+    NSArray *newLines = newLayout.lines;
+    NSUInteger oldCount = oldLines.count, newCount = newLines.count;
+    NSUInteger minCount = MIN(oldCount, newCount);
+    
+    // The texts only differ between the common prefix and suffix, so a line is the same if
+    // it's at the same place with the same range (shifted by the edit below it), and it's
+    // inside the prefix or the suffix.
+    NSUInteger oldLength = oldLayout.text.length, newLength = newLayout.text.length;
+    NSUInteger prefix = 0, suffix = 0;
+    LFTextContainerViewGetCommonAffixes(oldLayout.text, newLayout.text, &prefix, &suffix);
+    
+    // same lines from the top, and from the bottom
+    NSUInteger head = 0;
+    while (head < minCount) {
+        LFTextLine *a = oldLines[head], *b = newLines[head];
+        if (!NSEqualRanges(a.range, b.range) || NSMaxRange(a.range) > prefix) break;
+        if (!CGPointEqualToPoint(a.position, b.position)) break;
+        head++;
+    }
+    if (head == oldCount && head == newCount) return CGRectNull;
+    NSUInteger tail = 0;
+    while (tail < minCount - head) {
+        LFTextLine *a = oldLines[oldCount - 1 - tail], *b = newLines[newCount - 1 - tail];
+        if (a.range.length != b.range.length || a.range.location < oldLength - suffix) break;
+        if (oldLength - a.range.location != newLength - b.range.location) break;
+        if (!CGPointEqualToPoint(a.position, b.position)) break;
+        tail++;
+    }
+    
+    CGRect rect = CGRectNull;
+    NSUInteger first = head > 0 ? head - 1 : 0;
+    NSUInteger oldEnd = MIN(oldCount, oldCount - tail + 1);
+    NSUInteger newEnd = MIN(newCount, newCount - tail + 1);
+    for (NSUInteger i = first; i < oldEnd; i++) {
+        rect = CGRectUnion(rect, ((LFTextLine *)oldLines[i]).bounds);
+    }
+    for (NSUInteger i = first; i < newEnd; i++) {
+        rect = CGRectUnion(rect, ((LFTextLine *)newLines[i]).bounds);
+    }
+    if (CGRectIsNull(rect)) return bounds;
+    // full width, and to the bottom if the text height changed
+    rect.origin.x = CGRectGetMinX(bounds);
+    rect.size.width = bounds.size.width;
+    if (oldLayout.textBoundingSize.height != newLayout.textBoundingSize.height) {
+        rect.size.height = CGRectGetMaxY(bounds) - rect.origin.y;
+    }
+    return CGRectInset(rect, 0, -1);
+}
+
+#pragma mark - LFAsyncLayerDelegate
+
+- (LFAsyncLayerDisplayTask *)newAsyncDisplayTask {
+    LFTextLayout *layout = _layout;
+    LFTextDebugOption *debug = _debugOption;
+    LFTextVerticalAlignment verticalAlignment = _textVerticalAlignment;
+    NSTimeInterval fadeDuration = self.displaysAsynchronouslyInTiles ? 0 : _contentsFadeDuration; // tiles don't fade
+    __weak typeof(self) _self = self; // a tiled layer keeps the task
+    
+    LFAsyncLayerDisplayTask *task = [LFAsyncLayerDisplayTask new];
+    
+    task.willDisplay = ^(CALayer *layer) {
+        [_self _willDisplayWithFadeDuration:fadeDuration];
+    };
+    
+    // draw layout, the attachments are added on main thread by didDisplay
+    task.displayWithCancellationToken = ^(CGContextRef context, CGSize size, LFCancellationToken *token) {
+        CGPoint point = LFTextContainerViewGetDrawPoint(layout, size, verticalAlignment);
+        [layout drawInContext:context size:size point:point view:nil layer:nil debug:debug cancellationToken:token];
+    };
+    
+    task.didDisplay = ^(CALayer *layer, BOOL finished) {
+        if (!finished) return;
+        [_self _didDisplayLayout:layout verticalAlignment:verticalAlignment];
+    };
+    
+    return task;
+}
+
+- (void)_willDisplayWithFadeDuration:(NSTimeInterval)fadeDuration {
     // fade content
     [self.layer removeAnimationForKey:@"contents"];
-    if (_contentsFadeDuration > 0) {
+    if (fadeDuration > 0) {
         CATransition *transition = [CATransition animation];
-        transition.duration = _contentsFadeDuration;
+        transition.duration = fadeDuration;
         transition.timingFunction = [CAMediaTimingFunction functionWithName:kCAMediaTimingFunctionEaseOut];
         transition.type = kCATransitionFade;
         [self.layer addAnimation:transition forKey:@"contents"];
@@ -81,29 +266,18 @@
         [_attachmentViews removeAllObjects];
         [_attachmentLayers removeAllObjects];
     }
-    
-    // draw layout
-    CGSize boundingSize = _layout.textBoundingSize;
-    CGPoint point = CGPointZero;
-    if (_textVerticalAlignment == LFTextVerticalAlignmentCenter) {
-        if (_layout.container.isVerticalForm) {
-            point.x = -(self.bounds.size.width - boundingSize.width) * 0.5;
-        } else {
-            point.y = (self.bounds.size.height - boundingSize.height) * 0.5;
-        }
-    } else if (_textVerticalAlignment == LFTextVerticalAlignmentBottom) {
-        if (_layout.container.isVerticalForm) {
-            point.x = -(self.bounds.size.width - boundingSize.width);
-        } else {
-            point.y = (self.bounds.size.height - boundingSize.height);
-        }
-    }
-    [_layout drawInContext:UIGraphicsGetCurrentContext() size:self.bounds.size point:point view:self layer:self.layer debug:_debugOption cancel:nil];
+}
+
+- (void)_didDisplayLayout:(LFTextLayout *)layout verticalAlignment:(LFTextVerticalAlignment)verticalAlignment {
+    if (layout != _layout) return;
+    CGSize size = self.bounds.size;
+    CGPoint point = LFTextContainerViewGetDrawPoint(layout, size, verticalAlignment);
+    [layout drawInContext:nil size:size point:point view:self layer:self.layer debug:nil cancel:NULL];
     
     // update attachment
     if (_attachmentChanged) {
         _attachmentChanged = NO;
-        for (LFTextAttachment *a in _layout.attachments) {
+        for (LFTextAttachment *a in layout.attachments) {
             if ([a.content isKindOfClass:[UIView class]]) [_attachmentViews addObject:a.content];
             if ([a.content isKindOfClass:[CALayer class]]) [_attachmentLayers addObject:a.content];
         }
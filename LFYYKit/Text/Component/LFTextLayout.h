@@ -14,6 +14,8 @@
 #import "LFTextLine.h"
 #import "LFTextInput.h"
 
+@class LFCancellationToken;
+
 @protocol LFTextLinePositionModifier;
 extern const CGSize LFTextContainerMaxSize;
 
@@ -171,6 +173,19 @@ extern const CGSize LFTextContainerMaxSize;
  */
 + (LFTextLayout *)layoutWithContainer:(LFTextContainer *)container text:(NSAttributedString *)text range:(NSRange)range;
 
+/**
+ Generate a layout with the given container and text, which can be cancelled.
+ 
+ @param container The text container (if nil, returns nil).
+ @param text      The text (if nil, returns nil).
+ @param range     The text range (if out of range, returns nil). If the
+    length of the range is 0, it means the length is no limit.
+ @param token     The cancellation token, it's checked between the layout steps and
+    lines. Pass nil to ignore this feature.
+ @return A new layout, or nil when an error occurs or the token is cancelled.
+ */
++ (LFTextLayout *)layoutWithContainer:(LFTextContainer *)container text:(NSAttributedString *)text range:(NSRange)range cancellationToken:(LFCancellationToken *)token;
+
 /**
  Generate layouts with the given containers and text.
  
@@ -472,6 +487,9 @@ extern const CGSize LFTextContainerMaxSize;
  add to this `view`, and if the `layer` parameter is not nil, then the attachment
  layers will add to this `layer`. 
  
+ Only the lines and image attachments inside the clip bounding box of the context
+ are drawn, so a clipped context (such as a tile) draws only its part of the layout.
+ 
  @warning This method should be called on main thread if `view` or `layer` parameter
  is not nil and there's UIView or CALayer attachments in layout. 
  Otherwise, it can be called on any thread.
@@ -494,6 +512,22 @@ extern const CGSize LFTextContainerMaxSize;
                 debug:(LFTextDebugOption *)debug
                cancel:(BOOL (^)(void))cancel;
 
+/**
+ Draw the layout and show the attachments, which can be cancelled.
+ 
+ @discussion It's the same as `drawInContext:size:point:view:layer:debug:cancel:`,
+ the further draw progress is canceled when the token is cancelled.
+ 
+ @param token The cancellation token. Pass nil to ignore this feature.
+ */
+- (void)drawInContext:(CGContextRef)context
+                 size:(CGSize)size
+                point:(CGPoint)point
+                 view:(UIView *)view
+                layer:(CALayer *)layer
+                debug:(LFTextDebugOption *)debug
+    cancellationToken:(LFCancellationToken *)token;
+
 /**
  Draw the layout text and image (without view or layer attachments).
  
@@ -13,6 +13,7 @@
 #import "LFTextUtilities.h"
 #import "LFTextAttribute.h"
 #import "LFTextArchiver.h"
+#import "LFCancellationToken.h"
 #import <libkern/OSAtomic.h>
 #import "NSAttributedString+LFText.h"
 #import <LFCategory/LFCategory.h>
@@ -376,6 +377,10 @@ dispatch_semaphore_signal(_lock);
 }
 
 + (LFTextLayout *)layoutWithContainer:(LFTextContainer *)container text:(NSAttributedString *)text range:(NSRange)range {
+    return [self layoutWithContainer:container text:text range:range cancellationToken:nil];
+}
+
++ (LFTextLayout *)layoutWithContainer:(LFTextContainer *)container text:(NSAttributedString *)text range:(NSRange)range cancellationToken:(LFCancellationToken *)token {
     LFTextLayout *layout = NULL;
     CGPathRef cgPath = nil;
     CGRect cgPathBox = {0};
@@ -500,10 +505,13 @@ dispatch_semaphore_signal(_lock);
     }
     
     // create CoreText objects
+    if (token.isCancelled) goto fail;
     ctSetter = CTFramesetterCreateWithAttributedString((CFTypeRef)text);
     if (!ctSetter) goto fail;
+    if (token.isCancelled) goto fail;
     ctFrame = CTFramesetterCreateFrame(ctSetter, LFCFRangeFromNSRange(range), cgPath, (CFTypeRef)frameAttrs);
     if (!ctFrame) goto fail;
+    if (token.isCancelled) goto fail;
     lines = [NSMutableArray new];
     ctLines = CTFrameGetLines(ctFrame);
     lineCount = CFArrayGetCount(ctLines);
@@ -527,6 +535,7 @@ dispatch_semaphore_signal(_lock);
     // calculate line frame
     NSUInteger lineCurrentIdx = 0;
     for (NSUInteger i = 0; i < lineCount; i++) {
+        if (token.isCancelled) goto fail;
         CTLineRef ctLine = CFArrayGetValueAtIndex(ctLines, i);
         CFArrayRef ctRuns = CTLineGetGlyphRuns(ctLine);
         if (!ctRuns || CFArrayGetCount(ctRuns) == 0) continue;
@@ -842,6 +851,7 @@ dispatch_semaphore_signal(_lock);
         }
     }
     
+    if (token.isCancelled) goto fail;
     attachments = [NSMutableArray new];
     attachmentRanges = [NSMutableArray new];
     attachmentRects = [NSMutableArray new];
@@ -2221,6 +2231,29 @@ static void LFTextGetRunsMaxMetric(CFArrayRef runs, CGFloat *xHeight, CGFloat *u
     if (lineThickness) *lineThickness = maxLineThickness;
 }
 
+/**
+ Returns the rect to draw in layout coordinates: the clip bounding box of the context
+ (such as a tile of a tiled layer), offset by the draw point.
+ */
+static CGRect LFTextGetDrawRect(CGContextRef context, CGPoint point) {
+    if (!context) return CGRectInfinite;
+    CGRect rect = CGContextGetClipBoundingBox(context);
+    if (CGRectIsNull(rect) || CGRectIsInfinite(rect)) return CGRectInfinite;
+    return CGRectOffset(rect, -point.x, -point.y);
+}
+
+/**
+ Whether the line may draw inside the rect. Glyphs (italics, diacritics, large ascenders)
+ may draw outside the line bounds, so the bounds are outset by the line height.
+ */
+static BOOL LFTextLineIntersectsRect(LFTextLine *line, CGRect rect, CGFloat verticalOffset, BOOL isVertical, CGFloat outset) {
+    if (CGRectIsInfinite(rect)) return YES;
+    CGRect bounds = line.bounds;
+    CGFloat margin = (isVertical ? bounds.size.width : bounds.size.height) + outset;
+    bounds.origin.x += verticalOffset;
+    return CGRectIntersectsRect(CGRectInset(bounds, -margin, -margin), rect);
+}
+
 static void LFTextDrawRun(LFTextLine *line, CTRunRef run, CGContextRef context, CGSize size, BOOL isVertical, NSArray *runRanges, CGFloat verticalOffset) {
     CGAffineTransform runTextMatrix = CTRunGetTextMatrix(run);
     BOOL runTextMatrixIsID = CGAffineTransformIsIdentity(runTextMatrix);
@@ -2591,7 +2624,7 @@ static void LFTextDrawLineStyle(CGContextRef context, CGFloat length, CGFloat li
     } CGContextRestoreGState(context);
 }
 
-static void LFTextDrawText(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, BOOL (^cancel)(void)) {
+static void LFTextDrawText(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, CGRect drawRect, BOOL (^cancel)(void)) {
     CGContextSaveGState(context); {
         
         CGContextTranslateCTM(context, point.x, point.y);
@@ -2606,6 +2639,7 @@ static void LFTextDrawText(LFTextLayout *layout, CGContextRef context, CGSize si
         for (NSUInteger l = 0, lMax = lines.count; l < lMax; l++) {
             LFTextLine *line = lines[l];
             if (layout.truncatedLine && layout.truncatedLine.index == line.index) line = layout.truncatedLine;
+            if (!LFTextLineIntersectsRect(line, drawRect, verticalOffset, isVertical, 0)) continue;
             NSArray *lineRunRanges = line.verticalRotateRange;
             CGContextSetTextMatrix(context, CGAffineTransformIdentity);
             CGContextSetTextPosition(context, line.position.x + verticalOffset, size.height - line.position.y);
@@ -2827,7 +2861,7 @@ static void LFTextDrawBorder(LFTextLayout *layout, CGContextRef context, CGSize
     CGContextRestoreGState(context);
 }
 
-static void LFTextDrawDecoration(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, LFTextDecorationType type, BOOL (^cancel)(void)) {
+static void LFTextDrawDecoration(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, CGRect drawRect, LFTextDecorationType type, BOOL (^cancel)(void)) {
     NSArray *lines = layout.lines;
     
     CGContextSaveGState(context);
@@ -2842,6 +2876,7 @@ static void LFTextDrawDecoration(LFTextLayout *layout, CGContextRef context, CGS
         
         LFTextLine *line = lines[l];
         if (layout.truncatedLine && layout.truncatedLine.index == line.index) line = layout.truncatedLine;
+        if (!LFTextLineIntersectsRect(line, drawRect, verticalOffset, isVertical, 0)) continue;
         CFArrayRef runs = CTLineGetGlyphRuns(line.CTLine);
         for (NSUInteger r = 0, rMax = CFArrayGetCount(runs); r < rMax; r++) {
             CTRunRef run = CFArrayGetValueAtIndex(runs, r);
@@ -2954,7 +2989,7 @@ static void LFTextDrawDecoration(LFTextLayout *layout, CGContextRef context, CGS
     CGContextRestoreGState(context);
 }
 
-static void LFTextDrawAttachment(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, UIView *targetView, CALayer *targetLayer, BOOL (^cancel)(void)) {
+static void LFTextDrawAttachment(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, CGRect drawRect, UIView *targetView, CALayer *targetLayer, BOOL (^cancel)(void)) {
     
     BOOL isVertical = layout.container.verticalForm;
     CGFloat verticalOffset = isVertical ? (size.width - layout.container.size.width) : 0;
@@ -2992,6 +3027,7 @@ static void LFTextDrawAttachment(LFTextLayout *layout, CGContextRef context, CGS
         rect.origin.x += point.x + verticalOffset;
         rect.origin.y += point.y;
         if (image) {
+            if (!CGRectIsInfinite(drawRect) && !CGRectIntersectsRect(CGRectOffset(rect, -point.x, -point.y), drawRect)) continue;
             CGImageRef ref = image.CGImage;
             if (ref) {
                 CGContextSaveGState(context);
@@ -3010,7 +3046,7 @@ static void LFTextDrawAttachment(LFTextLayout *layout, CGContextRef context, CGS
     }
 }
 
-static void LFTextDrawShadow(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, BOOL (^cancel)(void)) {
+static void LFTextDrawShadow(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, CGRect drawRect, BOOL (^cancel)(void)) {
     //move out of context. (0xFFFF is just a random large number)
     CGFloat offsetAlterX = size.width + 0xFFFF;
     
@@ -3045,6 +3081,11 @@ static void LFTextDrawShadow(LFTextLayout *layout, CGContextRef context, CGSize
                         shadow = shadow.subShadow;
                         continue;
                     }
+                    CGFloat outset = shadow.radius + fabs(shadow.offset.width) + fabs(shadow.offset.height);
+                    if (!LFTextLineIntersectsRect(line, drawRect, verticalOffset, isVertical, outset)) {
+                        shadow = shadow.subShadow;
+                        continue;
+                    }
                     CGSize offset = shadow.offset;
                     offset.width -= offsetAlterX;
                     CGContextSaveGState(context); {
@@ -3060,7 +3101,7 @@ static void LFTextDrawShadow(LFTextLayout *layout, CGContextRef context, CGSize
     } CGContextRestoreGState(context);
 }
 
-static void LFTextDrawInnerShadow(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, BOOL (^cancel)(void)) {
+static void LFTextDrawInnerShadow(LFTextLayout *layout, CGContextRef context, CGSize size, CGPoint point, CGRect drawRect, BOOL (^cancel)(void)) {
     CGContextSaveGState(context);
     CGContextTranslateCTM(context, point.x, point.y);
     CGContextTranslateCTM(context, 0, size.height);
@@ -3076,6 +3117,7 @@ static void LFTextDrawInnerShadow(LFTextLayout *layout, CGContextRef context, CG
         
         LFTextLine *line = lines[l];
         if (layout.truncatedLine && layout.truncatedLine.index == line.index) line = layout.truncatedLine;
+        if (!LFTextLineIntersectsRect(line, drawRect, verticalOffset, isVertical, 0)) continue;
         NSArray *lineRunRanges = line.verticalRotateRange;
         CGContextSetTextPosition(context, line.position.x, size.height - line.position.y);
         CFArrayRef runs = CTLineGetGlyphRuns(line.CTLine);
@@ -3322,6 +3364,16 @@ static void LFTextDrawDebug(LFTextLayout *layout, CGContextRef context, CGSize s
 }
 
 
+- (void)drawInContext:(CGContextRef)context
+                 size:(CGSize)size
+                point:(CGPoint)point
+                 view:(UIView *)view
+                layer:(CALayer *)layer
+                debug:(LFTextDebugOption *)debug
+    cancellationToken:(LFCancellationToken *)token {
+    [self drawInContext:context size:size point:point view:view layer:layer debug:debug cancel:token.cancelChecker];
+}
+
 - (void)drawInContext:(CGContextRef)context
                  size:(CGSize)size
                 point:(CGPoint)point
@@ -3330,6 +3382,8 @@ static void LFTextDrawDebug(LFTextLayout *layout, CGContextRef context, CGSize s
                 debug:(LFTextDebugOption *)debug
                 cancel:(BOOL (^)(void))cancel{
     @autoreleasepool {
+        // Only the lines inside the clip are drawn, a tile draws only its part of the layout.
+        CGRect drawRect = LFTextGetDrawRect(context, point);
         if (self.needDrawBlockBorder && context) {
             if (cancel && cancel()) return;
             LFTextDrawBlockBorder(self, context, size, point, cancel);
@@ -3340,27 +3394,27 @@ static void LFTextDrawDebug(LFTextLayout *layout, CGContextRef context, CGSize s
         }
         if (self.needDrawShadow && context) {
             if (cancel && cancel()) return;
-            LFTextDrawShadow(self, context, size, point, cancel);
+            LFTextDrawShadow(self, context, size, point, drawRect, cancel);
         }
         if (self.needDrawUnderline && context) {
             if (cancel && cancel()) return;
-            LFTextDrawDecoration(self, context, size, point, LFTextDecorationTypeUnderline, cancel);
+            LFTextDrawDecoration(self, context, size, point, drawRect, LFTextDecorationTypeUnderline, cancel);
         }
         if (self.needDrawText && context) {
             if (cancel && cancel()) return;
-            LFTextDrawText(self, context, size, point, cancel);
+            LFTextDrawText(self, context, size, point, drawRect, cancel);
         }
         if (self.needDrawAttachment && (context || view || layer)) {
             if (cancel && cancel()) return;
-            LFTextDrawAttachment(self, context, size, point, view, layer, cancel);
+            LFTextDrawAttachment(self, context, size, point, drawRect, view, layer, cancel);
         }
         if (self.needDrawInnerShadow && context) {
             if (cancel && cancel()) return;
-            LFTextDrawInnerShadow(self, context, size, point, cancel);
+            LFTextDrawInnerShadow(self, context, size, point, drawRect, cancel);
         }
         if (self.needDrawStrikethrough && context) {
             if (cancel && cancel()) return;
-            LFTextDrawDecoration(self, context, size, point, LFTextDecorationTypeStrikethrough, cancel);
+            LFTextDrawDecoration(self, context, size, point, drawRect, LFTextDecorationTypeStrikethrough, cancel);
         }
         if (self.needDrawBorder && context) {
             if (cancel && cancel()) return;
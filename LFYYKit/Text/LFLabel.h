@@ -332,6 +332,20 @@
  */
 @property (nonatomic) BOOL fadeOnAsynchronouslyDisplay;
 
+/**
+ If the value is YES, and the layer is rendered asynchronously, then the rendered
+ contents are shared (through `LFRenderCache`) with the other labels which display
+ the same text in the same container and size, and the identical renders in flight
+ are merged.
+ 
+ The default value is `NO`.
+ 
+ @discussion It fits the labels which repeat the same short text, such as the
+ timestamps or the tags in a feed. The text with attachments or highlights, and the
+ `ignoreCommonProperties` mode, are always rendered by the label itself.
+ */
+@property (nonatomic) BOOL usesRenderCache;
+
 /**
  If the value is YES, then it will add a fade animation on layer when some range
  of text become highlighted. 
@@ -432,6 +446,7 @@ IB_DESIGNABLE
 @property (nonatomic) BOOL displaysAsynchronously;
 @property (nonatomic) BOOL clearContentsBeforeAsynchronouslyDisplay;
 @property (nonatomic) BOOL fadeOnAsynchronouslyDisplay;
+@property (nonatomic) BOOL usesRenderCache;
 @property (nonatomic) BOOL fadeOnHighlight;
 @property (nonatomic) BOOL ignoreCommonProperties;
 @end
@@ -9,25 +9,11 @@
 
 #import "LFLabel.h"
 #import "LFAsyncLayer.h"
+#import "LFCancellationToken.h"
 #import <LFCategory/LFCategory.h>
 #import "LFCGUtilities.h"
 #import "NSAttributedString+LFText.h"
-
-#if __has_include("LFDispatchQueuePool.h")
-#import "LFDispatchQueuePool.h"
-#else
-#import <libkern/OSAtomic.h>
-#endif
-
-#ifdef LFDispatchQueuePool_h
-static dispatch_queue_t LFLabelGetReleaseQueue() {
-    return LFDispatchQueueGetForQOS(NSQualityOfServiceUtility);
-}
-#else
-static dispatch_queue_t LFLabelGetReleaseQueue() {
-    return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0);
-}
-#endif
+#import "LFDeferredReleaseQueue.h"
 
 
 #define kLongPressMinimumDuration 0.5 // Time in seconds the fingers must be held down for long press gesture.
@@ -36,6 +22,61 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
 #define kAsyncFadeDuration 0.08 // Time in seconds for async display fadeout animation.
 
 
+static inline BOOL LFLabelObjectEqual(id a, id b) {
+    return a == b || [a isEqual:b];
+}
+
+/// The render cache key of a label's contents: the text, the container and the vertical alignment.
+@interface _LFLabelRenderKey : NSObject <NSCopying> {
+    @package
+    NSAttributedString *_text;
+    LFTextContainer *_container;
+    LFTextVerticalAlignment _verticalAlignment;
+}
+@end
+
+@implementation _LFLabelRenderKey
+
+- (NSUInteger)hash {
+    return _text.hash * 31 + _verticalAlignment;
+}
+
+- (BOOL)isEqual:(_LFLabelRenderKey *)key {
+    if (key == self) return YES;
+    if (![key isKindOfClass:[_LFLabelRenderKey class]]) return NO;
+    if (_verticalAlignment != key->_verticalAlignment) return NO;
+    LFTextContainer *a = _container, *b = key->_container;
+    if (!CGSizeEqualToSize(a.size, b.size)) return NO;
+    if (!UIEdgeInsetsEqualToEdgeInsets(a.insets, b.insets)) return NO;
+    if (a.pathLineWidth != b.pathLineWidth || a.isPathFillEvenOdd != b.isPathFillEvenOdd) return NO;
+    if (a.isVerticalForm != b.isVerticalForm) return NO;
+    if (a.maximumNumberOfRows != b.maximumNumberOfRows || a.truncationType != b.truncationType) return NO;
+    if (!LFLabelObjectEqual(a.path, b.path)) return NO;
+    if (!LFLabelObjectEqual(a.exclusionPaths, b.exclusionPaths)) return NO;
+    if (!LFLabelObjectEqual(a.truncationToken, b.truncationToken)) return NO;
+    if (!LFLabelObjectEqual(a.linePositionModifier, b.linePositionModifier)) return NO;
+    return [_text isEqualToAttributedString:key->_text];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+@end
+
+/// Whether the text draws only into the layer contents (no attachment views or highlights).
+static BOOL LFLabelTextIsRenderCacheable(NSAttributedString *text) {
+    __block BOOL cacheable = YES;
+    [text enumerateAttributesInRange:NSMakeRange(0, text.length) options:kNilOptions usingBlock:^(NSDictionary *attrs, NSRange range, BOOL *stop) {
+        if (attrs[LFTextAttachmentAttributeName] || attrs[LFTextHighlightAttributeName]) {
+            cacheable = NO;
+            *stop = YES;
+        }
+    }];
+    return cacheable;
+}
+
+
 @interface LFLabel() <LFTextDebugTarget, LFAsyncLayerDelegate> {
     NSMutableAttributedString *_innerText; ///< nonnull
     LFTextLayout *_innerLayout;
@@ -103,14 +144,14 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
     LFTextLayout *layout = _innerLayout;
     _innerLayout = nil;
     _shrinkInnerLayout = nil;
-    dispatch_async(LFLabelGetReleaseQueue(), ^{
-        NSAttributedString *text = [layout text]; // capture to block and release in background
-        if (layout.attachments.count) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [text length]; // capture to block and release in main thread (maybe there's UIView/CALayer attachments).
-            });
-        }
-    });
+    // The layout retains its text and attachments, release the whole graph on one thread:
+    // on main thread if there may be UIView/CALayer attachments.
+    LFDeferredReleaseQueue *queue = [LFDeferredReleaseQueue sharedQueue];
+    if (layout.attachments.count) {
+        [queue releaseObjectOnMainThread:layout];
+    } else {
+        [queue releaseObject:layout];
+    }
 }
 
 - (LFTextLayout *)_innerLayout {
@@ -374,13 +415,9 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
 }
 
 - (void)_clearContents {
-    CGImageRef image = (__bridge_retained CGImageRef)(self.layer.contents);
+    CGImageRef image = (__bridge CGImageRef)(self.layer.contents);
+    [[LFDeferredReleaseQueue sharedQueue] releaseImage:image];
     self.layer.contents = nil;
-    if (image) {
-        dispatch_async(LFLabelGetReleaseQueue(), ^{
-            CFRelease(image);
-        });
-    }
 }
 
 - (void)_initLabel {
@@ -1088,6 +1125,18 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
     // create display task
     LFAsyncLayerDisplayTask *task = [LFAsyncLayerDisplayTask new];
     
+    // Share the contents with the identical labels. The layout isn't updated on a cache hit,
+    // it's created lazily when needed.
+    if (_usesRenderCache && _displaysAsynchronously && !_ignoreCommonProperties &&
+        !_state.showingHighlight && !debug.needDrawDebug && text.length &&
+        LFLabelTextIsRenderCacheable(text)) {
+        _LFLabelRenderKey *key = [_LFLabelRenderKey new];
+        key->_text = layoutNeedUpdate ? text : text.copy;
+        key->_container = layoutNeedUpdate ? container : container.copy;
+        key->_verticalAlignment = verticalAlignment;
+        task.contentKey = key;
+    }
+    
     task.willDisplay = ^(CALayer *layer) {
         [layer removeAnimationForKey:@"contents"];
         
@@ -1111,15 +1160,18 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
         [attachmentLayers removeAllObjects];
     };
 
-    task.display = ^(CGContextRef context, CGSize size, BOOL (^isCancelled)(void)) {
-        if (isCancelled()) return;
+    task.displayWithCancellationToken = ^(CGContextRef context, CGSize size, LFCancellationToken *token) {
+        if (token.isCancelled) return;
         if (text.length == 0) return;
         
         LFTextLayout *drawLayout = layout;
         if (layoutNeedUpdate) {
-            layout = [LFTextLayout layoutWithContainer:container text:text];
+            // the layout is abandoned as soon as the label is redisplayed
+            LFTextLayout *newLayout = [LFTextLayout layoutWithContainer:container text:text range:NSMakeRange(0, text.length) cancellationToken:token];
+            if (!newLayout || token.isCancelled) return;
+            layout = newLayout;
             shrinkLayout = [LFLabel _shrinkLayoutWithLayout:layout];
-            if (isCancelled()) return;
+            if (token.isCancelled) return;
             layoutUpdated = YES;
             drawLayout = shrinkLayout ? shrinkLayout : layout;
         }
@@ -1140,13 +1192,15 @@ static dispatch_queue_t LFLabelGetReleaseQueue() {
             }
         }
         point = CGPointPixelRound(point);
-        [drawLayout drawInContext:context size:size point:point view:nil layer:nil debug:debug cancel:isCancelled];
+        [drawLayout drawInContext:context size:size point:point view:nil layer:nil debug:debug cancellationToken:token];
     };
 
     task.didDisplay = ^(CALayer *layer, BOOL finished) {
         LFTextLayout *drawLayout = layout;
         if (layoutUpdated && shrinkLayout) {
             drawLayout = shrinkLayout;
+        } else if (layoutNeedUpdate && !layoutUpdated) {
+            drawLayout = nil; // the contents came from the render cache, the old layout is stale
         }
         if (!finished) {
             // If the display task is cancelled, we should clear the attachments.
@@ -225,6 +225,13 @@
  */
 @property (nonatomic, copy) LFTextDebugOption *debugOption;
 
+/**
+ Whether the text is rendered asynchronously in tiles: only the tiles near the
+ visible area are rendered and kept, and an edit redraws only the tiles of the
+ changed lines. It's intended for long documents. Default is NO.
+ */
+@property (nonatomic, assign) BOOL displaysAsynchronouslyInTiles;
+
 
 #pragma mark - Working with the Selection and Menu
 ///=============================================================================
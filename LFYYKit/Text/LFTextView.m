@@ -180,7 +180,9 @@ typedef NS_ENUM(NSUInteger, LFTextMoveDirection) {
 /// Update layout and selection before runloop sleep/end.
 - (void)_commitUpdate {
     _state.needUpdate = YES;
-    [[LFTransaction transactionWithTarget:self selector:@selector(_updateIfNeeded)] commit];
+    // the text view being edited goes first, when the updates are spread over frames
+    LFTransactionPriority priority = self.isFirstResponder ? LFTransactionPriorityHigh : LFTransactionPriorityDefault;
+    [LFTransaction commitWithTarget:self selector:@selector(_updateIfNeeded) priority:priority];
 }
 
 /// Update layout and selection view if needed.
@@ -323,7 +325,7 @@ typedef NS_ENUM(NSUInteger, LFTextMoveDirection) {
 /// Update placeholder before runloop sleep/end.
 - (void)_commitPlaceholderUpdate {
     _state.placeholderNeedUpdate = YES;
-    [[LFTransaction transactionWithTarget:self selector:@selector(_updatePlaceholderIfNeeded)] commit];
+    [LFTransaction commitWithTarget:self selector:@selector(_updatePlaceholderIfNeeded) priority:LFTransactionPriorityLow];
 }
 
 /// Update placeholder if needed.
@@ -2247,6 +2249,14 @@ typedef NS_ENUM(NSUInteger, LFTextMoveDirection) {
     return _containerView.debugOption;
 }
 
+- (void)setDisplaysAsynchronouslyInTiles:(BOOL)displaysAsynchronouslyInTiles {
+    _containerView.displaysAsynchronouslyInTiles = displaysAsynchronouslyInTiles;
+}
+
+- (BOOL)displaysAsynchronouslyInTiles {
+    return _containerView.displaysAsynchronouslyInTiles;
+}
+
 - (LFTextLayout *)textLayout {
     [self _updateIfNeeded];
     return _innerLayout;
@@ -2341,6 +2351,7 @@ typedef NS_ENUM(NSUInteger, LFTextMoveDirection) {
 - (void)setBounds:(CGRect)bounds {
     CGSize oldSize = self.bounds.size;
     [super setBounds:bounds];
+    if (_containerView.displaysAsynchronouslyInTiles) [_containerView updateVisibleTiles]; // scrolled
     CGSize newSize = self.bounds.size;
     BOOL changed = _innerContainer.isVerticalForm ? (oldSize.height != newSize.height) : (oldSize.width != newSize.width);
     if (changed) {
@@ -11,7 +11,7 @@
 #import <UIKit/UIKit.h>
 #import <QuartzCore/QuartzCore.h>
 
-@class LFAsyncLayerDisplayTask;
+@class LFAsyncLayerDisplayTask, LFCancellationToken;
 
 
 /**
@@ -23,6 +23,44 @@
 @interface LFAsyncLayer : CALayer
 /// Whether the render code is executed in background. Default is YES.
 @property BOOL displaysAsynchronously;
+
+/**
+ Whether the contents are rendered in tiles. Default is NO.
+ 
+ @discussion In tiled mode, the layer shows its contents in tile sublayers of `tileSize`,
+ and renders only the tiles near the visible area of the window, in parallel. The tiles
+ farther than `tileEvictionDistance` are removed. `setNeedsDisplayInRect:` redraws only
+ the tiles intersecting the rect, `setNeedsDisplay` redraws all of them.
+ 
+ The display task's `display` block may be called concurrently for different tiles, with
+ the context translated and clipped to the tile, so it must be thread-safe. It should
+ skip what is outside `CGContextGetClipBoundingBox`, as LFTextLayout does. `didDisplay`
+ is called once the tiles scheduled by the display pass are finished.
+ 
+ Tiles are only used when `displaysAsynchronously` is YES.
+ */
+@property (nonatomic, getter=isTiled) BOOL tiled;
+
+/// The tile size in points. Default is {512, 512}.
+@property (nonatomic) CGSize tileSize;
+
+/// The distance in points around the visible area in which the tiles are rendered ahead. Default is 512.
+@property (nonatomic) CGFloat tilePrefetchDistance;
+
+/// The distance in points from the visible area beyond which the tiles are removed. Default is 1536.
+@property (nonatomic) CGFloat tileEvictionDistance;
+
+/**
+ Renders the missing tiles near the visible area and removes the far ones.
+ Call it when the layer moves relative to the window, such as when its scroll view scrolls.
+ */
+- (void)updateVisibleTiles;
+
+/**
+ Cancels the renders in flight (including the tiles), their cancellation tokens are
+ cancelled. `setNeedsDisplay` calls it.
+ */
+- (void)cancelAsyncDisplay;
 @end
 
 
@@ -54,7 +92,8 @@
  This block is called to draw the layer's contents.
  
  @discussion This block may be called on main thread or background thread,
- so is should be thread-safe.
+ so is should be thread-safe. In tiled mode, it may be called concurrently for
+ different tiles.
  
  param context      A new bitmap content created by layer.
  param size         The content size (typically same as layer's bound size).
@@ -63,6 +102,20 @@
  */
 @property (nonatomic, copy) void (^display)(CGContextRef context, CGSize size, BOOL(^isCancelled)(void));
 
+/**
+ This block is called to draw the layer's contents, instead of `display` if it's set.
+ 
+ @discussion It's the same as `display`, with the cancellation token of the render, so
+ the work started for the render (such as the text layout) can be cancelled with it.
+ The token is cancelled when the layer is redisplayed or deallocated, or the tile is
+ invalidated.
+ 
+ param context  A new bitmap content created by layer.
+ param size     The content size (typically same as layer's bound size).
+ param token    The cancellation token of the render.
+ */
+@property (nonatomic, copy) void (^displayWithCancellationToken)(CGContextRef context, CGSize size, LFCancellationToken *token);
+
 /**
  This block will be called after the asynchronous drawing finished.
  It will be called on the main thread.
@@ -72,4 +125,14 @@
  */
 @property (nonatomic, copy) void (^didDisplay)(CALayer *layer, BOOL finished);
 
+/**
+ If not nil, the rendered contents are shared through `LFRenderCache` with the other
+ displays which have an equal key, at the same size, scale and opaque flag: a cached
+ image is used without calling `display`, and identical renders in flight are merged.
+ 
+ @discussion The key must implement `isEqual:` and `hash`, and describe everything
+ the `display` block draws. It's ignored in tiled mode. Default is nil.
+ */
+@property (nonatomic, strong) id contentKey;
+
 @end
@@ -9,52 +9,50 @@
 //
 
 #import "LFAsyncLayer.h"
-#import "LFSentinel.h"
-
-#if __has_include("LFDispatchQueuePool.h")
-#import "LFDispatchQueuePool.h"
-#else
-#import <libkern/OSAtomic.h>
-#endif
-
-/// Global display queue, used for content rendering.
-static dispatch_queue_t LFAsyncLayerGetDisplayQueue() {
-#ifdef LFDispatchQueuePool_h
-    return LFDispatchQueueGetForQOS(NSQualityOfServiceUserInitiated);
-#else
-#define MAX_QUEUE_COUNT 16
-    static int queueCount;
-    static dispatch_queue_t queues[MAX_QUEUE_COUNT];
-    static dispatch_once_t onceToken;
-    static int32_t counter = 0;
-    dispatch_once(&onceToken, ^{
-        queueCount = (int)[NSProcessInfo processInfo].activeProcessorCount;
-        queueCount = queueCount < 1 ? 1 : queueCount > MAX_QUEUE_COUNT ? MAX_QUEUE_COUNT : queueCount;
-        if ([UIDevice currentDevice].systemVersion.floatValue >= 8.0) {
-            for (NSUInteger i = 0; i < queueCount; i++) {
-                dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
-                queues[i] = dispatch_queue_create("com.laifeng.kit.render", attr);
-            }
-        } else {
-            for (NSUInteger i = 0; i < queueCount; i++) {
-                queues[i] = dispatch_queue_create("com.laifeng.kit.render", DISPATCH_QUEUE_SERIAL);
-                dispatch_set_target_queue(queues[i], dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
-            }
-        }
-    });
-    int32_t cur = OSAtomicIncrement32(&counter);
-    if (cur < 0) cur = -cur;
-    return queues[(cur) % queueCount];
-#undef MAX_QUEUE_COUNT
-#endif
+#import "LFCancellationToken.h"
+#import "LFRenderScheduler.h"
+#import "LFBitmapPool.h"
+#import "LFRenderCommitQueue.h"
+#import "LFRenderCache.h"
+#import "LFDeferredReleaseQueue.h"
+
+#define DISPLAY_VISIBLE_DEADLINE (1.0 / 60) // A visible layer should start rendering within a frame.
+#define DISPLAY_DETACHED_DEADLINE 1.0       // A layer out of any window.
+#define DISPLAY_SCROLL_SPEED 2000.0         // Points per second, an offscreen layer is expected to reach the screen at this speed.
+#define DISPLAY_EXPIRED_RETRY_LIMIT 3       // An expired render is retried this many times, then only when the layer gets closer.
+#define DISPLAY_EXPIRED_RETRY_DELAY 0.1     // The delay before retrying an expired render, doubled for each retry.
+#define DISPLAY_EXPIRED_RETRY_MAX_DELAY 1.6
+
+/// Applies a render result on the main thread, batched with the other results of the frame.
+static inline void LFAsyncLayerCommit(dispatch_block_t block) {
+    [[LFRenderCommitQueue sharedQueue] enqueueCommit:block];
+}
+
+/// Whether the task has a display block.
+static inline BOOL LFAsyncLayerTaskCanDisplay(LFAsyncLayerDisplayTask *task) {
+    return task.display || task.displayWithCancellationToken;
+}
+
+/// Calls the display block of the task.
+static void LFAsyncLayerTaskDisplay(LFAsyncLayerDisplayTask *task, CGContextRef context, CGSize size, LFCancellationToken *token) {
+    if (task.displayWithCancellationToken) {
+        task.displayWithCancellationToken(context, size, token);
+    } else {
+        task.display(context, size, token.cancelChecker);
+    }
+}
+
+/// Returns the bytes of the bitmap a render allocates, counted against the render memory budget.
+static inline uint64_t LFAsyncLayerBitmapCost(CGSize size, CGFloat scale) {
+    return (uint64_t)ceil(size.width * scale) * (uint64_t)ceil(size.height * scale) * 4;
 }
 
-static dispatch_queue_t LFAsyncLayerGetReleaseQueue() {
-#ifdef LFDispatchQueuePool_h
-    return LFDispatchQueueGetForQOS(NSQualityOfServiceDefault);
-#else
-    return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0);
-#endif
+/// Returns the distance between two rects, 0 if they intersect.
+static CGFloat LFAsyncLayerRectDistance(CGRect rect, CGRect other) {
+    if (CGRectIsNull(rect) || CGRectIsNull(other)) return CGFLOAT_MAX;
+    CGFloat dx = MAX(CGRectGetMinX(other) - CGRectGetMaxX(rect), CGRectGetMinX(rect) - CGRectGetMaxX(other));
+    CGFloat dy = MAX(CGRectGetMinY(other) - CGRectGetMaxY(rect), CGRectGetMinY(rect) - CGRectGetMaxY(other));
+    return MAX(0, MAX(dx, dy));
 }
 
 
@@ -62,8 +60,36 @@ static dispatch_queue_t LFAsyncLayerGetReleaseQueue() {
 @end
 
 
+/// A tile of a tiled LFAsyncLayer.
+@interface _LFAsyncLayerTile : NSObject
+@property (nonatomic, strong) CALayer *layer;
+@property (nonatomic, assign) CGRect rect;
+@property (nonatomic, strong) LFCancellationToken *token; ///< a child of the layer's token, cancelled when the tile is invalidated
+@property (nonatomic, assign) BOOL valid; ///< the contents are up to date
+@property (nonatomic, strong) LFCancellationToken *renderingToken; ///< the token of the render in flight
+@end
+
+@implementation _LFAsyncLayerTile
+@end
+
+
 @implementation LFAsyncLayer {
-    LFSentinel *_sentinel;
+    LFCancellationToken *_displayToken; ///< cancelled and replaced when the display is cancelled
+    
+    // tiled mode, main thread only
+    NSMutableDictionary *_tiles; ///< (row << 32 | column) -> _LFAsyncLayerTile
+    CGSize _tileLayoutSize; ///< the bounds size of the tiles
+    CGRect _tileDirtyRect; ///< the rect to redraw in the next display pass
+    BOOL _markingNeedsDisplay;
+    LFAsyncLayerDisplayTask *_tileTask; ///< the task of the last display pass
+    NSUInteger _tilePass; ///< the last display pass
+    NSUInteger _tilePendingCount; ///< unfinished renders of the last display pass
+    BOOL _tilePassFinished; ///< whether didDisplay was called for the last display pass
+    
+    // expired renders, main thread only
+    BOOL _expiredPending; ///< the last render expired, and waits for a retry
+    NSUInteger _expiredCount; ///< the consecutive expired renders
+    CGFloat _expiredDistance; ///< the distance to the window when the last render expired
 }
 
 #pragma mark - Override
@@ -84,18 +110,42 @@ static dispatch_queue_t LFAsyncLayerGetReleaseQueue() {
         scale = [UIScreen mainScreen].scale;
     });
     self.contentsScale = scale;
-    _sentinel = [LFSentinel new];
+    _displayToken = [LFCancellationToken new];
     _displaysAsynchronously = YES;
+    _tileSize = CGSizeMake(512, 512);
+    _tilePrefetchDistance = 512;
+    _tileEvictionDistance = 1536;
+    _tileDirtyRect = CGRectNull;
+    _tilePassFinished = YES;
     return self;
 }
 
 - (void)dealloc {
-    [_sentinel increase];
+    [_displayToken cancel];
 }
 
 - (void)setNeedsDisplay {
-    [self _cancelAsyncDisplay];
+    if (_markingNeedsDisplay) { // called by setNeedsDisplayInRect:
+        [super setNeedsDisplay];
+        return;
+    }
+    [self cancelAsyncDisplay];
+    _tileDirtyRect = CGRectInfinite;
+    _markingNeedsDisplay = YES;
     [super setNeedsDisplay];
+    _markingNeedsDisplay = NO;
+}
+
+- (void)setNeedsDisplayInRect:(CGRect)rect {
+    if (!_tiled || _markingNeedsDisplay) {
+        [super setNeedsDisplayInRect:rect];
+        return;
+    }
+    // Only the tiles intersecting the rect are redrawn, the others keep rendering.
+    _tileDirtyRect = CGRectUnion(_tileDirtyRect, rect);
+    _markingNeedsDisplay = YES;
+    [super setNeedsDisplayInRect:rect];
+    _markingNeedsDisplay = NO;
 }
 
 - (void)display {
@@ -106,72 +156,126 @@ static dispatch_queue_t LFAsyncLayerGetReleaseQueue() {
 #pragma mark - Private
 
 - (void)_displayAsync:(BOOL)async {
+    _expiredPending = NO;
     __strong id<LFAsyncLayerDelegate> delegate = (id<LFAsyncLayerDelegate>)self.delegate;
     LFAsyncLayerDisplayTask *task = [delegate newAsyncDisplayTask];
-    if (!task.display) {
+    if (!LFAsyncLayerTaskCanDisplay(task)) {
+        [self _clearTiles];
         if (task.willDisplay) task.willDisplay(self);
         self.contents = nil;
         if (task.didDisplay) task.didDisplay(self, YES);
         return;
     }
     
-    if (async) {
+    if (async && _tiled) {
+        [self _displayTiles:task];
+    } else if (async) {
+        [self _clearTiles];
         if (task.willDisplay) task.willDisplay(self);
-        LFSentinel *sentinel = _sentinel;
-        int32_t value = sentinel.value;
-        BOOL (^isCancelled)() = ^BOOL() {
-            return value != sentinel.value;
-        };
+        LFCancellationToken *token = _displayToken;
+        BOOL (^isCancelled)(void) = token.cancelChecker;
         CGSize size = self.bounds.size;
         BOOL opaque = self.opaque;
         CGFloat scale = self.contentsScale;
         if (size.width < 1 || size.height < 1) {
-            CGImageRef image = (__bridge_retained CGImageRef)(self.contents);
+            CGImageRef image = (__bridge CGImageRef)(self.contents);
+            [[LFDeferredReleaseQueue sharedQueue] releaseImage:image];
             self.contents = nil;
-            if (image) {
-                dispatch_async(LFAsyncLayerGetReleaseQueue(), ^{
-                    CFRelease(image);
-                });
-            }
             if (task.didDisplay) task.didDisplay(self, YES);
             return;
         }
         
-        dispatch_async(LFAsyncLayerGetDisplayQueue(), ^{
-            if (isCancelled()) return;
-            UIGraphicsBeginImageContextWithOptions(size, opaque, scale);
-            CGContextRef context = UIGraphicsGetCurrentContext();
-            task.display(context, size, isCancelled);
+        // Share the contents of the identical displays, see LFRenderCache.
+        LFRenderCache *cache = task.contentKey ? [LFRenderCache sharedCache] : nil;
+        id cacheKey = [cache keyForContentKey:task.contentKey size:size scale:scale opaque:opaque];
+        if (cacheKey) {
+            id cachedImage = [cache imageForKey:cacheKey];
+            if (cachedImage) {
+                _expiredCount = 0;
+                self.contents = cachedImage;
+                if (task.didDisplay) task.didDisplay(self, YES);
+                return;
+            }
+            BOOL render = [cache beginRenderForKey:cacheKey completion:^(id image) {
+                LFAsyncLayerCommit(^{
+                    if (isCancelled()) {
+                        if (task.didDisplay) task.didDisplay(self, NO);
+                    } else if (image) {
+                        self.contents = image;
+                        if (task.didDisplay) task.didDisplay(self, YES);
+                    } else {
+                        // The identical render was cancelled, render again.
+                        if (task.didDisplay) task.didDisplay(self, NO);
+                        [self setNeedsDisplay];
+                    }
+                });
+            }];
+            if (!render) return; // an identical render is in flight
+        }
+        void (^finishCache)(id image) = ^(id image) {
+            if (cacheKey) [cache finishRenderForKey:cacheKey image:image cost:LFAsyncLayerBitmapCost(size, scale)];
+        };
+        
+        BOOL droppable = NO;
+        CFTimeInterval deadline = [self _displayDeadline:&droppable];
+        dispatch_block_t expired = nil;
+        if (droppable) {
+            // The layer was offscreen and the render didn't start in time, redisplay
+            // it later with a new deadline, instead of rendering for a stale position.
+            expired = ^{
+                finishCache(nil);
+                LFAsyncLayerCommit(^{
+                    if (task.didDisplay) task.didDisplay(self, NO);
+                    if (!isCancelled()) [self _didExpireDisplay];
+                });
+            };
+        }
+        
+        [[LFRenderScheduler sharedScheduler] scheduleTask:^{
             if (isCancelled()) {
-                UIGraphicsEndImageContext();
-                dispatch_async(dispatch_get_main_queue(), ^{
+                finishCache(nil);
+                return;
+            }
+            // Draw into a pooled buffer, it's recycled when these contents are replaced.
+            LFBitmapBackingStore *store = [[LFBitmapPool sharedPool] backingStoreWithSize:size opaque:opaque scale:scale];
+            CGContextRef context = store.context;
+            if (context) {
+                UIGraphicsPushContext(context);
+                LFAsyncLayerTaskDisplay(task, context, size, token);
+                UIGraphicsPopContext();
+            }
+            if (!context || isCancelled()) {
+                finishCache(nil);
+                LFAsyncLayerCommit(^{
                     if (task.didDisplay) task.didDisplay(self, NO);
                 });
                 return;
             }
-            UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
-            UIGraphicsEndImageContext();
+            id image = (__bridge_transfer id)[store newImage];
+            finishCache(image);
             if (isCancelled()) {
-                dispatch_async(dispatch_get_main_queue(), ^{
+                LFAsyncLayerCommit(^{
                     if (task.didDisplay) task.didDisplay(self, NO);
                 });
                 return;
             }
-            dispatch_async(dispatch_get_main_queue(), ^{
+            LFAsyncLayerCommit(^{
                 if (isCancelled()) {
                     if (task.didDisplay) task.didDisplay(self, NO);
                 } else {
-                    self.contents = (__bridge id)(image.CGImage);
+                    _expiredCount = 0;
+                    self.contents = image;
                     if (task.didDisplay) task.didDisplay(self, YES);
                 }
             });
-        });
+        } deadline:deadline cost:LFAsyncLayerBitmapCost(size, scale) expired:expired];
     } else {
-        [_sentinel increase];
+        [self cancelAsyncDisplay];
+        [self _clearTiles];
         if (task.willDisplay) task.willDisplay(self);
         UIGraphicsBeginImageContextWithOptions(self.bounds.size, self.opaque, self.contentsScale);
         CGContextRef context = UIGraphicsGetCurrentContext();
-        task.display(context, self.bounds.size, ^{return NO;});
+        LFAsyncLayerTaskDisplay(task, context, self.bounds.size, _displayToken);
         UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
         UIGraphicsEndImageContext();
         self.contents = (__bridge id)(image.CGImage);
@@ -179,8 +283,245 @@ static dispatch_queue_t LFAsyncLayerGetReleaseQueue() {
     }
 }
 
-- (void)_cancelAsyncDisplay {
-    [_sentinel increase];
+/**
+ Returns the time by which the render of the layer should start: within a frame if the
+ layer is visible, later the farther it is from the window bounds.
+ `droppable` is set to YES if the layer is not visible.
+ */
+- (CFTimeInterval)_displayDeadline:(BOOL *)droppable {
+    CFTimeInterval now = CACurrentMediaTime();
+    CGFloat distance = [self _windowDistance];
+    *droppable = distance > 0;
+    if (distance == CGFLOAT_MAX) return now + DISPLAY_DETACHED_DEADLINE;
+    return now + DISPLAY_VISIBLE_DEADLINE + distance / DISPLAY_SCROLL_SPEED;
+}
+
+/// Returns the distance from the layer to the window bounds: 0 if it's visible or not
+/// the layer of a view, CGFLOAT_MAX if it's out of any window.
+- (CGFloat)_windowDistance {
+    id delegate = self.delegate;
+    if (![delegate isKindOfClass:[UIView class]]) return 0;
+    UIWindow *window = ((UIView *)delegate).window;
+    if (!window) return CGFLOAT_MAX;
+    CGRect rect = [self convertRect:self.bounds toLayer:window.layer];
+    return LFAsyncLayerRectDistance(rect, window.bounds);
+}
+
+/**
+ Called when a render expired. It's retried after a delay, which doubles with each
+ consecutive expiry. After DISPLAY_EXPIRED_RETRY_LIMIT retries, the layer stays dirty
+ and is rendered again only once it's closer to the window than when it expired, so
+ a layer which is offscreen under load doesn't render and expire forever.
+ */
+- (void)_didExpireDisplay {
+    _expiredPending = YES;
+    _expiredCount++;
+    _expiredDistance = [self _windowDistance];
+    [self _scheduleExpiredRetry:_displayToken];
+}
+
+- (void)_scheduleExpiredRetry:(LFCancellationToken *)token {
+    NSUInteger shift = MIN(_expiredCount - 1, 8);
+    NSTimeInterval delay = MIN(DISPLAY_EXPIRED_RETRY_DELAY * (1 << shift), DISPLAY_EXPIRED_RETRY_MAX_DELAY);
+    __weak LFAsyncLayer *_self = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [_self _retryExpiredDisplay:token];
+    });
+}
+
+- (void)_retryExpiredDisplay:(LFCancellationToken *)token {
+    // displayed or invalidated since
+    if (!_expiredPending || token != _displayToken || token.isCancelled) return;
+    if (_expiredCount <= DISPLAY_EXPIRED_RETRY_LIMIT || [self _windowDistance] < _expiredDistance) {
+        _expiredPending = NO;
+        [self setNeedsDisplay];
+    } else {
+        [self _scheduleExpiredRetry:token]; // only check the position again
+    }
+}
+
+- (void)cancelAsyncDisplay {
+    // The tiles' tokens are the children of the display token.
+    [_displayToken cancel];
+    _displayToken = [LFCancellationToken new];
+}
+
+#pragma mark - Tiles
+
+- (void)setTiled:(BOOL)tiled {
+    if (_tiled == tiled) return;
+    _tiled = tiled;
+    [self setNeedsDisplay];
+}
+
+- (void)setTileSize:(CGSize)tileSize {
+    if (tileSize.width < 1 || tileSize.height < 1 || CGSizeEqualToSize(_tileSize, tileSize)) return;
+    _tileSize = tileSize;
+    [self _removeAllTiles];
+    if (_tiled) [self setNeedsDisplay];
+}
+
+/// Returns the part of the bounds visible in the window. If the layer is not in a
+/// window, returns the top of the bounds, the size of the screen.
+- (CGRect)_visibleRect {
+    CGRect bounds = self.bounds;
+    id delegate = self.delegate;
+    UIWindow *window = [delegate isKindOfClass:[UIView class]] ? ((UIView *)delegate).window : nil;
+    if (!window) {
+        CGSize screenSize = [UIScreen mainScreen].bounds.size;
+        return CGRectIntersection(bounds, (CGRect){bounds.origin, screenSize});
+    }
+    CGRect visible = [window.layer convertRect:window.bounds toLayer:self];
+    return CGRectIntersection(bounds, visible);
+}
+
+/// Leaves tiled mode, the pass in flight is reported as unfinished.
+- (void)_clearTiles {
+    [self _finishTilePass:NO];
+    [self _removeAllTiles];
+}
+
+- (void)_removeAllTiles {
+    if (_tiles.count == 0) return;
+    for (_LFAsyncLayerTile *tile in _tiles.allValues) {
+        [tile.token cancel];
+        [tile.layer removeFromSuperlayer];
+    }
+    [_tiles removeAllObjects];
+}
+
+- (void)_displayTiles:(LFAsyncLayerDisplayTask *)task {
+    [self _finishTilePass:NO];
+    if (task.willDisplay) task.willDisplay(self);
+    self.contents = nil;
+    
+    CGSize size = self.bounds.size;
+    if (!CGSizeEqualToSize(size, _tileLayoutSize)) {
+        [self _removeAllTiles];
+        _tileLayoutSize = size;
+    }
+    CGRect dirtyRect = _tileDirtyRect;
+    _tileDirtyRect = CGRectNull;
+    for (_LFAsyncLayerTile *tile in _tiles.allValues) {
+        if (CGRectIntersectsRect(tile.rect, dirtyRect)) {
+            tile.valid = NO;
+            [tile.token cancel];
+        }
+    }
+    
+    _tileTask = task;
+    _tilePass++;
+    _tilePendingCount = 0;
+    _tilePassFinished = NO;
+    [self _updateTilesInPass:YES];
+    if (_tilePendingCount == 0) [self _finishTilePass:YES];
+}
+
+/// Calls didDisplay for the last display pass, if it's not called yet.
+- (void)_finishTilePass:(BOOL)finished {
+    if (_tilePassFinished) return;
+    _tilePassFinished = YES;
+    if (_tileTask.didDisplay) _tileTask.didDisplay(self, finished);
+}
+
+- (void)updateVisibleTiles {
+    [self _updateTilesInPass:NO];
+}
+
+- (void)_updateTilesInPass:(BOOL)inPass {
+    if (!_tiled || !LFAsyncLayerTaskCanDisplay(_tileTask)) return;
+    CGRect bounds = self.bounds;
+    if (bounds.size.width < 1 || bounds.size.height < 1) {
+        [self _removeAllTiles];
+        return;
+    }
+    if (!_tiles) _tiles = [NSMutableDictionary new];
+    CGRect visible = [self _visibleRect];
+    
+    for (NSNumber *key in _tiles.allKeys) {
+        _LFAsyncLayerTile *tile = _tiles[key];
+        if (LFAsyncLayerRectDistance(tile.rect, visible) > _tileEvictionDistance) {
+            [tile.token cancel];
+            [tile.layer removeFromSuperlayer];
+            [_tiles removeObjectForKey:key];
+        }
+    }
+    
+    if (CGRectIsNull(visible)) return;
+    CGRect prefetch = CGRectIntersection(CGRectInset(visible, -_tilePrefetchDistance, -_tilePrefetchDistance), bounds);
+    if (CGRectIsEmpty(prefetch)) return;
+    CGSize tileSize = _tileSize;
+    int64_t minColumn = floor((CGRectGetMinX(prefetch) - CGRectGetMinX(bounds)) / tileSize.width);
+    int64_t maxColumn = ceil((CGRectGetMaxX(prefetch) - CGRectGetMinX(bounds)) / tileSize.width);
+    int64_t minRow = floor((CGRectGetMinY(prefetch) - CGRectGetMinY(bounds)) / tileSize.height);
+    int64_t maxRow = ceil((CGRectGetMaxY(prefetch) - CGRectGetMinY(bounds)) / tileSize.height);
+    CFTimeInterval now = CACurrentMediaTime();
+    for (int64_t row = minRow; row < maxRow; row++) {
+        for (int64_t column = minColumn; column < maxColumn; column++) {
+            NSNumber *key = @(row << 32 | column);
+            _LFAsyncLayerTile *tile = _tiles[key];
+            if (!tile) {
+                CGRect rect = CGRectMake(CGRectGetMinX(bounds) + column * tileSize.width,
+                                         CGRectGetMinY(bounds) + row * tileSize.height,
+                                         tileSize.width, tileSize.height);
+                rect = CGRectIntersection(rect, bounds);
+                if (CGRectIsEmpty(rect)) continue;
+                tile = [_LFAsyncLayerTile new];
+                tile.rect = rect;
+                tile.layer = [CALayer layer];
+                tile.layer.actions = @{@"contents" : [NSNull null], @"position" : [NSNull null], @"bounds" : [NSNull null]};
+                tile.layer.frame = rect;
+                tile.layer.contentsScale = self.contentsScale;
+                tile.layer.opaque = self.opaque;
+                [self insertSublayer:tile.layer atIndex:0]; // below the attachments
+                _tiles[key] = tile;
+            }
+            if (tile.valid || (tile.renderingToken && tile.renderingToken == tile.token && !tile.token.isCancelled)) continue;
+            if (!tile.token || tile.token.isCancelled) tile.token = [_displayToken newChildToken];
+            CGFloat distance = LFAsyncLayerRectDistance(tile.rect, visible);
+            CFTimeInterval deadline = now + DISPLAY_VISIBLE_DEADLINE + distance / DISPLAY_SCROLL_SPEED;
+            [self _renderTile:tile deadline:deadline pass:inPass ? _tilePass : 0];
+            if (inPass) _tilePendingCount++;
+        }
+    }
+}
+
+- (void)_renderTile:(_LFAsyncLayerTile *)tile deadline:(CFTimeInterval)deadline pass:(NSUInteger)pass {
+    LFAsyncLayerDisplayTask *task = _tileTask;
+    LFCancellationToken *token = tile.token; // cancelled with the layer's display token too
+    CGRect rect = tile.rect;
+    CGSize size = self.bounds.size;
+    BOOL opaque = self.opaque;
+    CGFloat scale = self.contentsScale;
+    tile.renderingToken = token;
+    
+    [[LFRenderScheduler sharedScheduler] scheduleTask:^{
+        id image = nil;
+        if (!token.isCancelled) {
+            LFBitmapBackingStore *store = [[LFBitmapPool sharedPool] backingStoreWithSize:rect.size opaque:opaque scale:scale];
+            CGContextRef context = store.context;
+            if (context) {
+                // The task draws in the layer's bounds, clipped to the tile, the drawing code
+                // skips what is outside the clip bounding box (LFTextLayout skips the lines).
+                CGContextTranslateCTM(context, -rect.origin.x, -rect.origin.y);
+                CGContextClipToRect(context, rect);
+                UIGraphicsPushContext(context);
+                LFAsyncLayerTaskDisplay(task, context, size, token);
+                UIGraphicsPopContext();
+                if (!token.isCancelled) image = (__bridge_transfer id)[store newImage];
+            }
+        }
+        LFAsyncLayerCommit(^{
+            if (tile.renderingToken == token) tile.renderingToken = nil;
+            if (image && !token.isCancelled) {
+                tile.layer.contents = image;
+                tile.valid = YES;
+            }
+            if (pass && pass == _tilePass && _tilePendingCount > 0) {
+                if (--_tilePendingCount == 0) [self _finishTilePass:!token.isCancelled];
+            }
+        });
+    } deadline:deadline cost:LFAsyncLayerBitmapCost(rect.size, scale) expired:nil];
 }
 
 @end
@@ -0,0 +1,94 @@
+//
+//  LFBitmapPool.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <UIKit/UIKit.h>
+
+#ifndef LFBitmapPool_h
+#define LFBitmapPool_h
+
+/**
+ A bitmap context drawing into a pooled buffer, see `LFBitmapPool`.
+
+ @discussion The context is set up like `UIGraphicsBeginImageContextWithOptions`
+ (top-left origin, scaled), but it's not pushed as the UIKit current context.
+ The buffer goes back to the pool when the backing store is released, or when the
+ image created by `newImage` is released.
+ */
+@interface LFBitmapBackingStore : NSObject
+- (instancetype)init UNAVAILABLE_ATTRIBUTE;
++ (instancetype)new UNAVAILABLE_ATTRIBUTE;
+
+/// The bitmap context, NULL after `newImage` is called.
+@property (nonatomic, readonly) CGContextRef context;
+
+/// The size in points.
+@property (nonatomic, readonly) CGSize size;
+
+/// The scale factor.
+@property (nonatomic, readonly) CGFloat scale;
+
+/// The size of the buffer in bytes.
+@property (nonatomic, readonly) size_t byteCount;
+
+/**
+ Returns an image which wraps the buffer without copying it. The context is released
+ and can't be used anymore. Returns NULL if it was already called.
+ */
+- (CGImageRef)newImage CF_RETURNS_RETAINED;
+
+@end
+
+
+/**
+ A pool of reusable bitmap buffers, used by LFAsyncLayer to render contents.
+
+ @discussion Creating a new bitmap context for every redraw allocates and zero-fills
+ a new buffer, and faults its pages in. The pool keeps the buffers of the released
+ contents, grouped by size, and hands them out again for the next renders of about the
+ same size. A reused buffer is cleared before drawing.
+
+ The buffers are freed when the pool exceeds `maxPooledBytes`, when the app receives
+ a memory warning, and when it enters background.
+ */
+@interface LFBitmapPool : NSObject
+
+/// The shared pool.
++ (instancetype)sharedPool;
+
+/**
+ Returns a backing store from the pool, or a new one.
+ @param size   The size in points.
+ @param opaque Whether the bitmap is opaque.
+ @param scale  The scale factor.
+ @return A backing store, or nil if the size is empty or an error occurs.
+ */
+- (LFBitmapBackingStore *)backingStoreWithSize:(CGSize)size opaque:(BOOL)opaque scale:(CGFloat)scale;
+
+/// The maximum bytes of the pooled (unused) buffers. Default is 16MB.
+@property NSUInteger maxPooledBytes;
+
+/// The bytes of the pooled (unused) buffers.
+@property (readonly) NSUInteger pooledBytes;
+
+/// The number of pooled (unused) buffers.
+@property (readonly) NSUInteger pooledBufferCount;
+
+/// The number of backing stores which reused a pooled buffer.
+@property (readonly) uint64_t hitCount;
+
+/// The number of backing stores which allocated a new buffer.
+@property (readonly) uint64_t missCount;
+
+/// Frees all the pooled buffers.
+- (void)removeAllBuffers;
+
+@end
+
+#endif
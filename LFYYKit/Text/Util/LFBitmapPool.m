@@ -0,0 +1,269 @@
+//
+//  LFBitmapPool.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFBitmapPool.h"
+#import <pthread.h>
+
+#define BUFFER_ALIGNMENT (16 * 1024) // Buffer capacities are rounded to the page size (16KB on arm64).
+#define ROW_ALIGNMENT 64             // Bytes per row are aligned to the cache line size.
+#define MAX_WASTE_RATIO 0.25         // A pooled buffer is reused for a bitmap at most 25% smaller.
+
+typedef struct _LFBitmapBuffer {
+    void *data;
+    size_t capacity;
+    void *pool; ///< retained LFBitmapPool
+    struct _LFBitmapBuffer *next; ///< next pooled buffer
+} LFBitmapBuffer;
+
+static CGColorSpaceRef LFBitmapPoolGetColorSpace() {
+    static CGColorSpaceRef space;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        space = CGColorSpaceCreateDeviceRGB();
+    });
+    return space;
+}
+
+static inline size_t LFBitmapAlign(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+@interface LFBitmapBackingStore ()
+- (instancetype)_initWithPool:(LFBitmapPool *)pool size:(CGSize)size opaque:(BOOL)opaque scale:(CGFloat)scale;
+@end
+
+@interface LFBitmapPool ()
+- (LFBitmapBuffer *)_bufferWithCapacity:(size_t)capacity cleared:(size_t)clearedBytes;
+- (void)_recycleBuffer:(LFBitmapBuffer *)buffer;
+@end
+
+/// CGDataProvider callback, the image wrapping the buffer is released.
+static void LFBitmapBufferReleaseData(void *info, const void *data, size_t size) {
+    LFBitmapBuffer *buffer = info;
+    LFBitmapPool *pool = (__bridge LFBitmapPool *)buffer->pool;
+    [pool _recycleBuffer:buffer];
+}
+
+
+@implementation LFBitmapBackingStore {
+    LFBitmapBuffer *_buffer; ///< NULL after newImage
+    size_t _width;
+    size_t _height;
+    size_t _bytesPerRow;
+    CGBitmapInfo _bitmapInfo;
+}
+
+- (instancetype)_initWithPool:(LFBitmapPool *)pool size:(CGSize)size opaque:(BOOL)opaque scale:(CGFloat)scale {
+    self = [super init];
+    _width = ceil(size.width * scale);
+    _height = ceil(size.height * scale);
+    if (_width < 1 || _height < 1) return nil;
+    _size = size;
+    _scale = scale;
+    _bytesPerRow = LFBitmapAlign(_width * 4, ROW_ALIGNMENT);
+    _byteCount = _bytesPerRow * _height;
+    _bitmapInfo = kCGBitmapByteOrder32Host | (opaque ? kCGImageAlphaNoneSkipFirst : kCGImageAlphaPremultipliedFirst);
+
+    _buffer = [pool _bufferWithCapacity:LFBitmapAlign(_byteCount, BUFFER_ALIGNMENT) cleared:_byteCount];
+    if (!_buffer) return nil;
+    _context = CGBitmapContextCreate(_buffer->data, _width, _height, 8, _bytesPerRow, LFBitmapPoolGetColorSpace(), _bitmapInfo);
+    if (!_context) return nil; // dealloc recycles the buffer
+    CGContextTranslateCTM(_context, 0, _height);
+    CGContextScaleCTM(_context, scale, -scale);
+    return self;
+}
+
+- (void)dealloc {
+    if (_context) CGContextRelease(_context);
+    if (_buffer) {
+        LFBitmapPool *pool = (__bridge LFBitmapPool *)_buffer->pool;
+        [pool _recycleBuffer:_buffer];
+    }
+}
+
+- (CGImageRef)newImage {
+    if (!_buffer || !_context) return NULL;
+    CGContextFlush(_context);
+    CGContextRelease(_context);
+    _context = NULL;
+
+    LFBitmapBuffer *buffer = _buffer;
+    _buffer = NULL;
+    CGDataProviderRef provider = CGDataProviderCreateWithData(buffer, buffer->data, _byteCount, LFBitmapBufferReleaseData);
+    if (!provider) {
+        LFBitmapBufferReleaseData(buffer, buffer->data, _byteCount);
+        return NULL;
+    }
+    CGImageRef image = CGImageCreate(_width, _height, 8, 32, _bytesPerRow, LFBitmapPoolGetColorSpace(), _bitmapInfo, provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider); // the image retains it, or it recycles the buffer
+    return image;
+}
+
+@end
+
+
+@implementation LFBitmapPool {
+    pthread_mutex_t _lock;
+    LFBitmapBuffer *_buffers; ///< pooled buffers, most recently recycled first
+    NSUInteger _maxPooledBytes;
+    NSUInteger _pooledBytes;
+    NSUInteger _pooledBufferCount;
+    uint64_t _hitCount;
+    uint64_t _missCount;
+}
+
++ (instancetype)sharedPool {
+    static LFBitmapPool *pool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pool = [LFBitmapPool new];
+    });
+    return pool;
+}
+
+- (instancetype)init {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _maxPooledBytes = 16 * 1024 * 1024;
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(removeAllBuffers) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(removeAllBuffers) name:UIApplicationDidEnterBackgroundNotification object:nil];
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidEnterBackgroundNotification object:nil];
+    pthread_mutex_destroy(&_lock); // every buffer retains the pool, so none is left here
+}
+
+- (LFBitmapBackingStore *)backingStoreWithSize:(CGSize)size opaque:(BOOL)opaque scale:(CGFloat)scale {
+    if (scale <= 0) scale = [UIScreen mainScreen].scale;
+    return [[LFBitmapBackingStore alloc] _initWithPool:self size:size opaque:opaque scale:scale];
+}
+
+/// Returns a pooled buffer of about the capacity with the first `clearedBytes` zeroed, or a new one.
+- (LFBitmapBuffer *)_bufferWithCapacity:(size_t)capacity cleared:(size_t)clearedBytes {
+    LFBitmapBuffer *buffer = NULL;
+    size_t maxCapacity = capacity + capacity * MAX_WASTE_RATIO;
+    pthread_mutex_lock(&_lock);
+    LFBitmapBuffer **link = &_buffers;
+    LFBitmapBuffer **bestLink = NULL;
+    for (; *link; link = &(*link)->next) {
+        size_t c = (*link)->capacity;
+        if (c < capacity || c > maxCapacity) continue;
+        if (!bestLink || c < (*bestLink)->capacity) bestLink = link;
+        if (c == capacity) break;
+    }
+    if (bestLink) {
+        buffer = *bestLink;
+        *bestLink = buffer->next;
+        _pooledBytes -= buffer->capacity;
+        _pooledBufferCount--;
+        _hitCount++;
+    } else {
+        _missCount++;
+    }
+    pthread_mutex_unlock(&_lock);
+
+    if (buffer) {
+        buffer->next = NULL;
+        memset(buffer->data, 0, clearedBytes);
+        return buffer;
+    }
+
+    buffer = calloc(1, sizeof(LFBitmapBuffer));
+    if (!buffer) return NULL;
+    buffer->data = calloc(1, capacity); // large callocs map zeroed pages lazily
+    if (!buffer->data) {
+        free(buffer);
+        return NULL;
+    }
+    buffer->capacity = capacity;
+    buffer->pool = (__bridge_retained void *)self;
+    return buffer;
+}
+
+- (void)_recycleBuffer:(LFBitmapBuffer *)buffer {
+    pthread_mutex_lock(&_lock);
+    BOOL pooled = _pooledBytes + buffer->capacity <= _maxPooledBytes;
+    if (pooled) {
+        buffer->next = _buffers;
+        _buffers = buffer;
+        _pooledBytes += buffer->capacity;
+        _pooledBufferCount++;
+    }
+    pthread_mutex_unlock(&_lock);
+    if (!pooled) {
+        void *pool = buffer->pool;
+        free(buffer->data);
+        free(buffer);
+        CFRelease(pool);
+    }
+}
+
+- (void)removeAllBuffers {
+    pthread_mutex_lock(&_lock);
+    LFBitmapBuffer *buffer = _buffers;
+    _buffers = NULL;
+    _pooledBytes = 0;
+    _pooledBufferCount = 0;
+    pthread_mutex_unlock(&_lock);
+    while (buffer) {
+        LFBitmapBuffer *next = buffer->next;
+        free(buffer->data);
+        free(buffer);
+        buffer = next;
+        CFRelease((__bridge CFTypeRef)self); // the reference held by the buffer
+    }
+}
+
+- (NSUInteger)pooledBytes {
+    pthread_mutex_lock(&_lock);
+    NSUInteger bytes = _pooledBytes;
+    pthread_mutex_unlock(&_lock);
+    return bytes;
+}
+
+- (NSUInteger)pooledBufferCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _pooledBufferCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (uint64_t)hitCount {
+    pthread_mutex_lock(&_lock);
+    uint64_t count = _hitCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (uint64_t)missCount {
+    pthread_mutex_lock(&_lock);
+    uint64_t count = _missCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (void)setMaxPooledBytes:(NSUInteger)maxPooledBytes {
+    pthread_mutex_lock(&_lock);
+    _maxPooledBytes = maxPooledBytes;
+    pthread_mutex_unlock(&_lock);
+    if (self.pooledBytes > maxPooledBytes) [self removeAllBuffers];
+}
+
+- (NSUInteger)maxPooledBytes {
+    pthread_mutex_lock(&_lock);
+    NSUInteger bytes = _maxPooledBytes;
+    pthread_mutex_unlock(&_lock);
+    return bytes;
+}
+
+@end
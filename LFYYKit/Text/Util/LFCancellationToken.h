@@ -0,0 +1,61 @@
+//
+//  LFCancellationToken.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifndef LFCancellationToken_h
+#define LFCancellationToken_h
+
+/**
+ A cancellation token tells the work started on behalf of something (such as the
+ render of a layer) that its result is no longer needed.
+ 
+ @discussion Checking `isCancelled` is an atomic load, so the long work can poll it
+ often (such as once per line). A token may have child tokens, cancelling a token
+ cancels all its children (but not its parent), so the work of a view can be split
+ into smaller parts which are cancelled together. The cancellation handlers run once,
+ on the thread which cancels the token.
+ 
+ It's thread-safe.
+ */
+@interface LFCancellationToken : NSObject
+
+/// Creates a token, it's not cancelled.
+- (instancetype)init;
+
+/**
+ Creates a child token of a parent token.
+ @param parent The parent token, the child is cancelled when it's cancelled. 
+               If it's already cancelled, the child is cancelled too.
+ */
+- (instancetype)initWithParent:(LFCancellationToken *)parent;
+
+/// Creates a child token of the receiver.
+- (LFCancellationToken *)newChildToken;
+
+/// Whether the token is cancelled.
+@property (readonly, getter=isCancelled) BOOL cancelled;
+
+/// Cancels the token and its children, and calls the handlers. It does nothing if the token is already cancelled.
+- (void)cancel;
+
+/**
+ Adds a block to call when the token is cancelled.
+ @discussion If the token is already cancelled, the block is called right away.
+ The blocks are released after they are called.
+ */
+- (void)addCancellationHandler:(dispatch_block_t)handler;
+
+/// Returns a block which returns whether the token is cancelled, for the `cancel:` checker parameters.
+- (BOOL (^)(void))cancelChecker;
+
+@end
+
+#endif
@@ -0,0 +1,102 @@
+//
+//  LFCancellationToken.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFCancellationToken.h"
+#import <pthread.h>
+
+@implementation LFCancellationToken {
+    int32_t _cancelled;
+    pthread_mutex_t _lock;
+    LFCancellationToken *_parent; ///< guarded by the lock, released when cancelled
+    NSHashTable *_children; ///< weak, guarded by the lock, created lazily
+    NSMutableArray *_handlers; ///< guarded by the lock, created lazily
+}
+
+- (instancetype)init {
+    return [self initWithParent:nil];
+}
+
+- (instancetype)initWithParent:(LFCancellationToken *)parent {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    if (parent && ![parent _addChild:self]) _cancelled = 1;
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+- (LFCancellationToken *)newChildToken {
+    return [[LFCancellationToken alloc] initWithParent:self];
+}
+
+/// Returns NO if the receiver is cancelled.
+- (BOOL)_addChild:(LFCancellationToken *)child {
+    pthread_mutex_lock(&_lock);
+    BOOL added = !self.isCancelled;
+    if (added) {
+        if (!_children) _children = [NSHashTable weakObjectsHashTable];
+        [_children addObject:child];
+        child->_parent = self;
+    }
+    pthread_mutex_unlock(&_lock);
+    return added;
+}
+
+- (void)_removeChild:(LFCancellationToken *)child {
+    pthread_mutex_lock(&_lock);
+    [_children removeObject:child];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (BOOL)isCancelled {
+    return __atomic_load_n(&_cancelled, __ATOMIC_ACQUIRE) != 0;
+}
+
+- (void)cancel {
+    if (__atomic_exchange_n(&_cancelled, 1, __ATOMIC_ACQ_REL)) return;
+    pthread_mutex_lock(&_lock);
+    LFCancellationToken *parent = _parent;
+    NSArray *children = _children.allObjects;
+    NSArray *handlers = _handlers;
+    _parent = nil;
+    _children = nil;
+    _handlers = nil;
+    pthread_mutex_unlock(&_lock);
+    
+    [parent _removeChild:self];
+    for (LFCancellationToken *child in children) {
+        [child cancel];
+    }
+    for (dispatch_block_t handler in handlers) {
+        handler();
+    }
+}
+
+- (void)addCancellationHandler:(dispatch_block_t)handler {
+    if (!handler) return;
+    pthread_mutex_lock(&_lock);
+    BOOL cancelled = self.isCancelled;
+    if (!cancelled) {
+        if (!_handlers) _handlers = [NSMutableArray new];
+        [_handlers addObject:[handler copy]];
+    }
+    pthread_mutex_unlock(&_lock);
+    if (cancelled) handler();
+}
+
+- (BOOL (^)(void))cancelChecker {
+    return ^BOOL() {
+        return self.isCancelled;
+    };
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+//  LFDeferredReleaseQueue.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+#ifndef LFDeferredReleaseQueue_h
+#define LFDeferredReleaseQueue_h
+
+/**
+ A deferred release queue keeps the objects which are expensive to deallocate (such
+ as text layouts and bitmaps), and releases them in batches off the main thread.
+ 
+ @discussion Adding an object pushes it on a lock-free list, and the first object of
+ a batch schedules one drain block, `batchInterval` later, on a background queue. A drain
+ releases at most `maxBatchCount` objects, and schedules the next drain for the rest, so
+ the releases are spread at a bounded rate instead of one dispatched block per object.
+ 
+ The objects which must be released on the main thread (such as the ones which may
+ hold views or layers) are batched the same way on the main queue.
+ 
+ It's thread-safe.
+ */
+@interface LFDeferredReleaseQueue : NSObject
+
+/// The shared queue.
++ (instancetype)sharedQueue;
+
+/// Releases an object later on a background queue.
+- (void)releaseObject:(id)object;
+
+/**
+ Releases an object later on a background queue.
+ @param cost The bytes the object frees, counted in `releasedBytes`.
+ */
+- (void)releaseObject:(id)object cost:(NSUInteger)cost;
+
+/// Releases an image (such as a layer's contents) later on a background queue, its bitmap size is counted in `releasedBytes`.
+- (void)releaseImage:(CGImageRef)image;
+
+/// Releases an object later on the main thread.
+- (void)releaseObjectOnMainThread:(id)object;
+
+/// The delay before a batch is released. Default is 0.05 second.
+@property NSTimeInterval batchInterval;
+
+/// The maximum number of objects released by a drain. Default is 256.
+@property NSUInteger maxBatchCount;
+
+/// The number of objects waiting to be released.
+@property (readonly) NSUInteger pendingObjectCount;
+
+/// The number of objects released.
+@property (readonly) uint64_t releasedObjectCount;
+
+/// The bytes of the objects released (as given by their cost).
+@property (readonly) uint64_t releasedBytes;
+
+/// The number of drains run.
+@property (readonly) uint64_t batchCount;
+
+@end
+
+#endif
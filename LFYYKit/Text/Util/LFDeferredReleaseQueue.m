@@ -0,0 +1,157 @@
+//
+//  LFDeferredReleaseQueue.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFDeferredReleaseQueue.h"
+
+#if __has_include("LFDispatchQueuePool.h")
+#import "LFDispatchQueuePool.h"
+#endif
+
+static dispatch_queue_t LFDeferredReleaseQueueGetBackgroundQueue() {
+#ifdef LFDispatchQueuePool_h
+    return LFDispatchQueueGetForQOS(NSQualityOfServiceBackground);
+#else
+    return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+#endif
+}
+
+typedef struct _LFReleaseNode {
+    struct _LFReleaseNode *next;
+    CFTypeRef object; ///< retained
+    NSUInteger cost;
+} LFReleaseNode;
+
+/// A lock-free list of the objects to release, and the objects taken from it by the drain in progress.
+typedef struct {
+    LFReleaseNode *head; ///< pushed by any thread, taken as a whole by the drain
+    LFReleaseNode *taken; ///< owned by the drain (while `scheduled` is set)
+    int32_t scheduled; ///< a drain is scheduled or running
+    dispatch_queue_t queue;
+} LFReleaseList;
+
+
+@implementation LFDeferredReleaseQueue {
+    LFReleaseList _background;
+    LFReleaseList _main;
+    NSUInteger _pendingObjectCount;
+    uint64_t _releasedObjectCount;
+    uint64_t _releasedBytes;
+    uint64_t _batchCount;
+}
+
+@synthesize batchInterval = _batchInterval;
+@synthesize maxBatchCount = _maxBatchCount;
+
++ (instancetype)sharedQueue {
+    static LFDeferredReleaseQueue *queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = [LFDeferredReleaseQueue new];
+    });
+    return queue;
+}
+
+- (instancetype)init {
+    self = [super init];
+    _batchInterval = 0.05;
+    _maxBatchCount = 256;
+    _background.queue = LFDeferredReleaseQueueGetBackgroundQueue();
+    _main.queue = dispatch_get_main_queue();
+    return self;
+}
+
+- (void)releaseObject:(id)object {
+    [self releaseObject:object cost:0];
+}
+
+- (void)releaseObject:(id)object cost:(NSUInteger)cost {
+    if (!object) return;
+    [self _push:(__bridge_retained CFTypeRef)object cost:cost list:&_background];
+}
+
+- (void)releaseImage:(CGImageRef)image {
+    if (!image) return;
+    NSUInteger cost = 0;
+    if (CFGetTypeID(image) == CGImageGetTypeID()) cost = CGImageGetBytesPerRow(image) * CGImageGetHeight(image);
+    CFRetain(image);
+    [self _push:image cost:cost list:&_background];
+}
+
+- (void)releaseObjectOnMainThread:(id)object {
+    if (!object) return;
+    [self _push:(__bridge_retained CFTypeRef)object cost:0 list:&_main];
+}
+
+- (void)_push:(CFTypeRef)object cost:(NSUInteger)cost list:(LFReleaseList *)list {
+    LFReleaseNode *node = malloc(sizeof(LFReleaseNode));
+    if (!node) {
+        CFRelease(object);
+        return;
+    }
+    node->object = object;
+    node->cost = cost;
+    node->next = __atomic_load_n(&list->head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&list->head, &node->next, node, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&_pendingObjectCount, 1, __ATOMIC_RELAXED);
+    [self _scheduleDrain:list];
+}
+
+/// Schedules a drain if none is scheduled.
+- (void)_scheduleDrain:(LFReleaseList *)list {
+    int32_t expected = 0;
+    if (!__atomic_compare_exchange_n(&list->scheduled, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+    NSTimeInterval interval = self.batchInterval;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), list->queue, ^{
+        [self _drain:list];
+    });
+}
+
+- (void)_drain:(LFReleaseList *)list {
+    // Only one drain of a list runs at a time, so it owns `taken`.
+    if (!list->taken) list->taken = __atomic_exchange_n(&list->head, NULL, __ATOMIC_ACQUIRE);
+    NSUInteger limit = self.maxBatchCount;
+    if (limit == 0) limit = NSUIntegerMax;
+    NSUInteger count = 0, bytes = 0;
+    while (list->taken && count < limit) {
+        LFReleaseNode *node = list->taken;
+        list->taken = node->next;
+        CFRelease(node->object);
+        bytes += node->cost;
+        free(node);
+        count++;
+    }
+    __atomic_fetch_sub(&_pendingObjectCount, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_releasedObjectCount, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_releasedBytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_batchCount, 1, __ATOMIC_RELAXED);
+    
+    BOOL remaining = list->taken != NULL;
+    __atomic_store_n(&list->scheduled, 0, __ATOMIC_RELEASE);
+    // The objects pushed while draining may have seen the drain still scheduled.
+    if (remaining || __atomic_load_n(&list->head, __ATOMIC_ACQUIRE)) [self _scheduleDrain:list];
+}
+
+- (NSUInteger)pendingObjectCount {
+    return __atomic_load_n(&_pendingObjectCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)releasedObjectCount {
+    return __atomic_load_n(&_releasedObjectCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)releasedBytes {
+    return __atomic_load_n(&_releasedBytes, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)batchCount {
+    return __atomic_load_n(&_batchCount, __ATOMIC_RELAXED);
+}
+
+@end
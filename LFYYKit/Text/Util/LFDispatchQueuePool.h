@@ -13,6 +13,50 @@
 #ifndef LFDispatchQueuePool_h
 #define LFDispatchQueuePool_h
 
+/// The last sizing decision of an elastic pool.
+typedef NS_ENUM(NSUInteger, LFDispatchQueuePoolSizingDecision) {
+    LFDispatchQueuePoolSizingDecisionNone = 0, ///< no change yet
+    LFDispatchQueuePoolSizingDecisionGrow,     ///< a queue was added, the tasks were waiting
+    LFDispatchQueuePoolSizingDecisionShrink,   ///< a queue was removed, the queues were idle
+    LFDispatchQueuePoolSizingDecisionThrottle, ///< shrunk to the minimum, the device is hot
+};
+
+/**
+ Sizing statistics of a dispatch queue pool, see `-[LFDispatchQueuePool statistics]`.
+ */
+@interface LFDispatchQueuePoolStatistics : NSObject {
+    @package
+    NSUInteger _activeQueueCount;
+    NSUInteger _minQueueCount;
+    NSUInteger _maxQueueCount;
+    NSUInteger _inFlightTaskCount;
+    NSTimeInterval _averageWaitTime;
+    double _averageQueueDepth;
+    NSUInteger _growCount;
+    NSUInteger _shrinkCount;
+    BOOL _thermalThrottled;
+    LFDispatchQueuePoolSizingDecision _lastDecision;
+}
+/// The number of queues which receive new tasks.
+@property (nonatomic, readonly) NSUInteger activeQueueCount;
+/// The bounds of `activeQueueCount`, both equal it if the pool is not elastic.
+@property (nonatomic, readonly) NSUInteger minQueueCount;
+@property (nonatomic, readonly) NSUInteger maxQueueCount;
+/// The number of tasks submitted by `async:` which are not finished yet.
+@property (nonatomic, readonly) NSUInteger inFlightTaskCount;
+/// The average time the tasks waited in the queues, measured for the last decision.
+@property (nonatomic, readonly) NSTimeInterval averageWaitTime;
+/// The average number of in-flight tasks per active queue, measured for the last decision.
+@property (nonatomic, readonly) double averageQueueDepth;
+/// The number of queues added and removed since the pool became elastic.
+@property (nonatomic, readonly) NSUInteger growCount;
+@property (nonatomic, readonly) NSUInteger shrinkCount;
+/// Whether the pool is limited to `minQueueCount` by the thermal state (iOS 11+).
+@property (nonatomic, readonly, getter=isThermalThrottled) BOOL thermalThrottled;
+/// The last sizing decision.
+@property (nonatomic, readonly) LFDispatchQueuePoolSizingDecision lastDecision;
+@end
+
 /**
  A dispatch queue pool holds multiple serial queues.
  Use this class to control queue's thread count (instead of concurrent queue).
@@ -30,12 +74,85 @@
  */
 - (instancetype)initWithName:(NSString *)name queueCount:(NSUInteger)queueCount qos:(NSQualityOfService)qos;
 
+/**
+ Creates and returns a dispatch queue pool.
+ @param name         The name of the pool.
+ @param queueCount   Maxmium queue count, should in range (1, 32).
+ @param qos          Queue quality of service (QOS).
+ @param workStealing If YES, the tasks submitted by `async:` run on a work-stealing
+                     executor with `queueCount` workers instead of the serial queues:
+                     they don't keep the submission order, but a task never waits
+                     behind a long one while a worker is idle. `queue` still returns
+                     serial queues for the callers which need the ordering.
+ @return A new pool, or nil if an error occurs.
+ */
+- (instancetype)initWithName:(NSString *)name queueCount:(NSUInteger)queueCount qos:(NSQualityOfService)qos workStealing:(BOOL)workStealing;
+
 /// Pool's name.
 @property (nonatomic, readonly) NSString *name;
 
-/// Get a serial queue from pool.
+/// Pool's quality of service.
+@property (nonatomic, readonly) NSQualityOfService qos;
+
+/// Whether the `async:` tasks run on a work-stealing executor.
+@property (nonatomic, readonly, getter=isWorkStealing) BOOL workStealing;
+
+/**
+ Get a serial queue from pool.
+ 
+ @discussion Returns the queue with the fewest in-flight tasks submitted by `async:`,
+ the ties are broken round-robin. The tasks dispatched by the caller to the returned
+ queue are not tracked, use `async:` when the tasks don't need a specific queue.
+ */
 - (dispatch_queue_t)queue;
 
+/**
+ Submits a block to the queue with the fewest in-flight tasks.
+ 
+ @discussion The pool counts the tasks submitted with this method until they finish,
+ so a slow task only delays the tasks which were already queued behind it, and new
+ tasks go to the idle queues.
+ */
+- (void)async:(dispatch_block_t)block;
+
+/// The number of tasks submitted by `async:` which are not finished yet.
+@property (nonatomic, readonly) NSUInteger inFlightTaskCount;
+
+/// Submits a block associated with a dispatch group, like `dispatch_group_async`.
+- (void)async:(dispatch_block_t)block group:(dispatch_group_t)group;
+
+/**
+ Makes the pool elastic: the number of queues which receive new tasks grows and
+ shrinks between the bounds, from the observed load.
+ 
+ @discussion About every 100ms (when an `async:` task finishes), the pool adds a
+ queue if the tasks waited in busy queues, removes one if the queues were mostly idle,
+ and falls back to the minimum while the thermal state is serious or critical (iOS 11+).
+ Only the tasks submitted by `async:` are measured. The queues of a work-stealing pool
+ are still resized, but its `async:` tasks don't use them.
+ 
+ It can be called on a default pool, which makes the global pool of that qos elastic.
+ 
+ @param minQueueCount The minimum active queue count, at least 1.
+ @param maxQueueCount The maximum active queue count, at most 32.
+ */
+- (void)setElasticWithMinQueueCount:(NSUInteger)minQueueCount maxQueueCount:(NSUInteger)maxQueueCount;
+
+/// Whether the pool is elastic.
+@property (nonatomic, readonly, getter=isElastic) BOOL elastic;
+
+/// The number of queues which receive new tasks.
+@property (nonatomic, readonly) NSUInteger activeQueueCount;
+
+/// Returns the current sizing statistics.
+- (LFDispatchQueuePoolStatistics *)statistics;
+
+/**
+ Runs the block for each index in [0, iterations) in parallel, and returns when all
+ of them are finished, like `dispatch_apply`.
+ */
+- (void)apply:(size_t)iterations block:(void (^)(size_t index))block;
+
 + (instancetype)defaultPoolForQOS:(NSQualityOfService)qos;
 
 @end
@@ -43,4 +160,15 @@
 /// Get a serial queue from global queue pool with a specified qos.
 extern dispatch_queue_t LFDispatchQueueGetForQOS(NSQualityOfService qos);
 
+/// Submits a block to the least loaded serial queue of the global queue pool with a specified qos.
+extern void LFDispatchAsyncForQOS(NSQualityOfService qos, dispatch_block_t block);
+
+/// Submits an independent block (such as a layout or an image decode) to the global
+/// work-stealing executor with a specified qos. The blocks don't keep the submission order.
+extern void LFDispatchParallelAsyncForQOS(NSQualityOfService qos, dispatch_block_t block);
+
+/// Runs the block for each index in [0, iterations) on the global work-stealing executor
+/// with a specified qos, and returns when all of them are finished.
+extern void LFDispatchParallelApplyForQOS(NSQualityOfService qos, size_t iterations, void (^block)(size_t index));
+
 #endif
\ No newline at end of file
@@ -9,8 +9,16 @@
 //
 
 #import "LFDispatchQueuePool.h"
+#import "LFWorkStealingExecutor.h"
 #import <UIKit/UIKit.h>
-#import <libkern/OSAtomic.h>
+#import <QuartzCore/QuartzCore.h>
+#import <pthread.h>
+
+#define MAX_QUEUE_COUNT 32
+
+#define ELASTIC_INTERVAL 0.1        // Minimum time in seconds between two sizing decisions.
+#define ELASTIC_GROW_WAIT 0.004     // Average queue wait in seconds above which a queue is added.
+#define ELASTIC_SHRINK_WAIT 0.0005  // Average queue wait in seconds below which a queue is removed.
 
 static inline dispatch_queue_priority_t NSQualityOfServiceToDispatchPriority(NSQualityOfService qos) {
     switch (qos) {
@@ -36,37 +44,62 @@ static inline qos_class_t NSQualityOfServiceToQOSClass(NSQualityOfService qos) {
 
 typedef struct {
     const char *name;
-    void **queues;
+    void **queues; ///< MAX_QUEUE_COUNT slots, the first queueCount are created
     uint32_t queueCount;
-    int32_t counter;
+    uint32_t activeCount; ///< the queues which receive new tasks, equals queueCount if not elastic
+    uint32_t counter;
+    int32_t *loads; ///< in-flight task count of each queue, submitted by LFDispatchContextAsync
+    NSQualityOfService qos;
+    
+    // elastic mode, the fields below are guarded by the lock
+    pthread_mutex_t lock;
+    BOOL elastic;
+    uint32_t minCount;
+    uint32_t maxCount;
+    uint64_t waitTime; ///< total queue wait of the tasks started since the last decision, in microseconds (atomic)
+    uint32_t waitCount; ///< the number of tasks started since the last decision (atomic)
+    uint64_t lastDecisionTime; ///< in microseconds (atomic)
+    double averageWaitTime;
+    double averageDepth;
+    uint32_t growCount;
+    uint32_t shrinkCount;
+    BOOL thermalThrottled;
+    LFDispatchQueuePoolSizingDecision lastDecision;
 } LFDispatchContext;
 
+static dispatch_queue_t LFDispatchQueueCreate(const char *name, NSQualityOfService qos) {
+    if ([UIDevice currentDevice].systemVersion.floatValue >= 8.0) {
+        dispatch_qos_class_t qosClass = NSQualityOfServiceToQOSClass(qos);
+        dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qosClass, 0);
+        return dispatch_queue_create(name, attr);
+    } else {
+        long identifier = NSQualityOfServiceToDispatchPriority(qos);
+        dispatch_queue_t queue = dispatch_queue_create(name, DISPATCH_QUEUE_SERIAL);
+        dispatch_set_target_queue(queue, dispatch_get_global_queue(identifier, 0));
+        return queue;
+    }
+}
+
 static LFDispatchContext *LFDispatchContextCreate(const char *name,
                                                  uint32_t queueCount,
                                                  NSQualityOfService qos) {
     LFDispatchContext *context = calloc(1, sizeof(LFDispatchContext));
     if (!context) return NULL;
-    context->queues =  calloc(queueCount, sizeof(void *));
-    if (!context->queues) {
+    context->queues =  calloc(MAX_QUEUE_COUNT, sizeof(void *));
+    context->loads = calloc(MAX_QUEUE_COUNT, sizeof(int32_t));
+    if (!context->queues || !context->loads) {
+        free(context->queues);
+        free(context->loads);
         free(context);
         return NULL;
     }
-    if ([UIDevice currentDevice].systemVersion.floatValue >= 8.0) {
-        dispatch_qos_class_t qosClass = NSQualityOfServiceToQOSClass(qos);
-        for (NSUInteger i = 0; i < queueCount; i++) {
-            dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, qosClass, 0);
-            dispatch_queue_t queue = dispatch_queue_create(name, attr);
-            context->queues[i] = (__bridge_retained void *)(queue);
-        }
-    } else {
-        long identifier = NSQualityOfServiceToDispatchPriority(qos);
-        for (NSUInteger i = 0; i < queueCount; i++) {
-            dispatch_queue_t queue = dispatch_queue_create(name, DISPATCH_QUEUE_SERIAL);
-            dispatch_set_target_queue(queue, dispatch_get_global_queue(identifier, 0));
-            context->queues[i] = (__bridge_retained void *)(queue);
-        }
+    for (NSUInteger i = 0; i < queueCount; i++) {
+        context->queues[i] = (__bridge_retained void *)LFDispatchQueueCreate(name, qos);
     }
     context->queueCount = queueCount;
+    context->activeCount = queueCount;
+    context->qos = qos;
+    pthread_mutex_init(&context->lock, NULL);
     if (name) {
          context->name = strdup(name);
     }
@@ -86,16 +119,146 @@ static void LFDispatchContextRelease(LFDispatchContext *context) {
         free(context->queues);
         context->queues = NULL;
     }
+    if (context->loads) {
+        free(context->loads);
+        context->loads = NULL;
+    }
     if (context->name) free((void *)context->name);
+    pthread_mutex_destroy(&context->lock);
+}
+
+/// Returns the index of the queue with the fewest in-flight tasks. The scan starts
+/// from a round-robin position, so the ties (such as an idle pool) are spread evenly.
+static uint32_t LFDispatchContextGetQueueIndex(LFDispatchContext *context) {
+    uint32_t count = __atomic_load_n(&context->activeCount, __ATOMIC_ACQUIRE);
+    uint32_t start = __atomic_fetch_add(&context->counter, 1, __ATOMIC_RELAXED) % count;
+    uint32_t index = start;
+    int32_t minLoad = __atomic_load_n(&context->loads[start], __ATOMIC_RELAXED);
+    for (uint32_t i = 1; i < count && minLoad > 0; i++) {
+        uint32_t j = (start + i) % count;
+        int32_t load = __atomic_load_n(&context->loads[j], __ATOMIC_RELAXED);
+        if (load < minLoad) {
+            minLoad = load;
+            index = j;
+        }
+    }
+    return index;
 }
 
 static dispatch_queue_t LFDispatchContextGetQueue(LFDispatchContext *context) {
-    int32_t counter = OSAtomicIncrement32(&context->counter);
-    if (counter < 0) counter = -counter;
-    void *queue = context->queues[counter % context->queueCount];
+    void *queue = context->queues[LFDispatchContextGetQueueIndex(context)];
     return (__bridge dispatch_queue_t)(queue);
 }
 
+static NSUInteger LFDispatchContextGetLoad(LFDispatchContext *context) {
+    NSUInteger load = 0;
+    uint32_t count = __atomic_load_n(&context->queueCount, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        load += __atomic_load_n(&context->loads[i], __ATOMIC_RELAXED);
+    }
+    return load;
+}
+
+/// Creates the queues up to `count`, the caller holds the lock.
+static void LFDispatchContextCreateQueues(LFDispatchContext *context, uint32_t count) {
+    uint32_t queueCount = context->queueCount;
+    for (uint32_t i = queueCount; i < count; i++) {
+        context->queues[i] = (__bridge_retained void *)LFDispatchQueueCreate(context->name, context->qos);
+    }
+    if (count > queueCount) __atomic_store_n(&context->queueCount, count, __ATOMIC_RELEASE);
+}
+
+static BOOL LFDispatchContextIsThermalThrottled(void) {
+    NSProcessInfo *info = [NSProcessInfo processInfo];
+    if (![info respondsToSelector:@selector(thermalState)]) return NO;
+    return info.thermalState >= NSProcessInfoThermalStateSerious;
+}
+
+/**
+ Adjusts the active queue count of an elastic context from the queue wait and
+ depth observed since the last decision:
+ 
+ * Thermal state serious or critical: shrink to the minimum.
+ * Tasks wait in the queues and every queue is busy: add a queue.
+ * Tasks start immediately and the queues are mostly idle: remove a queue.
+ 
+ A removed queue stops receiving new tasks, and drains the tasks it already has.
+ */
+static void LFDispatchContextUpdateSize(LFDispatchContext *context, uint64_t now) {
+    if (pthread_mutex_trylock(&context->lock) != 0) return; // another thread is deciding
+    if (now - context->lastDecisionTime < ELASTIC_INTERVAL * USEC_PER_SEC || !context->elastic) {
+        pthread_mutex_unlock(&context->lock);
+        return;
+    }
+    __atomic_store_n(&context->lastDecisionTime, now, __ATOMIC_RELAXED);
+    uint64_t waitTime = __atomic_exchange_n(&context->waitTime, 0, __ATOMIC_RELAXED);
+    uint32_t waitCount = __atomic_exchange_n(&context->waitCount, 0, __ATOMIC_RELAXED);
+    uint32_t active = context->activeCount;
+    double averageWait = waitCount ? waitTime / (double)waitCount / USEC_PER_SEC : 0;
+    double averageDepth = LFDispatchContextGetLoad(context) / (double)active;
+    BOOL throttled = LFDispatchContextIsThermalThrottled();
+    uint32_t maxCount = throttled ? context->minCount : context->maxCount;
+    
+    LFDispatchQueuePoolSizingDecision decision = LFDispatchQueuePoolSizingDecisionNone;
+    if (active > maxCount) {
+        active = maxCount;
+        decision = LFDispatchQueuePoolSizingDecisionThrottle;
+    } else if (averageWait > ELASTIC_GROW_WAIT && averageDepth >= 1 && active < maxCount) {
+        LFDispatchContextCreateQueues(context, active + 1);
+        active++;
+        decision = LFDispatchQueuePoolSizingDecisionGrow;
+        context->growCount++;
+    } else if (averageWait < ELASTIC_SHRINK_WAIT && averageDepth < 0.5 && active > context->minCount) {
+        active--;
+        decision = LFDispatchQueuePoolSizingDecisionShrink;
+        context->shrinkCount++;
+    }
+    __atomic_store_n(&context->activeCount, active, __ATOMIC_RELEASE);
+    context->averageWaitTime = averageWait;
+    context->averageDepth = averageDepth;
+    context->thermalThrottled = throttled;
+    if (decision != LFDispatchQueuePoolSizingDecisionNone) context->lastDecision = decision;
+    pthread_mutex_unlock(&context->lock);
+}
+
+static void LFDispatchContextSetElastic(LFDispatchContext *context, uint32_t minCount, uint32_t maxCount) {
+    pthread_mutex_lock(&context->lock);
+    LFDispatchContextCreateQueues(context, maxCount);
+    uint32_t active = context->activeCount;
+    active = active < minCount ? minCount : active > maxCount ? maxCount : active;
+    context->minCount = minCount;
+    context->maxCount = maxCount;
+    __atomic_store_n(&context->elastic, YES, __ATOMIC_RELAXED);
+    __atomic_store_n(&context->activeCount, active, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&context->lock);
+}
+
+static void LFDispatchContextAsync(LFDispatchContext *context, dispatch_block_t block) {
+    if (!block) return;
+    uint32_t index = LFDispatchContextGetQueueIndex(context);
+    int32_t *load = &context->loads[index];
+    __atomic_fetch_add(load, 1, __ATOMIC_RELAXED);
+    if (!__atomic_load_n(&context->elastic, __ATOMIC_RELAXED)) {
+        dispatch_async((__bridge dispatch_queue_t)context->queues[index], ^{
+            block();
+            __atomic_fetch_sub(load, 1, __ATOMIC_RELAXED);
+        });
+        return;
+    }
+    double submitTime = CACurrentMediaTime();
+    dispatch_async((__bridge dispatch_queue_t)context->queues[index], ^{
+        double startTime = CACurrentMediaTime();
+        __atomic_fetch_add(&context->waitTime, (uint64_t)((startTime - submitTime) * USEC_PER_SEC), __ATOMIC_RELAXED);
+        __atomic_fetch_add(&context->waitCount, 1, __ATOMIC_RELAXED);
+        block();
+        __atomic_fetch_sub(load, 1, __ATOMIC_RELAXED);
+        uint64_t now = (uint64_t)(CACurrentMediaTime() * USEC_PER_SEC);
+        if (now - __atomic_load_n(&context->lastDecisionTime, __ATOMIC_RELAXED) >= ELASTIC_INTERVAL * USEC_PER_SEC) {
+            LFDispatchContextUpdateSize(context, now);
+        }
+    });
+}
+
 
 static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
     static LFDispatchContext *context[5] = {0};
@@ -150,46 +313,185 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
 }
 
 
+/// Returns the shared work-stealing executor with a specified qos.
+static LFWorkStealingExecutor *LFWorkStealingExecutorGetForQOS(NSQualityOfService qos) {
+    static LFWorkStealingExecutor *executors[5];
+    static dispatch_once_t onceTokens[5];
+    static const char *names[5] = {
+        "com.laifeng.kit.user-interactive.parallel",
+        "com.laifeng.kit.user-initiated.parallel",
+        "com.laifeng.kit.utility.parallel",
+        "com.laifeng.kit.background.parallel",
+        "com.laifeng.kit.default.parallel",
+    };
+    int index;
+    switch (qos) {
+        case NSQualityOfServiceUserInteractive: index = 0; break;
+        case NSQualityOfServiceUserInitiated: index = 1; break;
+        case NSQualityOfServiceUtility: index = 2; break;
+        case NSQualityOfServiceBackground: index = 3; break;
+        case NSQualityOfServiceDefault:
+        default: index = 4; qos = NSQualityOfServiceDefault; break;
+    }
+    dispatch_once(&onceTokens[index], ^{
+        int count = (int)[NSProcessInfo processInfo].activeProcessorCount;
+        count = count < 1 ? 1 : count > 16 ? 16 : count;
+        executors[index] = [[LFWorkStealingExecutor alloc] initWithName:@(names[index]) workerCount:count qos:qos];
+    });
+    return executors[index];
+}
+
+
+@implementation LFDispatchQueuePoolStatistics
+
+- (NSString *)description {
+    static NSString *decisions[] = {@"none", @"grow", @"shrink", @"throttle"};
+    return [NSString stringWithFormat:@"<%@: %p> active:%lu (%lu-%lu) in-flight:%lu wait:%.2fms depth:%.2f grow:%lu shrink:%lu throttled:%@ last decision:%@",
+            self.class, self, (unsigned long)_activeQueueCount, (unsigned long)_minQueueCount, (unsigned long)_maxQueueCount,
+            (unsigned long)_inFlightTaskCount, _averageWaitTime * 1000, _averageQueueDepth,
+            (unsigned long)_growCount, (unsigned long)_shrinkCount, _thermalThrottled ? @"YES" : @"NO", decisions[_lastDecision]];
+}
+
+@end
+
+
 @implementation LFDispatchQueuePool {
     @public
     LFDispatchContext *_context;
+    LFWorkStealingExecutor *_executor; ///< nil if not work stealing
+    int32_t _executorLoad;
 }
 
 - (void)dealloc {
+    [_executor shutdown];
     if (_context) {
         LFDispatchContextRelease(_context);
         _context = NULL;
     }
 }
 
-- (instancetype)initWithContext:(LFDispatchContext *)context {
+- (instancetype)initWithContext:(LFDispatchContext *)context qos:(NSQualityOfService)qos {
     self = [super init];
     if (!context) return nil;
     self->_context = context;
+    _qos = qos;
     _name = context->name ? [NSString stringWithUTF8String:context->name] : nil;
     return self;
 }
 
 - (instancetype)initWithName:(NSString *)name queueCount:(NSUInteger)queueCount qos:(NSQualityOfService)qos {
+    return [self initWithName:name queueCount:queueCount qos:qos workStealing:NO];
+}
+
+- (instancetype)initWithName:(NSString *)name queueCount:(NSUInteger)queueCount qos:(NSQualityOfService)qos workStealing:(BOOL)workStealing {
     if (queueCount == 0 || queueCount > 32) return nil;
     self = [super init];
     _context = LFDispatchContextCreate(name.UTF8String, (uint32_t)queueCount, qos);
     if (!_context) return nil;
+    if (workStealing) {
+        _executor = [[LFWorkStealingExecutor alloc] initWithName:name workerCount:queueCount qos:qos];
+        if (!_executor) return nil;
+    }
     _name = name;
+    _qos = qos;
     return self;
 }
 
+- (BOOL)isWorkStealing {
+    return _executor != nil;
+}
+
 - (dispatch_queue_t)queue {
     return LFDispatchContextGetQueue(_context);
 }
 
+- (void)async:(dispatch_block_t)block {
+    if (!block) return;
+    if (_executor) {
+        __atomic_fetch_add(&_executorLoad, 1, __ATOMIC_RELAXED);
+        int32_t *load = &_executorLoad;
+        LFDispatchQueuePool *pool = self;
+        [_executor async:^{
+            block();
+            __atomic_fetch_sub(load, 1, __ATOMIC_RELAXED);
+            (void)pool;
+        }];
+        return;
+    }
+    // The task retains the pool, so the context (and its load counters) outlives the in-flight tasks.
+    LFDispatchQueuePool *pool = self;
+    LFDispatchContextAsync(_context, ^{
+        block();
+        (void)pool;
+    });
+}
+
+- (NSUInteger)inFlightTaskCount {
+    return LFDispatchContextGetLoad(_context) + __atomic_load_n(&_executorLoad, __ATOMIC_RELAXED);
+}
+
+- (void)setElasticWithMinQueueCount:(NSUInteger)minQueueCount maxQueueCount:(NSUInteger)maxQueueCount {
+    if (minQueueCount == 0) minQueueCount = 1;
+    if (maxQueueCount > MAX_QUEUE_COUNT) maxQueueCount = MAX_QUEUE_COUNT;
+    if (maxQueueCount < minQueueCount) maxQueueCount = minQueueCount;
+    LFDispatchContextSetElastic(_context, (uint32_t)minQueueCount, (uint32_t)maxQueueCount);
+}
+
+- (BOOL)isElastic {
+    return __atomic_load_n(&_context->elastic, __ATOMIC_RELAXED);
+}
+
+- (NSUInteger)activeQueueCount {
+    return __atomic_load_n(&_context->activeCount, __ATOMIC_ACQUIRE);
+}
+
+- (LFDispatchQueuePoolStatistics *)statistics {
+    LFDispatchQueuePoolStatistics *statistics = [LFDispatchQueuePoolStatistics new];
+    pthread_mutex_lock(&_context->lock);
+    statistics->_activeQueueCount = _context->activeCount;
+    statistics->_minQueueCount = _context->elastic ? _context->minCount : _context->activeCount;
+    statistics->_maxQueueCount = _context->elastic ? _context->maxCount : _context->activeCount;
+    statistics->_averageWaitTime = _context->averageWaitTime;
+    statistics->_averageQueueDepth = _context->averageDepth;
+    statistics->_growCount = _context->growCount;
+    statistics->_shrinkCount = _context->shrinkCount;
+    statistics->_thermalThrottled = _context->thermalThrottled;
+    statistics->_lastDecision = _context->lastDecision;
+    pthread_mutex_unlock(&_context->lock);
+    statistics->_inFlightTaskCount = self.inFlightTaskCount;
+    return statistics;
+}
+
+- (void)async:(dispatch_block_t)block group:(dispatch_group_t)group {
+    if (!block) return;
+    if (!group) {
+        [self async:block];
+        return;
+    }
+    dispatch_group_enter(group);
+    [self async:^{
+        block();
+        dispatch_group_leave(group);
+    }];
+}
+
+- (void)apply:(size_t)iterations block:(void (^)(size_t index))block {
+    if (iterations == 0 || !block) return;
+    if (_executor) {
+        [_executor apply:iterations block:block];
+    } else {
+        // Waiting on the serial queues may deadlock if the caller runs on one of them.
+        dispatch_apply(iterations, dispatch_get_global_queue(NSQualityOfServiceToDispatchPriority(_qos), 0), block);
+    }
+}
+
 + (instancetype)defaultPoolForQOS:(NSQualityOfService)qos {
     switch (qos) {
         case NSQualityOfServiceUserInteractive: {
             static LFDispatchQueuePool *pool;
             static dispatch_once_t onceToken;
             dispatch_once(&onceToken, ^{
-                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos)];
+                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos) qos:qos];
             });
             return pool;
         } break;
@@ -197,7 +499,7 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
             static LFDispatchQueuePool *pool;
             static dispatch_once_t onceToken;
             dispatch_once(&onceToken, ^{
-                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos)];
+                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos) qos:qos];
             });
             return pool;
         } break;
@@ -205,7 +507,7 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
             static LFDispatchQueuePool *pool;
             static dispatch_once_t onceToken;
             dispatch_once(&onceToken, ^{
-                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos)];
+                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos) qos:qos];
             });
             return pool;
         } break;
@@ -213,7 +515,7 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
             static LFDispatchQueuePool *pool;
             static dispatch_once_t onceToken;
             dispatch_once(&onceToken, ^{
-                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos)];
+                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(qos) qos:qos];
             });
             return pool;
         } break;
@@ -222,7 +524,7 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
             static LFDispatchQueuePool *pool;
             static dispatch_once_t onceToken;
             dispatch_once(&onceToken, ^{
-                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(NSQualityOfServiceDefault)];
+                pool = [[LFDispatchQueuePool alloc] initWithContext:LFDispatchContextGetForQOS(NSQualityOfServiceDefault) qos:NSQualityOfServiceDefault];
             });
             return pool;
         } break;
@@ -234,3 +536,15 @@ static LFDispatchContext *LFDispatchContextGetForQOS(NSQualityOfService qos) {
 dispatch_queue_t LFDispatchQueueGetForQOS(NSQualityOfService qos) {
     return LFDispatchContextGetQueue(LFDispatchContextGetForQOS(qos));
 }
+
+void LFDispatchAsyncForQOS(NSQualityOfService qos, dispatch_block_t block) {
+    LFDispatchContextAsync(LFDispatchContextGetForQOS(qos), block);
+}
+
+void LFDispatchParallelAsyncForQOS(NSQualityOfService qos, dispatch_block_t block) {
+    [LFWorkStealingExecutorGetForQOS(qos) async:block];
+}
+
+void LFDispatchParallelApplyForQOS(NSQualityOfService qos, size_t iterations, void (^block)(size_t index)) {
+    [LFWorkStealingExecutorGetForQOS(qos) apply:iterations block:block];
+}
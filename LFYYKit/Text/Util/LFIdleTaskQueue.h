@@ -0,0 +1,118 @@
+//
+//  LFIdleTaskQueue.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifndef LFIdleTaskQueue_h
+#define LFIdleTaskQueue_h
+
+/**
+ The priority of an idle task. The tasks with a higher priority run first, and the
+ ones with an equal priority run in the order they were added.
+ Any value may be used, these are the common ones.
+ */
+typedef NS_ENUM(NSInteger, LFIdleTaskPriority) {
+    LFIdleTaskPriorityLow     = -100,
+    LFIdleTaskPriorityDefault = 0,
+    LFIdleTaskPriorityHigh    = 100,
+};
+
+/**
+ A task added to an idle task queue.
+ */
+@interface LFIdleTask : NSObject
+- (instancetype)init UNAVAILABLE_ATTRIBUTE;
++ (instancetype)new UNAVAILABLE_ATTRIBUTE;
+
+/// The priority of the task.
+@property (nonatomic, readonly) LFIdleTaskPriority priority;
+
+/// Whether the task was cancelled.
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/// Whether the task ran.
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+/// Removes the task from its queue if it didn't run yet. It should be called on the main thread.
+- (void)cancel;
+
+@end
+
+/**
+ An idle task queue runs low-priority blocks on the main thread when the app is idle,
+ such as precomputing text layouts or warming caches for the content offscreen.
+ 
+ @discussion The tasks run from a display link, in priority order, and only while
+ the current frame has time left (minus `frameMargin`), so they don't delay a frame.
+ They don't run while:
+ 
+     * the main runloop is in the tracking mode (scrolling, or tracking a touch),
+       and for `idleDelay` after it left it;
+     * frames are late (the main thread is busy, such as for an animation driven on
+       the main thread), and for `idleDelay` after;
+     * the queue is suspended, such as during a view controller transition.
+ 
+ The display link is paused when the queue is empty or suspended.
+ 
+ Example:
+ 
+     [[LFIdleTaskQueue sharedQueue] addTask:^{
+         LFTextLayout *layout = [LFTextLayout layoutWithContainerSize:size text:text];
+         [layoutCache setObject:layout forKey:text];
+     }];
+ 
+ All the methods should be called on the main thread.
+ */
+@interface LFIdleTaskQueue : NSObject
+
+/// The shared queue.
++ (instancetype)sharedQueue;
+
+/**
+ Adds a task with the default priority.
+ @return The task, it can be used to cancel the block.
+ */
+- (LFIdleTask *)addTask:(dispatch_block_t)block;
+
+/**
+ Adds a task.
+ @param block    The block to run on the main thread when idle.
+ @param priority The priority of the task.
+ @return The task, it can be used to cancel the block.
+ */
+- (LFIdleTask *)addTask:(dispatch_block_t)block priority:(LFIdleTaskPriority)priority;
+
+/// Cancels all the tasks which didn't run yet.
+- (void)cancelAllTasks;
+
+/// The number of tasks waiting to run.
+@property (nonatomic, readonly) NSUInteger taskCount;
+
+/// Stops running tasks until the same number of `resume` calls.
+- (void)suspend;
+
+/// Balances a `suspend` call.
+- (void)resume;
+
+/// Whether the queue is suspended.
+@property (nonatomic, readonly, getter=isSuspended) BOOL suspended;
+
+/// The time to wait after the app became idle before running tasks. Default is 0.2 second.
+@property (nonatomic) NSTimeInterval idleDelay;
+
+/// The frame time left for the frame's own work. Default is 4 ms.
+@property (nonatomic) NSTimeInterval frameMargin;
+
+/// The number of tasks which ran.
+@property (nonatomic, readonly) uint64_t executedTaskCount;
+
+@end
+
+#endif
@@ -0,0 +1,183 @@
+//
+//  LFIdleTaskQueue.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFIdleTaskQueue.h"
+#import <UIKit/UIKit.h>
+#import <LFCategory/LFCategory.h>
+
+#define kLateFrameRatio 1.5 // A frame is late if it came this many frame durations after the previous.
+
+
+@interface LFIdleTask ()
+@property (nonatomic, copy) dispatch_block_t block;
+@property (nonatomic, readwrite) LFIdleTaskPriority priority;
+@property (nonatomic, assign) uint64_t sequence;
+@property (nonatomic, weak) LFIdleTaskQueue *queue;
+@property (nonatomic, readwrite, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, readwrite, getter=isFinished) BOOL finished;
+@end
+
+@interface LFIdleTaskQueue ()
+- (void)_removeTask:(LFIdleTask *)task;
+@end
+
+@implementation LFIdleTask
+
+- (instancetype)_init {
+    return [super init];
+}
+
+- (void)cancel {
+    if (_cancelled || _finished) return;
+    _cancelled = YES;
+    _block = nil;
+    [_queue _removeTask:self];
+}
+
+@end
+
+
+@implementation LFIdleTaskQueue {
+    NSMutableArray *_tasks; ///< ordered from the last to run to the first, so the next one is popped from the end
+    uint64_t _sequence;
+    NSUInteger _suspendCount;
+    CADisplayLink *_link;
+    CFRunLoopObserverRef _trackingObserver;
+    CFTimeInterval _lastFrameTime; ///< 0 if the link was paused
+    CFTimeInterval _lastBusyTime;
+}
+
++ (instancetype)sharedQueue {
+    static LFIdleTaskQueue *queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = [LFIdleTaskQueue new];
+    });
+    return queue;
+}
+
+- (instancetype)init {
+    self = [super init];
+    _tasks = [NSMutableArray new];
+    _idleDelay = 0.2;
+    _frameMargin = 0.004;
+    _link = [CADisplayLink displayLinkWithTarget:[LFWeakProxy proxyWithTarget:self] selector:@selector(_step:)];
+    _link.paused = YES;
+    [_link addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSDefaultRunLoopMode];
+    
+    // The tracking mode means a scroll or a touch tracking is in progress.
+    __weak typeof(self) _self = self;
+    _trackingObserver = CFRunLoopObserverCreateWithHandler(CFAllocatorGetDefault(), kCFRunLoopEntry | kCFRunLoopBeforeWaiting | kCFRunLoopAfterWaiting, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+        __strong typeof(_self) self = _self;
+        if (self) self->_lastBusyTime = CACurrentMediaTime();
+    });
+    CFRunLoopAddObserver(CFRunLoopGetMain(), _trackingObserver, (__bridge CFStringRef)UITrackingRunLoopMode);
+    return self;
+}
+
+- (void)dealloc {
+    [_link invalidate];
+    CFRunLoopRemoveObserver(CFRunLoopGetMain(), _trackingObserver, (__bridge CFStringRef)UITrackingRunLoopMode);
+    CFRelease(_trackingObserver);
+}
+
+- (LFIdleTask *)addTask:(dispatch_block_t)block {
+    return [self addTask:block priority:LFIdleTaskPriorityDefault];
+}
+
+- (LFIdleTask *)addTask:(dispatch_block_t)block priority:(LFIdleTaskPriority)priority {
+    if (!block) return nil;
+    LFIdleTask *task = [[LFIdleTask alloc] _init];
+    task.block = block;
+    task.priority = priority;
+    task.sequence = _sequence++;
+    task.queue = self;
+    
+    // Binary search the position: a lower priority goes to the front, and the
+    // later task of an equal priority goes before the earlier one.
+    NSUInteger low = 0, high = _tasks.count;
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        LFIdleTask *other = _tasks[mid];
+        if (other.priority < priority || (other.priority == priority && other.sequence > task.sequence)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    [_tasks insertObject:task atIndex:low];
+    [self _updateLink];
+    return task;
+}
+
+- (void)_removeTask:(LFIdleTask *)task {
+    [_tasks removeObjectIdenticalTo:task];
+    [self _updateLink];
+}
+
+- (void)cancelAllTasks {
+    NSArray *tasks = _tasks;
+    _tasks = [NSMutableArray new];
+    for (LFIdleTask *task in tasks) {
+        task.cancelled = YES;
+        task.block = nil;
+    }
+    [self _updateLink];
+}
+
+- (NSUInteger)taskCount {
+    return _tasks.count;
+}
+
+- (void)suspend {
+    _suspendCount++;
+    [self _updateLink];
+}
+
+- (void)resume {
+    if (_suspendCount == 0) return;
+    _suspendCount--;
+    [self _updateLink];
+}
+
+- (BOOL)isSuspended {
+    return _suspendCount > 0;
+}
+
+- (void)_updateLink {
+    BOOL paused = _tasks.count == 0 || _suspendCount > 0;
+    if (_link.paused == paused) return;
+    _link.paused = paused;
+    _lastFrameTime = 0;
+}
+
+- (void)_step:(CADisplayLink *)link {
+    CFTimeInterval now = CACurrentMediaTime();
+    CFTimeInterval frameDuration = link.duration;
+    if (_lastFrameTime > 0 && now - _lastFrameTime > frameDuration * kLateFrameRatio) {
+        _lastBusyTime = now; // a frame was missed, the main thread is busy
+    }
+    _lastFrameTime = now;
+    if (now - _lastBusyTime < _idleDelay) return;
+    
+    CFTimeInterval deadline = link.timestamp + frameDuration - _frameMargin;
+    while (_tasks.count && _suspendCount == 0 && CACurrentMediaTime() < deadline) {
+        LFIdleTask *task = _tasks.lastObject;
+        [_tasks removeLastObject];
+        dispatch_block_t block = task.block;
+        task.block = nil;
+        task.finished = YES;
+        _executedTaskCount++;
+        block();
+    }
+    [self _updateLink];
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  LFRenderCache.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <UIKit/UIKit.h>
+
+#ifndef LFRenderCache_h
+#define LFRenderCache_h
+
+@class LFMemoryCache;
+
+/**
+ A render cache shares immutable rendered images between the layers which display
+ the same content, such as the labels showing the same timestamp in a feed.
+
+ @discussion The images are keyed by a content key (describing what is drawn), the
+ size, the scale and the opaque flag, and kept in an LFMemoryCache with their byte
+ size as the cost. While a render for a key is in flight, the other displays of the
+ same key wait for its result instead of rendering it again.
+
+ LFAsyncLayer uses the shared cache for the display tasks which have a `contentKey`.
+ */
+@interface LFRenderCache : NSObject
+
+/// The shared cache.
++ (instancetype)sharedCache;
+
+/// The underlying memory cache, its cost is in bytes. The default cost limit is 16MB.
+@property (nonatomic, readonly) LFMemoryCache *memoryCache;
+
+/**
+ Returns a cache key for a content key and the bitmap parameters, or nil if the
+ content key is nil.
+ */
+- (id)keyForContentKey:(id)contentKey size:(CGSize)size scale:(CGFloat)scale opaque:(BOOL)opaque;
+
+/// Returns the cached image (a CGImageRef) for a key, or nil.
+- (id)imageForKey:(id)key;
+
+/**
+ Registers a render for a key.
+
+ @param key        A key returned by `keyForContentKey:size:scale:opaque:`.
+ @param completion Called with the image (or nil if the render failed or was cancelled)
+                   when an identical render in flight finishes, on the thread which
+                   finishes it. It's not called if this method returns YES.
+ @return YES if the caller should render, and then call `finishRenderForKey:image:cost:`;
+         NO if an identical render is in flight, and the completion will be called.
+ */
+- (BOOL)beginRenderForKey:(id)key completion:(void (^)(id image))completion;
+
+/**
+ Finishes a render registered by `beginRenderForKey:completion:`. Caches the image,
+ and calls the completions of the waiting displays. It's thread-safe.
+ @param image The rendered image (a CGImageRef), or nil if the render failed or was cancelled.
+ @param cost  The byte size of the image.
+ */
+- (void)finishRenderForKey:(id)key image:(id)image cost:(NSUInteger)cost;
+
+/// The number of displays which used a cached image.
+@property (readonly) uint64_t hitCount;
+
+/// The number of displays which found no cached image (including the merged ones).
+@property (readonly) uint64_t missCount;
+
+/// The number of displays which waited for an identical render in flight.
+@property (readonly) uint64_t mergedRenderCount;
+
+/// hitCount / (hitCount + missCount).
+@property (readonly) double hitRate;
+
+/// Resets the statistics.
+- (void)resetStatistics;
+
+@end
+
+#endif
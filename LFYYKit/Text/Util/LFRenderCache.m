@@ -0,0 +1,153 @@
+//
+//  LFRenderCache.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFRenderCache.h"
+#import "LFMemoryCache.h"
+#import <pthread.h>
+
+/// A cache key, with the hash computed once (NSArray's hash is only its count).
+@interface _LFRenderCacheKey : NSObject <NSCopying> {
+    @package
+    id _contentKey;
+    CGSize _size;
+    CGFloat _scale;
+    BOOL _opaque;
+    NSUInteger _hash;
+}
+@end
+
+@implementation _LFRenderCacheKey
+
+- (NSUInteger)hash {
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) return YES;
+    if (![object isKindOfClass:[_LFRenderCacheKey class]]) return NO;
+    _LFRenderCacheKey *other = object;
+    if (_hash != other->_hash) return NO;
+    if (!CGSizeEqualToSize(_size, other->_size)) return NO;
+    if (_scale != other->_scale || _opaque != other->_opaque) return NO;
+    return [_contentKey isEqual:other->_contentKey];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+@end
+
+
+@implementation LFRenderCache {
+    pthread_mutex_t _lock;
+    NSMutableDictionary *_renders; ///< key -> waiting completions, guarded by the lock
+    uint64_t _hitCount;
+    uint64_t _missCount;
+    uint64_t _mergedRenderCount;
+}
+
++ (instancetype)sharedCache {
+    static LFRenderCache *cache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cache = [LFRenderCache new];
+    });
+    return cache;
+}
+
+- (instancetype)init {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _renders = [NSMutableDictionary new];
+    _memoryCache = [LFMemoryCache new];
+    _memoryCache.name = @"LFRenderCache";
+    _memoryCache.costLimit = 16 * 1024 * 1024;
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+- (id)keyForContentKey:(id)contentKey size:(CGSize)size scale:(CGFloat)scale opaque:(BOOL)opaque {
+    if (!contentKey) return nil;
+    _LFRenderCacheKey *key = [_LFRenderCacheKey new];
+    key->_contentKey = contentKey;
+    key->_size = size;
+    key->_scale = scale;
+    key->_opaque = opaque;
+    NSUInteger hash = [contentKey hash];
+    hash = hash * 31 + (NSUInteger)(size.width * scale);
+    hash = hash * 31 + (NSUInteger)(size.height * scale);
+    hash = hash * 31 + (NSUInteger)(scale * 100);
+    key->_hash = hash * 2 + (opaque ? 1 : 0);
+    return key;
+}
+
+- (id)imageForKey:(id)key {
+    if (!key) return nil;
+    id image = [_memoryCache objectForKey:key];
+    if (image) __atomic_fetch_add(&_hitCount, 1, __ATOMIC_RELAXED);
+    return image;
+}
+
+- (BOOL)beginRenderForKey:(id)key completion:(void (^)(id image))completion {
+    if (!key) return YES;
+    __atomic_fetch_add(&_missCount, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&_lock);
+    NSMutableArray *waiters = _renders[key];
+    BOOL render = waiters == nil;
+    if (render) {
+        _renders[key] = [NSMutableArray new];
+    } else if (completion) {
+        [waiters addObject:[completion copy]];
+    }
+    pthread_mutex_unlock(&_lock);
+    if (!render) __atomic_fetch_add(&_mergedRenderCount, 1, __ATOMIC_RELAXED);
+    return render;
+}
+
+- (void)finishRenderForKey:(id)key image:(id)image cost:(NSUInteger)cost {
+    if (!key) return;
+    if (image) [_memoryCache setObject:image forKey:key withCost:cost];
+    pthread_mutex_lock(&_lock);
+    NSMutableArray *waiters = _renders[key];
+    [_renders removeObjectForKey:key];
+    pthread_mutex_unlock(&_lock);
+    for (void (^completion)(id image) in waiters) {
+        completion(image);
+    }
+}
+
+- (uint64_t)hitCount {
+    return __atomic_load_n(&_hitCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)missCount {
+    return __atomic_load_n(&_missCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)mergedRenderCount {
+    return __atomic_load_n(&_mergedRenderCount, __ATOMIC_RELAXED);
+}
+
+- (double)hitRate {
+    uint64_t hit = self.hitCount, miss = self.missCount;
+    return hit + miss ? (double)hit / (hit + miss) : 0;
+}
+
+- (void)resetStatistics {
+    __atomic_store_n(&_hitCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_missCount, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_mergedRenderCount, 0, __ATOMIC_RELAXED);
+}
+
+@end
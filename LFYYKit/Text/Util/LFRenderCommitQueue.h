@@ -0,0 +1,61 @@
+//
+//  LFRenderCommitQueue.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifndef LFRenderCommitQueue_h
+#define LFRenderCommitQueue_h
+
+/**
+ A render commit queue applies the results of background renders on the main thread
+ once per frame.
+
+ @discussion A commit enqueued from any thread is added to the pending batch. A display
+ link on the main run loop (in the common modes) runs the pending commits in order at
+ the start of each frame, inside a single CATransaction. So the renders which finish
+ during a frame cost one display link callback and one transaction in the next frame,
+ instead of one main queue block and one transaction each. The link is paused after a
+ frame without commits, and resumed by the next enqueue.
+
+ LFAsyncLayer commits its render results through the shared queue.
+ */
+@interface LFRenderCommitQueue : NSObject
+
+/// The shared queue.
++ (instancetype)sharedQueue;
+
+/// Enqueues a block to run on the main thread in the next frame. It's thread-safe.
+- (void)enqueueCommit:(dispatch_block_t)commit;
+
+/**
+ Runs the pending commits now, instead of in the next frame. It must be called on the
+ main thread. It's ignored when called from a commit, the commits enqueued by a running
+ batch run in the next frame. The commits it runs are counted in the next frame.
+ */
+- (void)flush;
+
+/// The number of commits run.
+@property (readonly) uint64_t commitCount;
+
+/// The number of frames which ran commits.
+@property (readonly) uint64_t frameCount;
+
+/// The average number of commits per frame which ran commits.
+@property (readonly) double averageCommitsPerFrame;
+
+/// The largest number of commits in a frame.
+@property (readonly) NSUInteger maxCommitsPerFrame;
+
+/// Resets the statistics.
+- (void)resetStatistics;
+
+@end
+
+#endif
@@ -0,0 +1,160 @@
+//
+//  LFRenderCommitQueue.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFRenderCommitQueue.h"
+#import <QuartzCore/QuartzCore.h>
+#import <LFCategory/LFCategory.h>
+#import <pthread.h>
+
+@implementation LFRenderCommitQueue {
+    pthread_mutex_t _lock;
+    NSMutableArray *_pending; ///< guarded by the lock
+    NSMutableArray *_running; ///< main thread only, reused between batches
+    BOOL _scheduled; ///< the display link runs (or is being resumed), guarded by the lock
+    BOOL _flushing; ///< a batch is running, main thread only
+    CADisplayLink *_link; ///< main thread only, created by the first resume
+    NSUInteger _frameCommitCount; ///< the commits run since the last frame, main thread only
+    uint64_t _commitCount;
+    uint64_t _frameCount;
+    NSUInteger _maxCommitsPerFrame;
+}
+
++ (instancetype)sharedQueue {
+    static LFRenderCommitQueue *queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = [LFRenderCommitQueue new];
+    });
+    return queue;
+}
+
+- (instancetype)init {
+    self = [super init];
+    pthread_mutex_init(&_lock, NULL);
+    _pending = [NSMutableArray new];
+    _running = [NSMutableArray new];
+    return self;
+}
+
+- (void)dealloc {
+    [_link invalidate];
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void)enqueueCommit:(dispatch_block_t)commit {
+    if (!commit) return;
+    commit = [commit copy];
+    pthread_mutex_lock(&_lock);
+    [_pending addObject:commit];
+    BOOL schedule = !_scheduled;
+    _scheduled = YES;
+    pthread_mutex_unlock(&_lock);
+    if (schedule) {
+        // Once per idle period: the link keeps running while commits arrive.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self _resume];
+        });
+    }
+}
+
+- (void)_resume {
+    if (!_link) {
+        _link = [CADisplayLink displayLinkWithTarget:[LFWeakProxy proxyWithTarget:self] selector:@selector(_frame:)];
+        [_link addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    _link.paused = NO;
+}
+
+- (void)_frame:(CADisplayLink *)link {
+    [self flush];
+    if (_frameCommitCount > 0) {
+        pthread_mutex_lock(&_lock);
+        _frameCount++;
+        if (_frameCommitCount > _maxCommitsPerFrame) _maxCommitsPerFrame = _frameCommitCount;
+        pthread_mutex_unlock(&_lock);
+        _frameCommitCount = 0;
+        return;
+    }
+    // A frame without commits, pause until the next enqueue.
+    pthread_mutex_lock(&_lock);
+    if (_pending.count == 0) {
+        _scheduled = NO;
+        link.paused = YES;
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)flush {
+    // A nested flush would swap the array being enumerated with the pending one, which
+    // other threads add to.
+    if (_flushing) return;
+
+    // swap the buffers, the commits enqueued while this batch runs go to the next frame
+    NSMutableArray *batch = _running;
+    pthread_mutex_lock(&_lock);
+    _running = _pending;
+    _pending = batch;
+    pthread_mutex_unlock(&_lock);
+    batch = _running;
+    NSUInteger count = batch.count;
+    if (count == 0) return;
+
+    _flushing = YES;
+    [CATransaction begin];
+    for (dispatch_block_t commit in batch) {
+        commit();
+    }
+    [CATransaction commit];
+    [batch removeAllObjects];
+    _flushing = NO;
+
+    _frameCommitCount += count;
+    pthread_mutex_lock(&_lock);
+    _commitCount += count;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (uint64_t)commitCount {
+    pthread_mutex_lock(&_lock);
+    uint64_t count = _commitCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (uint64_t)frameCount {
+    pthread_mutex_lock(&_lock);
+    uint64_t count = _frameCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (double)averageCommitsPerFrame {
+    pthread_mutex_lock(&_lock);
+    double average = _frameCount ? (double)_commitCount / _frameCount : 0;
+    pthread_mutex_unlock(&_lock);
+    return average;
+}
+
+- (NSUInteger)maxCommitsPerFrame {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _maxCommitsPerFrame;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (void)resetStatistics {
+    pthread_mutex_lock(&_lock);
+    _commitCount = 0;
+    _frameCount = 0;
+    _maxCommitsPerFrame = 0;
+    pthread_mutex_unlock(&_lock);
+}
+
+@end
@@ -0,0 +1,96 @@
+//
+//  LFRenderScheduler.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+#import <QuartzCore/QuartzCore.h>
+
+#ifndef LFRenderScheduler_h
+#define LFRenderScheduler_h
+
+/**
+ A render scheduler runs background render tasks earliest-deadline-first.
+
+ @discussion The pending tasks are kept in a deadline-ordered heap, and every slot of
+ the dispatch queue pool runs the task with the earliest deadline at the time it starts,
+ so the renders of the visible layers overtake the renders queued for the layers which
+ already scrolled away. A task whose deadline has passed before it starts is dropped if
+ it has an `expired` handler, which is called instead.
+
+ The scheduler also keeps the bytes of the running tasks (their bitmaps) within
+ `memoryBudget`: a task which doesn't fit waits until running tasks finish, so a burst
+ of large renders doesn't allocate all its bitmaps at once. A task runs anyway if
+ nothing else is running. The budget is lowered to a quarter for 10 seconds after a
+ memory warning.
+
+ LFAsyncLayer uses the shared scheduler for its async display.
+ */
+@interface LFRenderScheduler : NSObject
+- (instancetype)init UNAVAILABLE_ATTRIBUTE;
++ (instancetype)new UNAVAILABLE_ATTRIBUTE;
+
+/**
+ Creates and returns a scheduler.
+ @param qos The tasks run on the default dispatch queue pool with this qos.
+ */
+- (instancetype)initWithQOS:(NSQualityOfService)qos;
+
+/// The shared scheduler, on the user-initiated pool.
++ (instancetype)sharedScheduler;
+
+/**
+ Schedules a task.
+
+ @param task     The task to run in background.
+ @param deadline The time by which the task should start, in `CACurrentMediaTime()` base.
+ @param expired  If not nil, the task is dropped when it starts after the deadline, and
+                 this block is called instead (on a background thread). Pass nil for the
+                 tasks which must run anyway.
+ */
+- (void)scheduleTask:(dispatch_block_t)task deadline:(CFTimeInterval)deadline expired:(dispatch_block_t)expired;
+
+/**
+ Schedules a task which allocates memory while it runs.
+
+ @param cost The bytes the task allocates while it runs (such as its bitmap size),
+             counted against `memoryBudget`.
+ @see scheduleTask:deadline:expired:
+ */
+- (void)scheduleTask:(dispatch_block_t)task deadline:(CFTimeInterval)deadline cost:(uint64_t)cost expired:(dispatch_block_t)expired;
+
+/// The maximum bytes of the running tasks. Default is 1/32 of the physical memory, between 16MB and 128MB.
+@property (nonatomic) uint64_t memoryBudget;
+
+/// The bytes of the running tasks.
+@property (nonatomic, readonly) uint64_t inFlightBytes;
+
+/// The largest `inFlightBytes` observed.
+@property (nonatomic, readonly) uint64_t peakInFlightBytes;
+
+/// The number of times a task waited for budget.
+@property (nonatomic, readonly) uint64_t deferredTaskCount;
+
+/// Resets `peakInFlightBytes` to the current `inFlightBytes`.
+- (void)resetPeakInFlightBytes;
+
+/// The number of tasks waiting to start.
+@property (nonatomic, readonly) NSUInteger pendingTaskCount;
+
+/// The number of tasks which ran.
+@property (nonatomic, readonly) uint64_t executedTaskCount;
+
+/// The number of tasks which ran after their deadline (they had no `expired` handler).
+@property (nonatomic, readonly) uint64_t lateTaskCount;
+
+/// The number of tasks dropped because their deadline had passed.
+@property (nonatomic, readonly) uint64_t droppedTaskCount;
+
+@end
+
+#endif
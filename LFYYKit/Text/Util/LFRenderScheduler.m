@@ -0,0 +1,275 @@
+//
+//  LFRenderScheduler.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFRenderScheduler.h"
+#import "LFDispatchQueuePool.h"
+#import <UIKit/UIKit.h>
+#import <pthread.h>
+
+#define MIN_HEAP_CAPACITY 32
+#define MEMORY_WARNING_BUDGET_RATIO 0.25 // The budget is lowered to this ratio after a memory warning,
+#define MEMORY_WARNING_DURATION 10.0     // for this many seconds.
+
+typedef struct {
+    CFTimeInterval deadline;
+    uint64_t sequence; ///< breaks the ties in submission order
+    void *task; ///< retained block
+    void *expired; ///< retained block, or NULL if the task is never dropped
+    uint64_t cost; ///< bytes
+} LFRenderEntry;
+
+static inline BOOL LFRenderEntryBefore(LFRenderEntry *a, LFRenderEntry *b) {
+    if (a->deadline != b->deadline) return a->deadline < b->deadline;
+    return a->sequence < b->sequence;
+}
+
+/// A binary min-heap of entries ordered by deadline.
+typedef struct {
+    LFRenderEntry *entries;
+    uint32_t capacity;
+    uint32_t count;
+} LFRenderHeap;
+
+static void LFRenderHeapPush(LFRenderHeap *heap, LFRenderEntry entry) {
+    if (heap->count == heap->capacity) {
+        uint32_t capacity = heap->capacity ? heap->capacity * 2 : MIN_HEAP_CAPACITY;
+        heap->entries = realloc(heap->entries, capacity * sizeof(LFRenderEntry));
+        heap->capacity = capacity;
+    }
+    uint32_t i = heap->count++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!LFRenderEntryBefore(&entry, &heap->entries[parent])) break;
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i] = entry;
+}
+
+static BOOL LFRenderHeapPop(LFRenderHeap *heap, LFRenderEntry *entry) {
+    if (heap->count == 0) return NO;
+    *entry = heap->entries[0];
+    LFRenderEntry last = heap->entries[--heap->count];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && LFRenderEntryBefore(&heap->entries[child + 1], &heap->entries[child])) child++;
+        if (!LFRenderEntryBefore(&heap->entries[child], &last)) break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    if (heap->count) heap->entries[i] = last;
+    return YES;
+}
+
+
+@implementation LFRenderScheduler {
+    pthread_mutex_t _lock;
+    LFRenderHeap _heap;
+    uint64_t _sequence;
+    LFDispatchQueuePool *_pool;
+    uint64_t _executedTaskCount;
+    uint64_t _lateTaskCount;
+    uint64_t _droppedTaskCount;
+    
+    // memory budget, guarded by the lock
+    uint64_t _memoryBudget;
+    uint64_t _inFlightBytes;
+    uint64_t _peakInFlightBytes;
+    uint64_t _deferredTaskCount;
+    NSUInteger _waitingSlotCount; ///< slots which found no budget, reissued when a task finishes
+    NSUInteger _memoryWarningCount; ///< memory warnings in the last MEMORY_WARNING_DURATION
+}
+
+- (instancetype)initWithQOS:(NSQualityOfService)qos {
+    self = [super init];
+    _pool = [LFDispatchQueuePool defaultPoolForQOS:qos];
+    pthread_mutex_init(&_lock, NULL);
+    uint64_t budget = [NSProcessInfo processInfo].physicalMemory / 32;
+    uint64_t minBudget = 16 * 1024 * 1024, maxBudget = 128 * 1024 * 1024;
+    _memoryBudget = budget < minBudget ? minBudget : budget > maxBudget ? maxBudget : budget;
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_appDidReceiveMemoryWarningNotification) name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    return self;
+}
+
++ (instancetype)sharedScheduler {
+    static LFRenderScheduler *scheduler;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        scheduler = [[LFRenderScheduler alloc] initWithQOS:NSQualityOfServiceUserInitiated];
+    });
+    return scheduler;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    LFRenderEntry entry;
+    while (LFRenderHeapPop(&_heap, &entry)) {
+        CFRelease(entry.task);
+        if (entry.expired) CFRelease(entry.expired);
+    }
+    free(_heap.entries);
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void)scheduleTask:(dispatch_block_t)task deadline:(CFTimeInterval)deadline expired:(dispatch_block_t)expired {
+    [self scheduleTask:task deadline:deadline cost:0 expired:expired];
+}
+
+- (void)scheduleTask:(dispatch_block_t)task deadline:(CFTimeInterval)deadline cost:(uint64_t)cost expired:(dispatch_block_t)expired {
+    if (!task) return;
+    LFRenderEntry entry;
+    entry.deadline = deadline;
+    entry.cost = cost;
+    entry.task = (__bridge_retained void *)[task copy];
+    entry.expired = expired ? (__bridge_retained void *)[expired copy] : NULL;
+    pthread_mutex_lock(&_lock);
+    entry.sequence = _sequence++;
+    LFRenderHeapPush(&_heap, entry);
+    pthread_mutex_unlock(&_lock);
+
+    // One slot per task: each slot runs whichever task is the most urgent when it starts.
+    [self _issueSlot];
+}
+
+- (void)_issueSlot {
+    [_pool async:^{
+        [self _runNext];
+    }];
+}
+
+- (uint64_t)_effectiveBudget {
+    return _memoryWarningCount ? _memoryBudget * MEMORY_WARNING_BUDGET_RATIO : _memoryBudget;
+}
+
+- (void)_runNext {
+    LFRenderEntry entry;
+    pthread_mutex_lock(&_lock);
+    BOOL found = _heap.count > 0;
+    if (found) {
+        // Keep the task queued if it doesn't fit in the budget, unless nothing is
+        // in flight (so a task larger than the budget still runs, alone).
+        uint64_t cost = _heap.entries[0].cost;
+        if (_inFlightBytes > 0 && _inFlightBytes + cost > [self _effectiveBudget]) {
+            _waitingSlotCount++;
+            _deferredTaskCount++;
+            found = NO;
+        } else {
+            LFRenderHeapPop(&_heap, &entry);
+            _inFlightBytes += entry.cost;
+            if (_inFlightBytes > _peakInFlightBytes) _peakInFlightBytes = _inFlightBytes;
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+    if (!found) return;
+
+    dispatch_block_t task = (__bridge_transfer dispatch_block_t)entry.task;
+    dispatch_block_t expired = entry.expired ? (__bridge_transfer dispatch_block_t)entry.expired : nil;
+    BOOL late = CACurrentMediaTime() > entry.deadline;
+    if (late && expired) {
+        __atomic_fetch_add(&_droppedTaskCount, 1, __ATOMIC_RELAXED);
+        expired();
+    } else {
+        if (late) __atomic_fetch_add(&_lateTaskCount, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&_executedTaskCount, 1, __ATOMIC_RELAXED);
+        task();
+    }
+    pthread_mutex_lock(&_lock);
+    _inFlightBytes -= entry.cost;
+    pthread_mutex_unlock(&_lock);
+    [self _reissueWaitingSlot];
+}
+
+/// Gives a waiting slot another try, after some budget is released.
+- (void)_reissueWaitingSlot {
+    pthread_mutex_lock(&_lock);
+    BOOL reissue = _waitingSlotCount > 0;
+    if (reissue) _waitingSlotCount--;
+    pthread_mutex_unlock(&_lock);
+    if (reissue) [self _issueSlot];
+}
+
+- (void)_appDidReceiveMemoryWarningNotification {
+    pthread_mutex_lock(&_lock);
+    _memoryWarningCount++;
+    pthread_mutex_unlock(&_lock);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MEMORY_WARNING_DURATION * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        pthread_mutex_lock(&_lock);
+        _memoryWarningCount--;
+        BOOL reissue = _memoryWarningCount == 0 && _waitingSlotCount > 0;
+        pthread_mutex_unlock(&_lock);
+        if (reissue) [self _reissueWaitingSlot];
+    });
+}
+
+- (uint64_t)memoryBudget {
+    pthread_mutex_lock(&_lock);
+    uint64_t budget = _memoryBudget;
+    pthread_mutex_unlock(&_lock);
+    return budget;
+}
+
+- (void)setMemoryBudget:(uint64_t)memoryBudget {
+    pthread_mutex_lock(&_lock);
+    _memoryBudget = memoryBudget;
+    NSUInteger waiting = _waitingSlotCount;
+    _waitingSlotCount = 0;
+    pthread_mutex_unlock(&_lock);
+    for (NSUInteger i = 0; i < waiting; i++) [self _issueSlot];
+}
+
+- (uint64_t)inFlightBytes {
+    pthread_mutex_lock(&_lock);
+    uint64_t bytes = _inFlightBytes;
+    pthread_mutex_unlock(&_lock);
+    return bytes;
+}
+
+- (uint64_t)peakInFlightBytes {
+    pthread_mutex_lock(&_lock);
+    uint64_t bytes = _peakInFlightBytes;
+    pthread_mutex_unlock(&_lock);
+    return bytes;
+}
+
+- (uint64_t)deferredTaskCount {
+    pthread_mutex_lock(&_lock);
+    uint64_t count = _deferredTaskCount;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (void)resetPeakInFlightBytes {
+    pthread_mutex_lock(&_lock);
+    _peakInFlightBytes = _inFlightBytes;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)pendingTaskCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _heap.count;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (uint64_t)executedTaskCount {
+    return __atomic_load_n(&_executedTaskCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)lateTaskCount {
+    return __atomic_load_n(&_lateTaskCount, __ATOMIC_RELAXED);
+}
+
+- (uint64_t)droppedTaskCount {
+    return __atomic_load_n(&_droppedTaskCount, __ATOMIC_RELAXED);
+}
+
+@end
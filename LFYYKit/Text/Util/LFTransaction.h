@@ -11,27 +11,145 @@
 #import <Foundation/Foundation.h>
 
 /**
- LFTransaction let you perform a selector once before current runloop sleep.
+ The priority of a transaction. The transactions with a higher priority run first,
+ and the ones with an equal priority run in the order they were committed.
+ Any value may be used, these are the common ones.
+ */
+typedef NS_ENUM(NSInteger, LFTransactionPriority) {
+    LFTransactionPriorityLow     = -100,
+    LFTransactionPriorityDefault = 0,
+    LFTransactionPriorityHigh    = 100,
+};
+
+/**
+ Main runloop statistics of the transactions, see `+[LFTransaction statistics]`.
+ */
+@interface LFTransactionStatistics : NSObject {
+    @package
+    NSUInteger _pendingCount;
+    uint64_t _passCount;
+    uint64_t _executedCount;
+    uint64_t _carriedOverCount;
+    uint64_t _overBudgetPassCount;
+    uint64_t _frameRiskPassCount;
+    NSTimeInterval _averagePassDuration;
+    NSTimeInterval _maxPassDuration;
+}
+/// The number of transactions waiting to run.
+@property (nonatomic, readonly) NSUInteger pendingCount;
+/// The number of runloop passes which ran transactions.
+@property (nonatomic, readonly) uint64_t passCount;
+/// The number of transactions run.
+@property (nonatomic, readonly) uint64_t executedCount;
+/// The number of times a transaction was left to a later pass, because the budget was used up.
+@property (nonatomic, readonly) uint64_t carriedOverCount;
+/// The number of passes which took longer than the time budget.
+@property (nonatomic, readonly) uint64_t overBudgetPassCount;
+/// The number of passes which took longer than a frame (1/60 second), and may have dropped a frame.
+@property (nonatomic, readonly) uint64_t frameRiskPassCount;
+/// The average and the longest time of a pass.
+@property (nonatomic, readonly) NSTimeInterval averagePassDuration;
+@property (nonatomic, readonly) NSTimeInterval maxPassDuration;
+@end
+
+/**
+ LFTransaction let you perform a selector once before the main runloop sleeps, or in
+ the next passes if the current one is out of its time budget.
+ 
+ @discussion The transactions run in priority order, within a time budget per runloop
+ pass: the transactions which don't fit are carried over to the next passes, so a burst
+ of commits is spread over several frames instead of blocking one. At least one
+ transaction runs in each pass.
+ 
+ The pending transactions are kept in a reusable buffer, and run in a stable order
+ (by priority, then by commit order).
  */
 @interface LFTransaction : NSObject
 
 /**
  Creates and returns a transaction with a specified target and selector.
  
- @param target    A specified target, the target is retained until runloop end.
+ @param target    A specified target, the target is retained until the transaction runs,
+                  which may be a later runloop pass if it's carried over (see `timeBudget`).
  @param selector  A selector for target.
  
  @return A new transaction, or nil if an error occurs.
  */
 + (LFTransaction *)transactionWithTarget:(id)target selector:(SEL)selector;
 
+/**
+ Creates and returns a transaction with a specified target, selector and priority.
+ 
+ @param target    A specified target, the target is retained until the transaction runs.
+ @param selector  A selector for target.
+ @param priority  The priority of the transaction.
+ 
+ @return A new transaction, or nil if an error occurs.
+ */
++ (LFTransaction *)transactionWithTarget:(id)target selector:(SEL)selector priority:(LFTransactionPriority)priority;
+
+/// The priority of the transaction. Default is `LFTransactionPriorityDefault`.
+@property (nonatomic, readonly) LFTransactionPriority priority;
+
 /**
  Commit the trancaction to main runloop.
  
- @discussion It will perform the selector on the target once before main runloop's
- current loop sleep. If the same transaction (same target and same selector) has 
- already commit to runloop in this loop, this method do nothing.
+ @discussion It will perform the selector on the target once, before main runloop's
+ current loop sleep if the pass has time left in its `timeBudget`. Otherwise it's carried
+ over to the next passes (the runloop is woken up for them), the higher priorities first.
+ If the same transaction (same target and same selector) is already committed and not
+ run yet, this method do nothing, except raising the priority of the committed one if
+ this one's is higher.
+ 
+ Call `[LFTransaction setTimeBudget:0]` if the selectors must run before the current
+ loop sleeps, as before the time budget.
+ 
+ It should be called on the main thread.
  */
 - (void)commit;
 
+/**
+ Commits a selector to main runloop, without creating a transaction object.
+ 
+ @discussion It's the same as committing a transaction with the target, selector and
+ priority, but it doesn't allocate once the pending buffer is large enough, so it fits
+ the high-frequency commits (such as on every keystroke).
+ */
++ (void)commitWithTarget:(id)target selector:(SEL)selector priority:(LFTransactionPriority)priority;
+
+/**
+ Commits a block to main runloop, coalesced by an object and a key.
+ 
+ @param object   The object passed to the block, it is retained until the block runs.
+ @param key      The coalescing key, such as the address of a static variable. The commits
+                 with the same object and key before the block runs are coalesced: the first
+                 block is kept (the later ones are not copied), and the priority is raised to
+                 the highest one.
+ @param priority The priority of the block.
+ @param block    The block to perform with the object. A block which captures nothing
+                 (using only its argument) is not copied, so the commit doesn't allocate.
+ 
+ @discussion Example:
+ 
+     static const int kUpdateKey;
+     [LFTransaction commitWithObject:self key:&kUpdateKey priority:LFTransactionPriorityDefault block:^(MyView *view) {
+         [view update];
+     }];
+ */
++ (void)commitWithObject:(id)object key:(const void *)key priority:(LFTransactionPriority)priority block:(void (^)(id object))block;
+
+/**
+ The time the transactions may take in one runloop pass, the rest is carried over.
+ 0 means no limit (all the committed transactions run in one pass). 
+ Default is 1/120 second, a half frame. It should be accessed on the main thread.
+ */
++ (NSTimeInterval)timeBudget;
++ (void)setTimeBudget:(NSTimeInterval)timeBudget;
+
+/// Returns the statistics. It should be called on the main thread.
++ (LFTransactionStatistics *)statistics;
+
+/// Resets the statistics. It should be called on the main thread.
++ (void)resetStatistics;
+
 @end
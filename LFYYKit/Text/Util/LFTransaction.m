@@ -9,31 +9,178 @@
 //
 
 #import "LFTransaction.h"
+#import <QuartzCore/QuartzCore.h>
+
+#define kFrameDuration (1.0 / 60.0) // A pass longer than this may drop a frame.
 
 
 @interface LFTransaction()
 @property (nonatomic, strong) id target;
 @property (nonatomic, assign) SEL selector;
+@property (nonatomic, readwrite) LFTransactionPriority priority;
 @end
 
-static NSMutableSet *transactionSet = nil;
+/// A pending commit, identified by the object, the key and the kind.
+typedef struct {
+    void *object; ///< retained until the commit runs
+    const void *key; ///< the selector, or the key of a block commit
+    void *block; ///< retained block, or NULL for a selector commit
+    LFTransactionPriority priority;
+    uint64_t sequence; ///< commit order, breaks the priority ties
+    BOOL done; ///< ran in the current pass, removed after the pass
+} LFTransactionEntry;
+
+// all the states below are accessed on the main thread
+static LFTransactionEntry *entries = NULL; ///< pending commits, reused between passes
+static uint32_t entryCount = 0;
+static uint32_t entryCapacity = 0;
+static uint32_t *slots = NULL; ///< open addressing index of the entries (index + 1, 0 is empty)
+static uint32_t slotCapacity = 0;
+static uint32_t *order = NULL; ///< the run order of a pass
+static uint32_t orderCapacity = 0;
+static uint32_t pendingCount = 0;
+static uint64_t transactionSequence = 0;
+static BOOL running = NO;
+static NSTimeInterval transactionTimeBudget = 1.0 / 120.0;
+
+static uint64_t passCount = 0;
+static uint64_t executedCount = 0;
+static uint64_t carriedOverCount = 0;
+static uint64_t overBudgetPassCount = 0;
+static uint64_t frameRiskPassCount = 0;
+static NSTimeInterval totalPassDuration = 0;
+static NSTimeInterval maxPassDuration = 0;
+
+static inline uint32_t LFTransactionHash(const void *object, const void *key, BOOL isBlock) {
+    uintptr_t h = ((uintptr_t)object >> 4) * 31 + ((uintptr_t)key >> 2);
+    h = h * 2 + (isBlock ? 1 : 0);
+    return (uint32_t)(h ^ (h >> 16));
+}
+
+/// Returns the slot of a pending commit, or the empty slot to insert it.
+static uint32_t *LFTransactionFindSlot(const void *object, const void *key, BOOL isBlock) {
+    uint32_t mask = slotCapacity - 1;
+    uint32_t i = LFTransactionHash(object, key, isBlock) & mask;
+    for (;;) {
+        uint32_t index = slots[i];
+        if (index == 0) return &slots[i];
+        LFTransactionEntry *entry = &entries[index - 1];
+        if (entry->object == object && entry->key == key && (entry->block != NULL) == isBlock) return &slots[i];
+        i = (i + 1) & mask;
+    }
+}
+
+/// Rebuilds the index with the entries which didn't run.
+static void LFTransactionRebuildSlots(uint32_t capacity) {
+    if (capacity != slotCapacity) {
+        free(slots);
+        slots = malloc(capacity * sizeof(uint32_t));
+        slotCapacity = capacity;
+    }
+    memset(slots, 0, slotCapacity * sizeof(uint32_t));
+    for (uint32_t i = 0; i < entryCount; i++) {
+        LFTransactionEntry *entry = &entries[i];
+        if (entry->done) continue;
+        *LFTransactionFindSlot(entry->object, entry->key, entry->block != NULL) = i + 1;
+    }
+}
+
+static void LFTransactionCommit(id object, const void *key, void (^block)(id object), LFTransactionPriority priority) {
+    BOOL isBlock = block != nil;
+    if (slotCapacity == 0) LFTransactionRebuildSlots(128);
+    uint32_t *slot = LFTransactionFindSlot((__bridge void *)object, key, isBlock);
+    if (*slot && !entries[*slot - 1].done) {
+        // coalesced, keep the commit order of the pending one
+        LFTransactionEntry *entry = &entries[*slot - 1];
+        if (priority > entry->priority) entry->priority = priority;
+        return;
+    }
+    if (entryCount == entryCapacity) {
+        entryCapacity = entryCapacity ? entryCapacity * 2 : 64;
+        entries = realloc(entries, entryCapacity * sizeof(LFTransactionEntry));
+    }
+    LFTransactionEntry *entry = &entries[entryCount++];
+    entry->object = (__bridge_retained void *)object;
+    entry->key = key;
+    entry->block = isBlock ? (__bridge_retained void *)[block copy] : NULL;
+    entry->priority = priority;
+    entry->sequence = transactionSequence++;
+    entry->done = NO;
+    *slot = entryCount;
+    pendingCount++;
+    // keep the index at most half full (the entries which ran in this pass count until it ends)
+    if (entryCount * 2 > slotCapacity) LFTransactionRebuildSlots(slotCapacity * 2);
+}
+
+static int LFTransactionCompare(const void *p1, const void *p2) {
+    LFTransactionEntry *e1 = &entries[*(const uint32_t *)p1];
+    LFTransactionEntry *e2 = &entries[*(const uint32_t *)p2];
+    if (e1->priority != e2->priority) return e1->priority > e2->priority ? -1 : 1;
+    if (e1->sequence != e2->sequence) return e1->sequence < e2->sequence ? -1 : 1;
+    return 0;
+}
 
 static void LFRunLoopObserverCallBack(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info) {
-    if (transactionSet.count == 0) return;
-    NSSet *currentSet = transactionSet;
-    transactionSet = [NSMutableSet new];
-    [currentSet enumerateObjectsUsingBlock:^(LFTransaction *transaction, BOOL *stop) {
+    if (pendingCount == 0 || running) return; // not in a nested runloop of a transaction
+    running = YES;
+    
+    // All the entries are pending at the beginning of a pass, the ones committed
+    // while it runs are appended, and wait for the next pass.
+    uint32_t count = entryCount;
+    if (count > orderCapacity) {
+        orderCapacity = count;
+        order = realloc(order, orderCapacity * sizeof(uint32_t));
+    }
+    for (uint32_t i = 0; i < count; i++) order[i] = i;
+    qsort(order, count, sizeof(uint32_t), LFTransactionCompare);
+    
+    NSTimeInterval budget = transactionTimeBudget;
+    CFTimeInterval begin = CACurrentMediaTime();
+    uint32_t executed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        // always run one, so the pending transactions make progress
+        if (executed > 0 && budget > 0 && CACurrentMediaTime() - begin >= budget) break;
+        LFTransactionEntry *entry = &entries[order[i]]; // the buffer may move while running
+        entry->done = YES; // it may commit again while running
+        pendingCount--;
+        executed++;
+        id object = (__bridge_transfer id)entry->object;
+        if (entry->block) {
+            void (^block)(id object) = (__bridge_transfer id)entry->block;
+            block(object);
+        } else {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Warc-performSelector-leaks"
-        [transaction.target performSelector:transaction.selector];
+            [object performSelector:(SEL)entry->key];
 #pragma clang diagnostic pop
-    }];
+        }
+    }
+    NSTimeInterval duration = CACurrentMediaTime() - begin;
+    
+    // remove the entries which ran, keeping the order of the others
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < entryCount; i++) {
+        if (!entries[i].done) entries[j++] = entries[i];
+    }
+    entryCount = j;
+    LFTransactionRebuildSlots(slotCapacity);
+    running = NO;
+    
+    passCount++;
+    executedCount += executed;
+    carriedOverCount += count - executed;
+    if (budget > 0 && duration > budget) overBudgetPassCount++;
+    if (duration > kFrameDuration) frameRiskPassCount++;
+    totalPassDuration += duration;
+    if (duration > maxPassDuration) maxPassDuration = duration;
+    
+    // The runloop may sleep with no other event, wake it up for the next pass.
+    if (pendingCount) CFRunLoopWakeUp(CFRunLoopGetMain());
 }
 
 static void LFTransactionSetup() {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        transactionSet = [NSMutableSet new];
         CFRunLoopRef runloop = CFRunLoopGetMain();
         CFRunLoopObserverRef observer;
         
@@ -48,20 +195,79 @@ static void LFTransactionSetup() {
 }
 
 
+@implementation LFTransactionStatistics
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> pending:%lu passes:%llu executed:%llu carried over:%llu over budget:%llu frame risk:%llu pass:%.2fms (max %.2fms)",
+            self.class, self, (unsigned long)_pendingCount, _passCount, _executedCount, _carriedOverCount,
+            _overBudgetPassCount, _frameRiskPassCount, _averagePassDuration * 1000, _maxPassDuration * 1000];
+}
+
+@end
+
+
 @implementation LFTransaction
 
 + (LFTransaction *)transactionWithTarget:(id)target selector:(SEL)selector{
+    return [self transactionWithTarget:target selector:selector priority:LFTransactionPriorityDefault];
+}
+
++ (LFTransaction *)transactionWithTarget:(id)target selector:(SEL)selector priority:(LFTransactionPriority)priority {
     if (!target || !selector) return nil;
     LFTransaction *t = [LFTransaction new];
     t.target = target;
     t.selector = selector;
+    t.priority = priority;
     return t;
 }
 
 - (void)commit {
     if (!_target || !_selector) return;
     LFTransactionSetup();
-    [transactionSet addObject:self];
+    LFTransactionCommit(_target, _selector, nil, _priority);
+}
+
++ (void)commitWithTarget:(id)target selector:(SEL)selector priority:(LFTransactionPriority)priority {
+    if (!target || !selector) return;
+    LFTransactionSetup();
+    LFTransactionCommit(target, selector, nil, priority);
+}
+
++ (void)commitWithObject:(id)object key:(const void *)key priority:(LFTransactionPriority)priority block:(void (^)(id object))block {
+    if (!object || !block) return;
+    LFTransactionSetup();
+    LFTransactionCommit(object, key, block, priority);
+}
+
++ (NSTimeInterval)timeBudget {
+    return transactionTimeBudget;
+}
+
++ (void)setTimeBudget:(NSTimeInterval)timeBudget {
+    transactionTimeBudget = timeBudget < 0 ? 0 : timeBudget;
+}
+
++ (LFTransactionStatistics *)statistics {
+    LFTransactionStatistics *statistics = [LFTransactionStatistics new];
+    statistics->_pendingCount = pendingCount;
+    statistics->_passCount = passCount;
+    statistics->_executedCount = executedCount;
+    statistics->_carriedOverCount = carriedOverCount;
+    statistics->_overBudgetPassCount = overBudgetPassCount;
+    statistics->_frameRiskPassCount = frameRiskPassCount;
+    statistics->_averagePassDuration = passCount ? totalPassDuration / passCount : 0;
+    statistics->_maxPassDuration = maxPassDuration;
+    return statistics;
+}
+
++ (void)resetStatistics {
+    passCount = 0;
+    executedCount = 0;
+    carriedOverCount = 0;
+    overBudgetPassCount = 0;
+    frameRiskPassCount = 0;
+    totalPassDuration = 0;
+    maxPassDuration = 0;
 }
 
 - (NSUInteger)hash {
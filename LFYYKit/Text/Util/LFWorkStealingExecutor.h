@@ -0,0 +1,76 @@
+//
+//  LFWorkStealingExecutor.h
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifndef LFWorkStealingExecutor_h
+#define LFWorkStealingExecutor_h
+
+/**
+ A work-stealing executor runs independent tasks on a fixed set of worker threads.
+
+ @discussion Every worker owns a task deque. A task submitted from a worker is pushed
+ to that worker's deque (and runs in LIFO order, while its data is still in the cache),
+ a task submitted from other threads goes to a shared FIFO queue. An idle worker takes
+ tasks from its own deque first, then from the shared queue, and then steals the oldest
+ task of another worker, so no task stays stuck behind a long one while a worker is idle.
+
+ The tasks don't run in submission order. Use a serial queue (such as
+ `-[LFDispatchQueuePool queue]`) when the order matters.
+ */
+@interface LFWorkStealingExecutor : NSObject
+- (instancetype)init UNAVAILABLE_ATTRIBUTE;
++ (instancetype)new UNAVAILABLE_ATTRIBUTE;
+
+/**
+ Creates and returns an executor.
+ @param name        The name of the executor, used as the worker thread name.
+ @param workerCount Worker thread count, should in range (1, 32).
+ @param qos         Worker thread quality of service (QOS).
+ @return A new executor, or nil if an error occurs.
+ */
+- (instancetype)initWithName:(NSString *)name workerCount:(NSUInteger)workerCount qos:(NSQualityOfService)qos;
+
+/// Executor's name.
+@property (nonatomic, readonly) NSString *name;
+
+/// Worker thread count.
+@property (nonatomic, readonly) NSUInteger workerCount;
+
+/// The number of tasks taken from another worker's deque.
+@property (nonatomic, readonly) uint64_t stealCount;
+
+/// Submits a task, it runs with the QOS of the submitting thread (iOS 8+).
+- (void)async:(dispatch_block_t)block;
+
+/// Submits a task which runs with a specified QOS (iOS 8+).
+- (void)async:(dispatch_block_t)block qos:(NSQualityOfService)qos;
+
+/// Submits a task associated with a dispatch group, like `dispatch_group_async`.
+- (void)async:(dispatch_block_t)block group:(dispatch_group_t)group;
+
+/**
+ Runs the block for each index in [0, iterations) in parallel, and returns when all
+ of them are finished, like `dispatch_apply`.
+
+ @discussion The calling thread runs tasks while it waits, so it can be called from a
+ worker of the same executor.
+ */
+- (void)apply:(size_t)iterations block:(void (^)(size_t index))block;
+
+/**
+ Stops the worker threads once the submitted tasks are finished.
+ The executor is released when the last worker exits. Tasks submitted later are ignored.
+ */
+- (void)shutdown;
+
+@end
+
+#endif
@@ -0,0 +1,331 @@
+//
+//  LFWorkStealingExecutor.m
+
+//  Created by 汪潇翔 on 17/10/2026.
+//
+//
+//  This source code is licensed under the MIT-style license found in the
+//  LICENSE file in the root directory of this source tree.
+//
+
+#import "LFWorkStealingExecutor.h"
+#import <UIKit/UIKit.h>
+#import <pthread.h>
+
+#define MAX_WORKER_COUNT 32
+#define MIN_DEQUE_CAPACITY 16
+
+static inline qos_class_t NSQualityOfServiceToQOSClass(NSQualityOfService qos) {
+    switch (qos) {
+        case NSQualityOfServiceUserInteractive: return QOS_CLASS_USER_INTERACTIVE;
+        case NSQualityOfServiceUserInitiated: return QOS_CLASS_USER_INITIATED;
+        case NSQualityOfServiceUtility: return QOS_CLASS_UTILITY;
+        case NSQualityOfServiceBackground: return QOS_CLASS_BACKGROUND;
+        case NSQualityOfServiceDefault: return QOS_CLASS_DEFAULT;
+        default: return QOS_CLASS_UNSPECIFIED;
+    }
+}
+
+/// QOS classes are available since iOS 8.
+static BOOL LFWorkStealingSupportsQOS() {
+    static BOOL supports;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        supports = [UIDevice currentDevice].systemVersion.floatValue >= 8.0;
+    });
+    return supports;
+}
+
+#pragma mark - Deque
+
+/// A double-ended queue of retained blocks, guarded by a mutex.
+typedef struct {
+    pthread_mutex_t lock;
+    void **tasks; ///< ring buffer
+    uint32_t capacity;
+    uint32_t head; ///< index of the oldest task
+    uint32_t count;
+} LFWorkDeque;
+
+static void LFWorkDequeInit(LFWorkDeque *deque) {
+    memset(deque, 0, sizeof(LFWorkDeque));
+    pthread_mutex_init(&deque->lock, NULL);
+}
+
+static void LFWorkDequeDestroy(LFWorkDeque *deque) {
+    for (uint32_t i = 0; i < deque->count; i++) {
+        CFRelease(deque->tasks[(deque->head + i) % deque->capacity]);
+    }
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->lock);
+}
+
+static void LFWorkDequePush(LFWorkDeque *deque, void *task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        uint32_t capacity = deque->capacity ? deque->capacity * 2 : MIN_DEQUE_CAPACITY;
+        void **tasks = malloc(capacity * sizeof(void *));
+        for (uint32_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+        deque->head = 0;
+    }
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    __atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/// Takes the newest task, used by the owner.
+static void *LFWorkDequePopNewest(LFWorkDeque *deque) {
+    if (!__atomic_load_n(&deque->count, __ATOMIC_RELAXED)) return NULL;
+    void *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count) {
+        uint32_t count = deque->count - 1;
+        task = deque->tasks[(deque->head + count) % deque->capacity];
+        __atomic_store_n(&deque->count, count, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+/// Takes the oldest task, used by the thieves and for the shared FIFO queue.
+static void *LFWorkDequePopOldest(LFWorkDeque *deque) {
+    if (!__atomic_load_n(&deque->count, __ATOMIC_RELAXED)) return NULL;
+    void *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count) {
+        task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+static void LFWorkStealingRun(void *task) {
+    @autoreleasepool {
+        dispatch_block_t block = CFBridgingRelease(task);
+        block();
+    }
+}
+
+#pragma mark - Executor
+
+typedef struct {
+    LFWorkDeque deque;
+    uint32_t index;
+    void *executor; ///< LFWorkStealingExecutor, retained by the worker thread
+} LFWorker;
+
+static pthread_key_t LFWorkerKey;
+
+@interface LFWorkStealingExecutor ()
+- (void)_runWorker:(LFWorker *)worker;
+@end
+
+static void *LFWorkStealingWorkerMain(void *context) {
+    LFWorker *worker = context;
+    void *executor = worker->executor;
+    pthread_setspecific(LFWorkerKey, worker);
+    @autoreleasepool {
+        __unsafe_unretained LFWorkStealingExecutor *e = (__bridge LFWorkStealingExecutor *)executor;
+        pthread_setname_np(e.name.UTF8String ?: "com.laifeng.kit.worker");
+        [e _runWorker:worker];
+    }
+    pthread_setspecific(LFWorkerKey, NULL);
+    CFRelease(executor); // may free the worker
+    return NULL;
+}
+
+@implementation LFWorkStealingExecutor {
+    LFWorker *_workers;
+    uint32_t _workerCount;
+    LFWorkDeque _injection; ///< tasks submitted from other threads
+    dispatch_semaphore_t _wake; ///< one signal per submitted task
+    BOOL _stopped;
+    uint64_t _stealCount;
+}
+
+- (instancetype)initWithName:(NSString *)name workerCount:(NSUInteger)workerCount qos:(NSQualityOfService)qos {
+    if (workerCount == 0 || workerCount > MAX_WORKER_COUNT) return nil;
+    self = [super init];
+    if (!self) return nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&LFWorkerKey, NULL);
+    });
+    _workers = calloc(workerCount, sizeof(LFWorker));
+    if (!_workers) return nil;
+    _name = name.copy;
+    _wake = dispatch_semaphore_create(0);
+    LFWorkDequeInit(&_injection);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        LFWorkDequeInit(&_workers[i].deque);
+        _workers[i].index = i;
+    }
+    _workerCount = (uint32_t)workerCount;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (LFWorkStealingSupportsQOS()) {
+        pthread_attr_set_qos_class_np(&attr, NSQualityOfServiceToQOSClass(qos), 0);
+    }
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        _workers[i].executor = (void *)CFBridgingRetain(self);
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, LFWorkStealingWorkerMain, &_workers[i]) != 0) {
+            CFRelease(_workers[i].executor);
+            _workers[i].executor = NULL;
+            continue;
+        }
+        started++;
+    }
+    pthread_attr_destroy(&attr);
+    if (started == 0) {
+        _stopped = YES;
+        return nil;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // All workers have exited, they retain the executor while running.
+    for (uint32_t i = 0; i < _workerCount; i++) {
+        LFWorkDequeDestroy(&_workers[i].deque);
+    }
+    free(_workers);
+    LFWorkDequeDestroy(&_injection);
+}
+
+- (NSUInteger)workerCount {
+    return _workerCount;
+}
+
+- (uint64_t)stealCount {
+    return __atomic_load_n(&_stealCount, __ATOMIC_RELAXED);
+}
+
+#pragma mark - Private
+
+- (LFWorker *)_currentWorker {
+    LFWorker *worker = pthread_getspecific(LFWorkerKey);
+    if (worker && worker->executor == (__bridge void *)self) return worker;
+    return NULL;
+}
+
+- (void *)_takeTaskForWorker:(LFWorker *)worker {
+    void *task = NULL;
+    if (worker) task = LFWorkDequePopNewest(&worker->deque);
+    if (!task) task = LFWorkDequePopOldest(&_injection);
+    if (!task) {
+        uint32_t start = worker ? worker->index + 1 : arc4random_uniform(_workerCount);
+        for (uint32_t i = 0; i < _workerCount && !task; i++) {
+            LFWorker *victim = &_workers[(start + i) % _workerCount];
+            if (victim == worker) continue;
+            task = LFWorkDequePopOldest(&victim->deque);
+        }
+        if (task) __atomic_fetch_add(&_stealCount, 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+- (void)_runWorker:(LFWorker *)worker {
+    for (;;) {
+        void *task = [self _takeTaskForWorker:worker];
+        if (task) {
+            LFWorkStealingRun(task);
+            continue;
+        }
+        if (__atomic_load_n(&_stopped, __ATOMIC_ACQUIRE)) break;
+        dispatch_semaphore_wait(_wake, DISPATCH_TIME_FOREVER);
+    }
+}
+
+/// Returns NO if the executor is stopped.
+- (BOOL)_submit:(dispatch_block_t)block qos:(qos_class_t)qos {
+    if (__atomic_load_n(&_stopped, __ATOMIC_ACQUIRE)) return NO;
+    if (LFWorkStealingSupportsQOS()) {
+        // A dispatch block object applies its QOS when it's invoked directly by the worker.
+        if (qos == QOS_CLASS_UNSPECIFIED) {
+            block = dispatch_block_create(DISPATCH_BLOCK_ASSIGN_CURRENT, block);
+        } else {
+            block = dispatch_block_create_with_qos_class(DISPATCH_BLOCK_ENFORCE_QOS_CLASS, qos, 0, block);
+        }
+    } else {
+        block = [block copy];
+    }
+    void *task = (void *)CFBridgingRetain(block);
+    LFWorker *worker = [self _currentWorker];
+    LFWorkDequePush(worker ? &worker->deque : &_injection, task);
+    dispatch_semaphore_signal(_wake);
+    return YES;
+}
+
+#pragma mark - Public
+
+- (void)async:(dispatch_block_t)block {
+    if (!block) return;
+    [self _submit:block qos:QOS_CLASS_UNSPECIFIED];
+}
+
+- (void)async:(dispatch_block_t)block qos:(NSQualityOfService)qos {
+    if (!block) return;
+    [self _submit:block qos:NSQualityOfServiceToQOSClass(qos)];
+}
+
+- (void)async:(dispatch_block_t)block group:(dispatch_group_t)group {
+    if (!block) return;
+    if (!group) {
+        [self async:block];
+        return;
+    }
+    dispatch_group_enter(group);
+    BOOL submitted = [self _submit:^{
+        block();
+        dispatch_group_leave(group);
+    } qos:QOS_CLASS_UNSPECIFIED];
+    if (!submitted) dispatch_group_leave(group);
+}
+
+- (void)apply:(size_t)iterations block:(void (^)(size_t index))block {
+    if (iterations == 0 || !block) return;
+    size_t chunkSize = (iterations + _workerCount * 4 - 1) / (_workerCount * 4);
+    dispatch_group_t group = dispatch_group_create();
+    for (size_t start = 0; start < iterations; start += chunkSize) {
+        size_t end = MIN(iterations, start + chunkSize);
+        dispatch_block_t chunk = ^{
+            for (size_t i = start; i < end; i++) block(i);
+        };
+        dispatch_group_enter(group);
+        BOOL submitted = [self _submit:^{
+            chunk();
+            dispatch_group_leave(group);
+        } qos:QOS_CLASS_UNSPECIFIED];
+        if (!submitted) {
+            chunk();
+            dispatch_group_leave(group);
+        }
+    }
+    // Run tasks instead of blocking: a worker waiting here would hold up its own deque.
+    LFWorker *worker = [self _currentWorker];
+    while (dispatch_group_wait(group, DISPATCH_TIME_NOW) != 0) {
+        void *task = [self _takeTaskForWorker:worker];
+        if (task) LFWorkStealingRun(task);
+        else dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_MSEC));
+    }
+}
+
+- (void)shutdown {
+    if (__atomic_exchange_n(&_stopped, YES, __ATOMIC_ACQ_REL)) return;
+    for (uint32_t i = 0; i < _workerCount; i++) {
+        dispatch_semaphore_signal(_wake);
+    }
+}
+
+@end
@@ -7,15 +7,11 @@
 //
 
 #import "LFAnimatedImageView.h"
+#import "LFThreadSafeIntegerDictionary.h"
 #import <LFCategory/LFCategory.h>
-#import <libkern/OSAtomic.h>
 
 #define BUFFER_SIZE (20 * 1024 * 1024) // 20MB (minimum memory buffer size)
 
-#define LOCK(...) OSSpinLockLock(&_lock); \
-__VA_ARGS__; \
-OSSpinLockUnlock(&_lock);
-
 
 @implementation LFAnimatedImageView {
     BOOL _hasAnimated;
@@ -23,7 +19,6 @@ OSSpinLockUnlock(&_lock);
     UIImage <LFAnimatedImage> *_curAnimatedImage;
     
     dispatch_once_t _onceToken;
-    OSSpinLock _lock; ///< lock for _buffer
     NSOperationQueue *_requestQueue; ///< image request queue, serial
     
     CADisplayLink *_link; ///< ticker for change frame
@@ -37,7 +32,7 @@ OSSpinLockUnlock(&_lock);
     NSUInteger _curLoop; ///< current loop count (from 0)
     NSUInteger _totalLoop; ///< total loop count, 0 means infinity
     
-    NSMutableDictionary *_buffer; ///< frame buffer
+    LFThreadSafeIntegerDictionary *_buffer; ///< frame buffer, frame index -> image
     BOOL _bufferMiss; ///< whether miss frame on last opportunity
     NSUInteger _maxBufferCount; ///< maxmium buffer count
     NSInteger _incrBufferCount; ///< current buffer count (will increase by step)
@@ -62,8 +57,7 @@ OSSpinLockUnlock(&_lock);
 // init the animated params.
 - (void)resetAnimated {
     dispatch_once(&_onceToken, ^{
-        _lock = OS_SPINLOCK_INIT;
-        _buffer = @{}.mutableCopy;
+        _buffer = [LFThreadSafeIntegerDictionary new];
         _requestQueue = [[NSOperationQueue alloc] init];
         _requestQueue.maxConcurrentOperationCount = 1;
         _link = [CADisplayLink displayLinkWithTarget:[LFWeakProxy proxyWithTarget:self] selector:@selector(step:)];
@@ -74,7 +68,7 @@ OSSpinLockUnlock(&_lock);
     });
     
     [_requestQueue cancelAllOperations];
-    LOCK([_buffer removeAllObjects]);
+    [_buffer removeAllObjects];
     _time = 0;
     _curIndex = 0;
     _curFrame = nil;
@@ -184,21 +178,16 @@ OSSpinLockUnlock(&_lock);
     [_requestQueue cancelAllOperations];
     [_requestQueue addOperationWithBlock: ^{
         _incrBufferCount = -60 - (int)(arc4random() % 120); // about 1~3 seconds to grow back..
-        NSNumber *next = @((_curIndex + 1) % _totalIndex);
-        LOCK(
-             NSArray * keys = _buffer.allKeys;
-             for (NSNumber * key in keys) {
-                 if (![key isEqualToNumber:next]) { // keep the next frame for smoothly animation
-                     [_buffer removeObjectForKey:key];
-                 }
-             }
-        )//LOCK
+        NSUInteger next = (_curIndex + 1) % _totalIndex;
+        [_buffer removeObjectsPassingTest:^BOOL(NSUInteger key, id obj) {
+            return key != next; // keep the next frame for smoothly animation
+        }];
     }];
 }
 
 - (void)step:(CADisplayLink *)link {
     UIImage <LFAnimatedImage> *image = _curAnimatedImage;
-    NSMutableDictionary *buffer = _buffer;
+    LFThreadSafeIntegerDictionary *buffer = _buffer;
     UIImage *bufferedImage = nil;
     NSUInteger nextIndex = (_curIndex + 1) % _totalIndex;
     
@@ -228,20 +217,19 @@ OSSpinLockUnlock(&_lock);
         delay = [image animatedImageDurationAtIndex:nextIndex];
         if (_time > delay) _time = delay; // do not jump over frame
     }
-    LOCK(
-         bufferedImage = buffer[@(nextIndex)];
-         if (bufferedImage) {
-             if ((int)_incrBufferCount != _totalIndex) {
-                 [buffer removeObjectForKey:@(nextIndex)];
-             }
-             _curIndex = nextIndex;
-             _curFrame = bufferedImage;
-             nextIndex = (_curIndex + 1) % _totalIndex;
-             _bufferMiss = NO;
-         } else {
-             _bufferMiss = YES;
-         }
-    )//LOCK
+    if ((int)_incrBufferCount != _totalIndex) {
+        bufferedImage = [buffer popObjectForKey:nextIndex];
+    } else {
+        bufferedImage = buffer[nextIndex]; // all frames are buffered, keep them
+    }
+    if (bufferedImage) {
+        _curIndex = nextIndex;
+        _curFrame = bufferedImage;
+        nextIndex = (_curIndex + 1) % _totalIndex;
+        _bufferMiss = NO;
+    } else {
+        _bufferMiss = YES;
+    }
     
     if (!_bufferMiss) {
         [self.layer setNeedsDisplay]; // let system call `displayLayer:`
@@ -259,10 +247,10 @@ OSSpinLockUnlock(&_lock);
             for (int i = 0; i < max; i++, idx++) {
                 @autoreleasepool {
                     if (idx >= total) idx = 0;
-                    if (buffer[@(idx)] == nil) {
+                    if (buffer[idx] == nil) {
                         UIImage *img = [image animatedImageAtIndex:idx];
                         img = img.lf_imageByDecoded;
-                        LOCK(buffer[@(idx)] = img ? img : [NSNull null]);
+                        buffer[idx] = img ? img : [NSNull null];
                     }
                 }
             }